@@ -0,0 +1,108 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "arc_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ArcPolicy::ArcPolicy(std::uint32_t numFrames, std::uint32_t maxFrames)
+    : capacity(numFrames),
+      p(0),
+      t1(maxFrames),
+      t2(maxFrames),
+      freeFrames(maxFrames) {
+  for (FrameId i = 0; i < numFrames; i++) freeFrames.pushBack(i);
+}
+
+void ArcPolicy::recordAccess(FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (t1.contains(frame)) {
+    t1.remove(frame);
+    t2.pushFront(frame);
+  } else if (t2.contains(frame)) {
+    t2.moveToFront(frame);
+  }
+}
+
+void ArcPolicy::recordInsert(FrameId frame, std::uint64_t key) {
+  std::lock_guard<std::mutex> guard(latch);
+  freeFrames.remove(frame);
+  if (b1.contains(key)) {
+    const std::uint32_t delta = std::max<std::uint32_t>(
+        1, static_cast<std::uint32_t>(b2.size() / b1.size()));
+    p = std::min(p + delta, capacity);
+    b1.remove(key);
+    t2.pushFront(frame);
+  } else if (b2.contains(key)) {
+    const std::uint32_t delta = std::max<std::uint32_t>(
+        1, static_cast<std::uint32_t>(b1.size() / b2.size()));
+    p = p > delta ? p - delta : 0;
+    b2.remove(key);
+    t2.pushFront(frame);
+  } else {
+    // keep |T1| + |B1| <= c and the whole directory within 2c
+    if (t1.size() + b1.size() >= capacity && b1.size() > 0) {
+      b1.popBack();
+    } else if (t1.size() + t2.size() + b1.size() + b2.size() >= 2 * capacity &&
+               b2.size() > 0) {
+      b2.popBack();
+    }
+    t1.pushFront(frame);
+  }
+}
+
+void ArcPolicy::recordRemove(FrameId frame, std::uint64_t key,
+                             bool evicted) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (t1.contains(frame)) {
+    t1.remove(frame);
+    if (evicted) b1.pushFront(key);
+  } else if (t2.contains(frame)) {
+    t2.remove(frame);
+    if (evicted) b2.pushFront(key);
+  }
+  while (b1.size() > capacity) b1.popBack();
+  while (b2.size() > capacity) b2.popBack();
+  if (frame < capacity) freeFrames.pushBack(frame);
+}
+
+bool ArcPolicy::pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                           FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (freeFrames.claimFromBack(tryClaim, frame)) return true;
+  // REPLACE(x, p) of the paper
+  const bool fromT1 =
+      t1.size() > 0 &&
+      (t1.size() > p || (b2.contains(key) && t1.size() == p));
+  if (fromT1) {
+    return t1.claimFromBack(tryClaim, frame) ||
+           t2.claimFromBack(tryClaim, frame);
+  }
+  return t2.claimFromBack(tryClaim, frame) ||
+         t1.claimFromBack(tryClaim, frame);
+}
+
+void ArcPolicy::resize(std::uint32_t newFrames) {
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId i = capacity; i < newFrames; i++) freeFrames.pushBack(i);
+  for (FrameId i = newFrames; i < capacity; i++) freeFrames.remove(i);
+  capacity = newFrames;
+  p = std::min(p, capacity);
+  while (b1.size() > capacity) b1.popBack();
+  while (b2.size() > capacity) b2.popBack();
+}
+
+void ArcPolicy::rankFrames(std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(latch);
+  t2.appendTo(frames);
+  t1.appendTo(frames);
+}
+
+}  // namespace badgerdb
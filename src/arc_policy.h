@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "policy_lists.h"
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Adaptive Replacement Cache (Megiddo and Modha).
+ *
+ * Resident pages seen once are in T1, pages seen at least twice in T2.  Pages
+ * evicted from T1 and T2 are remembered in the ghost lists B1 and B2.  A miss
+ * on a ghost shifts the target size p of T1 towards the list that would have
+ * kept the page, so the split between recency and frequency adapts to the
+ * workload.
+ */
+class ArcPolicy : public ReplacementPolicy {
+ public:
+  ArcPolicy(std::uint32_t numFrames, std::uint32_t maxFrames);
+
+  const char* name() const override { return "ARC"; }
+  void recordAccess(FrameId frame) override;
+  void recordInsert(FrameId frame, std::uint64_t key) override;
+  void recordRemove(FrameId frame, std::uint64_t key, bool evicted) override;
+  bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                  FrameId& frame) override;
+  void resize(std::uint32_t newFrames) override;
+  void rankFrames(std::vector<FrameId>& frames) override;
+
+ private:
+  std::mutex latch;
+
+  /**
+   * Cache size c, the number of frames in use; frames from here up are
+   * retired.
+   */
+  std::uint32_t capacity;
+
+  /**
+   * Target size of T1
+   */
+  std::uint32_t p;
+
+  FrameList t1;
+  FrameList t2;
+  FrameList freeFrames;
+  KeyList b1;
+  KeyList b2;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,76 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Page allocation and deletion in files of each format: appending pages to an
+ * empty file, deleting every other page at random, and allocating the freed
+ * pages again.  Reports operations per second.  The linked-list format walks
+ * the used list on every call, so its rates fall as the file grows; the
+ * bitmap format's do not.
+ *
+ * Usage: alloc_bench [pages]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "alloc_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+
+  std::cout << pages << " pages\n";
+  std::cout << std::setw(12) << "format" << std::setw(14) << "append/s"
+            << std::setw(14) << "delete/s" << std::setw(14) << "reuse/s"
+            << "\n";
+  for (FileFormat format : {FileFormat::LINKED_LIST, FileFormat::BITMAP}) {
+    bench::removeIfExists(kFilename);
+    File file = File::create(kFilename, format);
+    std::vector<PageId> pageNos;
+
+    bench::Timer appendTimer;
+    for (std::uint32_t i = 0; i < pages; i++) {
+      pageNos.push_back(file.allocatePage().page_number());
+    }
+    const double append = appendTimer.seconds();
+
+    bench::Rng rng(7);
+    for (std::size_t i = pageNos.size() - 1; i > 0; i--) {
+      std::swap(pageNos[i], pageNos[rng.next() % (i + 1)]);
+    }
+    const std::uint32_t deletes = pages / 2;
+    bench::Timer deleteTimer;
+    for (std::uint32_t i = 0; i < deletes; i++) file.deletePage(pageNos[i]);
+    const double remove = deleteTimer.seconds();
+
+    bench::Timer reuseTimer;
+    for (std::uint32_t i = 0; i < deletes; i++) file.allocatePage();
+    const double reuse = reuseTimer.seconds();
+
+    std::cout << std::setw(12)
+              << (format == FileFormat::BITMAP ? "bitmap" : "linked list")
+              << std::fixed << std::setprecision(0) << std::setw(14)
+              << pages / append << std::setw(14) << deletes / remove
+              << std::setw(14) << deletes / reuse << "\n";
+  }
+
+  File::remove(kFilename);
+  return 0;
+}
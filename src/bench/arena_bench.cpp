@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Random record reads over a large set of in-memory pages, laid out as the
+ * buffer pool used to be (a vector of pages, each with its data in its own
+ * heap block) and as a PageArena with and without huge pages.  Reports time
+ * per read and, where the kernel allows counting them, dTLB load misses.
+ *
+ * Usage: arena_bench [pages] [reads]
+ */
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "page_arena.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * Page as it was before frames moved into an arena: header inline, data in
+ * a separately allocated string.
+ */
+struct LegacyPage {
+  PageHeader header;
+  std::string data;
+};
+
+/**
+ * Counts dTLB load misses of this thread, if the kernel lets us.
+ */
+class DtlbCounter {
+ public:
+  DtlbCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  }
+
+  ~DtlbCounter() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  void start() {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  /**
+   * Returns the misses since start(), or -1 if they cannot be counted.
+   */
+  long long stop() {
+    if (fd_ < 0) return -1;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    long long count;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) return -1;
+    return count;
+  }
+
+ private:
+  int fd_;
+};
+
+/**
+ * Reads the header and a record near the end of random pages, as
+ * Page::getRecord does, and returns a checksum so the reads are not
+ * optimized away.
+ */
+template <typename HeaderOf, typename DataOf>
+std::uint64_t randomReads(std::uint32_t pages, std::uint64_t reads,
+                          HeaderOf headerOf, DataOf dataOf) {
+  bench::Rng rng(3);
+  std::uint64_t sum = 0;
+  for (std::uint64_t i = 0; i < reads; i++) {
+    const std::uint32_t p = rng.next() % pages;
+    sum += headerOf(p).free_space_upper_bound;
+    sum += dataOf(p)[Page::DATA_SIZE - 1 - i % 64];
+  }
+  return sum;
+}
+
+void report(const char *label, double seconds, std::uint64_t reads,
+            long long misses) {
+  std::cout << std::setw(20) << label << std::setw(12) << std::fixed
+            << std::setprecision(1) << seconds * 1e9 / reads;
+  if (misses < 0) {
+    std::cout << std::setw(16) << "n/a";
+  } else {
+    std::cout << std::setw(16) << std::setprecision(3)
+              << static_cast<double>(misses) / reads;
+  }
+  std::cout << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 32768;
+  const std::uint64_t reads = argc > 2 ? std::atoll(argv[2]) : 20000000;
+  DtlbCounter counter;
+  std::uint64_t checksum = 0;
+
+  std::cout << reads << " random reads over " << pages << " pages ("
+            << pages * Page::SIZE / (1 << 20) << " MB)\n";
+  std::cout << std::setw(20) << "layout" << std::setw(12) << "ns/read"
+            << std::setw(16) << "dTLB miss/read"
+            << "\n";
+  {
+    std::vector<LegacyPage> legacy(pages);
+    for (LegacyPage &page : legacy) {
+      page.header.free_space_upper_bound = Page::DATA_SIZE;
+      page.data.assign(Page::DATA_SIZE, char(1));
+    }
+    counter.start();
+    bench::Timer timer;
+    checksum += randomReads(
+        pages, reads,
+        [&](std::uint32_t p) -> const PageHeader & { return legacy[p].header; },
+        [&](std::uint32_t p) { return legacy[p].data.data(); });
+    const double seconds = timer.seconds();
+    report("vector<Page>", seconds, reads, counter.stop());
+  }
+  for (bool huge : {false, true}) {
+    PageArena arena(pages, huge);
+    Page *frames = arena.pages();
+    // touch every byte, as reading pages in from disk would
+    for (std::uint32_t p = 0; p < pages; p++) {
+      std::memset(reinterpret_cast<char *>(&frames[p]), 1, Page::SIZE);
+    }
+    counter.start();
+    bench::Timer timer;
+    checksum += randomReads(
+        pages, reads,
+        [&](std::uint32_t p) -> const PageHeader & {
+          return *reinterpret_cast<const PageHeader *>(&frames[p]);
+        },
+        [&](std::uint32_t p) {
+          return reinterpret_cast<const char *>(&frames[p]) +
+                 sizeof(PageHeader);
+        });
+    const double seconds = timer.seconds();
+    const std::string label =
+        std::string("PageArena (") +
+        PageArena::backingName(arena.backing()) + ")";
+    report(label.c_str(), seconds, reads, counter.stop());
+  }
+  std::cout << "checksum " << checksum << "\n";
+  return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Reading batches of pages that are not in the pool: one readPage() per
+ * page against one readPages() call, for a batch of consecutive pages and
+ * for a batch scattered over the file.
+ *
+ * Usage: batch_bench [pages] [batch size] [batches]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "batch_bench.db";
+
+double run(BufMgr &bufMgr, File &file,
+           const std::vector<std::vector<PageId>> &batches, bool batched) {
+  double seconds = 0;
+  std::vector<Page *> pages;
+  for (const std::vector<PageId> &batch : batches) {
+    bench::Timer timer;
+    if (batched) {
+      bufMgr.readPages(file, batch, pages);
+    } else {
+      Page *page;
+      for (PageId pageNo : batch) bufMgr.readPage(file, pageNo, page);
+    }
+    seconds += timer.seconds();
+    for (PageId pageNo : batch) bufMgr.unPinPage(file, pageNo, false);
+    bufMgr.flushFile(file);
+  }
+  return seconds;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::uint32_t batchSize = argc > 2 ? std::atoi(argv[2]) : 64;
+  const std::uint32_t numBatches = argc > 3 ? std::atoi(argv[3]) : 500;
+
+  bench::createFile(kFilename, pages);
+  bench::Rng rng(13);
+  std::vector<std::vector<PageId>> consecutive(numBatches);
+  std::vector<std::vector<PageId>> scattered(numBatches);
+  for (std::uint32_t b = 0; b < numBatches; b++) {
+    const PageId first = rng.next() % (pages - batchSize) + 1;
+    for (std::uint32_t i = 0; i < batchSize; i++) {
+      consecutive[b].push_back(first + i);
+      scattered[b].push_back(rng.next() % pages + 1);
+    }
+    std::sort(scattered[b].begin(), scattered[b].end());
+    scattered[b].erase(std::unique(scattered[b].begin(), scattered[b].end()),
+                       scattered[b].end());
+  }
+
+  File file = File::open(kFilename);
+  BufMgr bufMgr(2 * batchSize);
+  std::cout << numBatches << " batches of " << batchSize << " pages out of "
+            << pages << "\n";
+  std::cout << std::setw(12) << "batch" << std::setw(18) << "readPage us"
+            << std::setw(18) << "readPages us" << std::setw(14)
+            << "runs/batch"
+            << "\n";
+  const char *labels[] = {"consecutive", "scattered"};
+  const std::vector<std::vector<PageId>> *workloads[] = {&consecutive,
+                                                         &scattered};
+  for (int w = 0; w < 2; w++) {
+    const double single = run(bufMgr, file, *workloads[w], false);
+    bufMgr.clearBufStats();
+    const double batched = run(bufMgr, file, *workloads[w], true);
+    std::cout << std::setw(12) << labels[w] << std::fixed
+              << std::setprecision(1) << std::setw(18)
+              << single * 1e6 / numBatches << std::setw(18)
+              << batched * 1e6 / numBatches << std::setw(14)
+              << static_cast<double>(bufMgr.getBufStats().readRuns()) /
+                     numBatches
+              << "\n";
+  }
+  return 0;
+}
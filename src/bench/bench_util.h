@@ -0,0 +1,109 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+namespace bench {
+
+/**
+ * @brief Wall-clock stopwatch for the benchmark drivers.
+ */
+class Timer {
+ public:
+  Timer() : start_(std::chrono::steady_clock::now()) {}
+
+  /**
+   * Returns the time since construction in seconds.
+   */
+  double seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start_)
+        .count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Removes a file left behind by an earlier run, if any.
+ *
+ * @param filename  Name of the file.
+ */
+inline void removeIfExists(const std::string &filename) {
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+}
+
+/**
+ * Evicts a file from the operating system's page cache, so that the next
+ * reads of it go to the device.  Best effort: does nothing if the file
+ * cannot be opened.
+ *
+ * @param filename  Name of the file.
+ */
+inline void dropCache(const std::string &filename) {
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return;
+  ::fdatasync(fd);
+  ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  ::close(fd);
+}
+
+/**
+ * Creates a file holding the given number of pages, each with one record.
+ *
+ * @param filename  Name of the file.
+ * @param numPages  Number of pages to allocate.
+ * @param layout    Layout of the file.
+ */
+inline void createFile(const std::string &filename, std::uint32_t numPages,
+                       FileLayout layout = FileLayout::PAGE_ALIGNED) {
+  removeIfExists(filename);
+  File file = File::create(filename, FileFormat::LINKED_LIST, layout);
+  for (std::uint32_t i = 0; i < numPages; i++) {
+    Page page = file.allocatePage();
+    page.insertRecord("benchmark record");
+    file.writePage(page);
+  }
+}
+
+/**
+ * Small, fast xorshift generator so the benchmark loop is not dominated by
+ * the random number generator.
+ */
+class Rng {
+ public:
+  explicit Rng(std::uint64_t seed) : state_(seed | 1) {}
+
+  std::uint64_t next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return state_;
+  }
+
+ private:
+  std::uint64_t state_;
+};
+
+}  // namespace bench
+}  // namespace badgerdb
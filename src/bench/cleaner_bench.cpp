@@ -0,0 +1,85 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * readPage latency with and without the background cleaner.  Uniform random
+ * reads over a file larger than the pool, a third of which dirty the page,
+ * with some idle time between requests for the cleaner to work in.
+ *
+ * Usage: cleaner_bench [pages] [frames] [reads] [idle time in us]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "cleaner_bench.db";
+
+void run(const char *label, std::uint32_t pages, std::uint32_t frames,
+         std::uint32_t reads, double thinkSeconds, bool cleaner) {
+  File file = File::open(kFilename);
+  BufMgr bufMgr(frames);
+  if (cleaner) bufMgr.startCleaner(frames / 8, frames / 4);
+  bench::Rng rng(11);
+  std::vector<double> latencies;
+  latencies.reserve(reads);
+  Page *page;
+  for (std::uint32_t i = 0; i < reads; i++) {
+    const std::uint64_t r = rng.next();
+    const PageId pageNo = (r >> 8) % pages + 1;
+    bench::Timer timer;
+    bufMgr.readPage(file, pageNo, page);
+    latencies.push_back(timer.seconds());
+    bufMgr.unPinPage(file, pageNo, r % 3 == 0);
+    // sleep rather than spin, so the cleaner gets the CPU on small machines
+    std::this_thread::sleep_for(std::chrono::duration<double>(thinkSeconds));
+  }
+  bufMgr.stopCleaner();
+
+  std::sort(latencies.begin(), latencies.end());
+  const BufStats &stats = bufMgr.getBufStats();
+  std::cout << std::setw(10) << label << std::fixed << std::setprecision(1)
+            << std::setw(10) << latencies[reads / 2] * 1e6 << std::setw(10)
+            << latencies[reads * 99 / 100] * 1e6 << std::setw(10)
+            << latencies[reads * 999 / 1000] * 1e6 << std::setw(14)
+            << stats.diskwrites() - stats.cleanerWrites() << std::setw(14)
+            << stats.cleanerWrites() << "\n";
+  bufMgr.flushFile(file);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 256;
+  const std::uint32_t reads = argc > 3 ? std::atoi(argv[3]) : 20000;
+  const double think = (argc > 4 ? std::atof(argv[4]) : 20) / 1e6;
+
+  bench::createFile(kFilename, pages);
+  std::cout << pages << " pages, " << frames << " frames, " << reads
+            << " reads, " << think * 1e6 << " us idle time\n";
+  std::cout << std::setw(10) << "cleaner" << std::setw(10) << "p50 us"
+            << std::setw(10) << "p99 us" << std::setw(10) << "p99.9 us"
+            << std::setw(14) << "fg writes" << std::setw(14) << "bg writes"
+            << "\n";
+  run("off", pages, frames, reads, think, false);
+  run("on", pages, frames, reads, think, true);
+  File::remove(kFilename);
+  return 0;
+}
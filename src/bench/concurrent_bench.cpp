@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Hit-path scaling of the buffer manager.  Every thread pins and unpins
+ * random pages of a file that fits in the pool, first through BufMgr
+ * directly and then with every call wrapped in one global mutex (the way
+ * callers had to use BufMgr before it was made thread-safe).
+ *
+ * Usage: concurrent_bench [max_threads] [ops_per_thread]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "concurrent_bench.db";
+const std::uint32_t kPages = 2048;
+
+double run(BufMgr &bufMgr, File &file, int numThreads, std::uint64_t ops,
+           std::mutex *global) {
+  std::vector<std::thread> threads;
+  bench::Timer timer;
+  for (int t = 0; t < numThreads; t++) {
+    threads.emplace_back([&, t]() {
+      bench::Rng rng(t + 1);
+      Page *page;
+      for (std::uint64_t i = 0; i < ops; i++) {
+        const PageId pageNo = rng.next() % kPages + 1;
+        if (global) {
+          std::lock_guard<std::mutex> guard(*global);
+          bufMgr.readPage(file, pageNo, page);
+          bufMgr.unPinPage(file, pageNo, false);
+        } else {
+          bufMgr.readPage(file, pageNo, page);
+          bufMgr.unPinPage(file, pageNo, false);
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+  return numThreads * ops / timer.seconds();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const int maxThreads = argc > 1 ? std::atoi(argv[1]) : 32;
+  const std::uint64_t ops = argc > 2 ? std::atoll(argv[2]) : 200000;
+
+  bench::createFile(kFilename, kPages);
+  {
+    File file = File::open(kFilename);
+    BufMgr bufMgr(kPages * 2);
+    // Warm the pool so that the measured loop only takes hits.
+    Page *page;
+    for (PageId p = 1; p <= kPages; p++) {
+      bufMgr.readPage(file, p, page);
+      bufMgr.unPinPage(file, p, false);
+    }
+
+    std::mutex global;
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+              << "\n";
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "BufMgr op/s"
+              << std::setw(10) << "speedup" << std::setw(16)
+              << "global op/s" << "\n";
+    double base = 0;
+    for (int t = 1; t <= maxThreads; t *= 2) {
+      const double sharded = run(bufMgr, file, t, ops, nullptr);
+      const double locked = run(bufMgr, file, t, ops, &global);
+      if (t == 1) base = sharded;
+      std::cout << std::setw(8) << t << std::setw(16) << std::fixed
+                << std::setprecision(0) << sharded << std::setw(10)
+                << std::setprecision(2) << sharded / base << std::setw(16)
+                << std::setprecision(0) << locked << "\n";
+    }
+  }
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Cost of evicting dirty pages: fills the pool with dirty pages of one file,
+ * reads a few pages of a second file, then re-reads the first file.  Reports
+ * the pages written by the misses on the second file and the hits left on
+ * the first.
+ *
+ * Usage: eviction_bench [frames] [misses]
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kDirtyFilename = "eviction_bench_dirty.db";
+const std::string kOtherFilename = "eviction_bench_other.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t frames = argc > 1 ? std::atoi(argv[1]) : 1024;
+  const std::uint32_t misses = argc > 2 ? std::atoi(argv[2]) : 16;
+
+  bench::createFile(kDirtyFilename, frames);
+  bench::createFile(kOtherFilename, misses);
+  {
+    File dirtyFile = File::open(kDirtyFilename);
+    File otherFile = File::open(kOtherFilename);
+    BufMgr bufMgr(frames);
+    Page *page;
+    for (PageId p = 1; p <= frames; p++) {
+      bufMgr.readPage(dirtyFile, p, page);
+      bufMgr.unPinPage(dirtyFile, p, true);
+    }
+
+    bufMgr.clearBufStats();
+    bench::Timer timer;
+    for (PageId p = 1; p <= misses; p++) {
+      bufMgr.readPage(otherFile, p, page);
+      bufMgr.unPinPage(otherFile, p, false);
+    }
+    const double seconds = timer.seconds();
+    const std::uint64_t writes = bufMgr.getBufStats().diskwrites();
+
+    // newest first, so re-reading evicted pages cannot push out cached ones
+    // before they are counted
+    bufMgr.clearBufStats();
+    for (PageId p = frames; p >= 1; p--) {
+      bufMgr.readPage(dirtyFile, p, page);
+      bufMgr.unPinPage(dirtyFile, p, false);
+    }
+    std::cout << frames << " dirty frames, " << misses << " misses on "
+              << "another file\n";
+    std::cout << "pages written by the misses: " << writes << " ("
+              << seconds * 1e6 / misses << " us per miss)\n";
+    std::cout << "dirty file pages still cached: "
+              << bufMgr.getBufStats().hits() << " of " << frames << "\n";
+    bufMgr.flushFile(dirtyFile);
+  }
+  File::remove(kDirtyFilename);
+  File::remove(kOtherFilename);
+  return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Compares File, which does positional I/O on a file descriptor, with the
+ * std::fstream backend it replaced (reproduced below as StreamFile): one
+ * stream per file, each I/O a seek plus a read or write under a latch.  Times
+ * random page reads from several threads and random page writes, with the
+ * file in the operating system's page cache.
+ *
+ * Usage: file_io_bench [pages] [ops per thread] [max threads]
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "file_io_bench.db";
+
+/**
+ * The previous File I/O: a shared fstream, with every read and write
+ * serialized on the file's latch, and writes flushed one by one.
+ */
+class StreamFile {
+ public:
+  explicit StreamFile(const std::string &filename)
+      : stream_(filename,
+                std::fstream::in | std::fstream::out | std::fstream::binary) {}
+
+  void readPage(const PageId page_number, Page &page) {
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    FileHeader header;
+    stream_.seekg(0, std::ios::beg);
+    stream_.read(reinterpret_cast<char *>(&header), sizeof(header));
+    if (page_number >= header.num_pages) std::abort();
+    stream_.seekg(position(page_number), std::ios::beg);
+    stream_.read(reinterpret_cast<char *>(&page), Page::SIZE);
+  }
+
+  void writePage(const PageId page_number, const Page &page) {
+    std::lock_guard<std::recursive_mutex> guard(mutex_);
+    char header[Page::SIZE - Page::DATA_SIZE];
+    stream_.seekg(position(page_number), std::ios::beg);
+    stream_.read(header, sizeof(header));
+    stream_.seekp(position(page_number), std::ios::beg);
+    stream_.write(reinterpret_cast<const char *>(&page), Page::SIZE);
+    stream_.flush();
+  }
+
+ private:
+  static std::streampos position(const PageId page_number) {
+    return sizeof(FileHeader) + (page_number - 1) * Page::SIZE;
+  }
+
+  std::fstream stream_;
+  std::recursive_mutex mutex_;
+};
+
+/**
+ * Runs op(thread, i) for i below ops on each of threads threads and returns
+ * the total operations per second.
+ */
+double run(const int threads, const std::uint64_t ops,
+           const std::function<void(int, std::uint64_t)> &op) {
+  std::vector<std::thread> workers;
+  bench::Timer timer;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t]() {
+      for (std::uint64_t i = 0; i < ops; i++) op(t, i);
+    });
+  }
+  for (std::thread &worker : workers) worker.join();
+  return threads * ops / timer.seconds();
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint64_t ops = argc > 2 ? std::atoll(argv[2]) : 100000;
+  const int maxThreads = argc > 3 ? std::atoi(argv[3]) : 4;
+
+  // StreamFile knows only the packed layout
+  bench::createFile(kFilename, pages, FileLayout::PACKED);
+  File file = File::open(kFilename);
+  StreamFile streamFile(kFilename);
+
+  std::cout << std::setw(8) << "op" << std::setw(8) << "threads"
+            << std::setw(14) << "fstream/s" << std::setw(16) << "pread/pwrite/s"
+            << "\n";
+  for (int threads = 1; threads <= maxThreads; threads *= 2) {
+    std::vector<bench::Rng> rngs(threads, bench::Rng(1));
+    std::vector<Page> buffers(threads);
+    const double streamRate = run(threads, ops, [&](int t, std::uint64_t) {
+      streamFile.readPage((rngs[t].next() >> 8) % pages + 1, buffers[t]);
+    });
+    const double fileRate = run(threads, ops, [&](int t, std::uint64_t) {
+      buffers[t] = file.readPage((rngs[t].next() >> 8) % pages + 1);
+    });
+    std::cout << std::setw(8) << "read" << std::setw(8) << threads
+              << std::fixed << std::setprecision(0) << std::setw(14)
+              << streamRate << std::setw(16) << fileRate << "\n";
+  }
+
+  // every page is rewritten with its own contents, so the file stays valid
+  std::vector<Page> contents(pages);
+  for (PageId i = 1; i <= pages; i++) contents[i - 1] = file.readPage(i);
+  bench::Rng rng(2);
+  const double streamWrites = run(1, ops, [&](int, std::uint64_t) {
+    const PageId pageNo = (rng.next() >> 8) % pages + 1;
+    streamFile.writePage(pageNo, contents[pageNo - 1]);
+  });
+  const double fileWrites = run(1, ops, [&](int, std::uint64_t) {
+    file.writePage(contents[(rng.next() >> 8) % pages]);
+  });
+  std::cout << std::setw(8) << "write" << std::setw(8) << 1 << std::setw(14)
+            << streamWrites << std::setw(16) << fileWrites << "\n";
+
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Flushing a small file out of a large pool.  Each round reads the pages of
+ * the file, dirtying them, and flushes the file; reports the time per
+ * flushFile() for pools of growing size, which should not depend on the size
+ * of the pool, and the bytes written back per write request.
+ *
+ * Usage: flush_bench [pages] [rounds]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "flush_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 16;
+  const int rounds = argc > 2 ? std::atoi(argv[2]) : 200;
+  const std::vector<std::uint32_t> sizes = {1024, 16384, 262144};
+
+  bench::createFile(kFilename, pages);
+  File file = File::open(kFilename);
+
+  std::cout << "flushing " << pages << " dirty pages\n";
+  std::cout << std::setw(10) << "frames" << std::setw(14) << "us/flush"
+            << std::setw(14) << "bytes/write"
+            << "\n";
+  for (std::uint32_t frames : sizes) {
+    BufMgr bufMgr(frames);
+    Page *page;
+    double flushSeconds = 0;
+    for (int round = 0; round < rounds; round++) {
+      for (PageId pageNo = 1; pageNo <= pages; pageNo++) {
+        bufMgr.readPage(file, pageNo, page);
+        bufMgr.unPinPage(file, pageNo, true);
+      }
+      bench::Timer timer;
+      bufMgr.flushFile(file);
+      flushSeconds += timer.seconds();
+    }
+    std::cout << std::setw(10) << frames << std::fixed << std::setprecision(1)
+              << std::setw(14) << flushSeconds / rounds * 1e6
+              << std::setprecision(0) << std::setw(14)
+              << bufMgr.getBufStats().bytesPerWrite() << "\n";
+  }
+
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,164 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Compares BufHashTbl against the chained, filename-hashed table it replaced
+ * (reproduced below as ChainedHashTbl).  Both tables are filled with the
+ * pages of a few files as a buffer pool of the given size would be, then
+ * timed on random hits and on remove/insert churn as done by eviction.
+ *
+ * Usage: hashtable_bench [entries] [ops]
+ */
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "bufHashTbl.h"
+
+using namespace badgerdb;
+
+namespace {
+
+/**
+ * The previous BufHashTbl: separate chaining through shared_ptr nodes that
+ * each hold a copy of the File, hashed on the filename.
+ */
+class ChainedHashTbl {
+ public:
+  explicit ChainedHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {}
+
+  void insert(const File &file, const PageId pageNo, const FrameId frameNo) {
+    int index = hash(file, pageNo);
+    std::shared_ptr<Node> tmpBuc = std::make_shared<Node>();
+    tmpBuc->file = file;
+    tmpBuc->pageNo = pageNo;
+    tmpBuc->frameNo = frameNo;
+    tmpBuc->next = ht[index];
+    ht[index] = tmpBuc;
+  }
+
+  bool lookup(const File &file, const PageId pageNo, FrameId &frameNo) {
+    std::shared_ptr<Node> tmpBuc = ht[hash(file, pageNo)];
+    while (tmpBuc) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        frameNo = tmpBuc->frameNo;
+        return true;
+      }
+      tmpBuc = tmpBuc->next;
+    }
+    return false;
+  }
+
+  void remove(const File &file, const PageId pageNo) {
+    int index = hash(file, pageNo);
+    std::shared_ptr<Node> tmpBuc = ht[index];
+    std::shared_ptr<Node> prevBuc;
+    while (tmpBuc) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        if (prevBuc)
+          prevBuc->next = tmpBuc->next;
+        else
+          ht[index] = tmpBuc->next;
+        return;
+      }
+      prevBuc = tmpBuc;
+      tmpBuc = tmpBuc->next;
+    }
+  }
+
+ private:
+  struct Node {
+    File file;
+    PageId pageNo;
+    FrameId frameNo;
+    std::shared_ptr<Node> next;
+  };
+
+  int hash(const File &file, const PageId pageNo) {
+    auto hash = std::hash<std::string>{}(file.filename()) ^
+                std::hash<PageId>{}(pageNo);
+    return hash % HTSIZE;
+  }
+
+  int HTSIZE;
+  std::vector<std::shared_ptr<Node>> ht;
+};
+
+const int kFiles = 4;
+
+template <typename Table>
+void measure(const char *name, Table &table, std::vector<File> &files,
+             std::uint32_t entries, std::uint64_t ops) {
+  const std::uint32_t perFile = entries / kFiles;
+  for (std::uint32_t i = 0; i < entries; i++) {
+    table.insert(files[i % kFiles], i / kFiles + 1, i);
+  }
+
+  bench::Rng rng(42);
+  FrameId frame = 0;
+  std::uint64_t sum = 0;
+  bench::Timer hits;
+  for (std::uint64_t i = 0; i < ops; i++) {
+    const std::uint64_t r = rng.next();
+    table.lookup(files[r % kFiles], (r >> 8) % perFile + 1, frame);
+    sum += frame;
+  }
+  const double hitNs = hits.seconds() * 1e9 / ops;
+
+  // Evict a random resident page and bring in a new one, as allocBuf does.
+  bench::Timer churn;
+  PageId nextPage = perFile + 1;
+  for (std::uint64_t i = 0; i < ops; i++) {
+    File &file = files[i % kFiles];
+    table.remove(file, nextPage - perFile);
+    table.insert(file, nextPage, static_cast<FrameId>(i % entries));
+    if (i % kFiles == kFiles - 1) nextPage++;
+  }
+  const double churnNs = churn.seconds() * 1e9 / ops;
+
+  std::cout << std::setw(10) << name << std::setw(14) << std::fixed
+            << std::setprecision(1) << hitNs << std::setw(18) << churnNs
+            << "   (checksum " << sum % 1000 << ")\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t entries = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const std::uint64_t ops = argc > 2 ? std::atoll(argv[2]) : 2000000;
+
+  std::vector<File> files;
+  for (int f = 0; f < kFiles; f++) {
+    const std::string name = "hashtable_bench." + std::to_string(f);
+    bench::removeIfExists(name);
+    files.push_back(File::create(name));
+  }
+
+  std::cout << entries << " entries, " << ops << " ops\n";
+  std::cout << std::setw(10) << "table" << std::setw(14) << "lookup ns"
+            << std::setw(18) << "remove+insert ns" << "\n";
+  {
+    ChainedHashTbl chained(static_cast<int>(entries * 1.2) | 1);
+    measure("chained", chained, files, entries, ops);
+  }
+  {
+    BufHashTbl open(static_cast<int>(entries * 1.2) | 1, entries);
+    measure("open", open, files, entries, ops);
+  }
+
+  files.clear();
+  for (int f = 0; f < kFiles; f++) {
+    File::remove("hashtable_bench." + std::to_string(f));
+  }
+  return 0;
+}
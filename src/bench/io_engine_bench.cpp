@@ -0,0 +1,115 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Random page reads, then writes, issued from one thread: one blocking
+ * File::readPages() or File::writePages() call after another, against
+ * batches of requests kept in flight by each IoEngine at several queue
+ * depths.  Reports operations per second.  With the
+ * file in the operating system's page cache this measures the cost of going
+ * through an engine; on a cold cache or a real device, the reads in flight
+ * overlap.  Writes put back the contents each page already has.
+ *
+ * Usage: io_engine_bench [pages] [reads]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "exceptions/badgerdb_exception.h"
+#include "file.h"
+#include "io_engine.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "io_engine_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 4096;
+  const std::uint64_t reads = argc > 2 ? std::atoll(argv[2]) : 100000;
+  const std::vector<std::uint32_t> depths = {1, 8, 32};
+
+  bench::createFile(kFilename, pages);
+  File file = File::open(kFilename);
+  std::vector<PageId> pageNos(reads);
+  bench::Rng rng(3);
+  for (PageId &pageNo : pageNos) pageNo = (rng.next() >> 8) % pages + 1;
+
+  // every page, so writes can put back what is there
+  std::vector<Page> contents(pages);
+  for (PageId pageNo = 1; pageNo <= pages; pageNo++) {
+    contents[pageNo - 1] = file.readPage(pageNo);
+  }
+
+  for (const bool write : {false, true}) {
+    std::cout << std::setw(10) << "engine" << std::setw(8) << "depth"
+              << std::setw(14) << (write ? "writes/s" : "reads/s") << "\n";
+    {
+      Page page;
+      Page *pointer = &page;
+      bench::Timer timer;
+      for (PageId pageNo : pageNos) {
+        if (write) {
+          const Page *out = &contents[pageNo - 1];
+          file.writePages(pageNo, 1, &out);
+        } else {
+          file.readPages(pageNo, 1, &pointer);
+        }
+      }
+      std::cout << std::setw(10) << "blocking" << std::setw(8) << 1
+                << std::fixed << std::setprecision(0) << std::setw(14)
+                << reads / timer.seconds() << "\n";
+    }
+
+    for (IoEngineType type :
+         {IoEngineType::URING, IoEngineType::THREAD_POOL}) {
+      for (std::uint32_t depth : depths) {
+        std::unique_ptr<IoEngine> engine;
+        try {
+          engine = IoEngine::create(type, depth);
+        } catch (const BadgerDbException &e) {
+          std::cout << e.message() << "\n";
+          break;
+        }
+        // one batch of depth requests at a time, each with its own page
+        std::vector<Page> buffers(depth);
+        std::vector<std::exception_ptr> errors(depth);
+        bench::Timer timer;
+        for (std::uint64_t i = 0; i < reads; i += depth) {
+          IoBatch batch;
+          for (std::uint32_t k = 0; k < depth && i + k < reads; k++) {
+            if (write) {
+              const Page *out = &contents[pageNos[i + k] - 1];
+              engine->write(file, pageNos[i + k], 1, &out,
+                            batch.add(&errors[k]));
+            } else {
+              Page *pointer = &buffers[k];
+              engine->read(file, pageNos[i + k], 1, &pointer,
+                           batch.add(&errors[k]));
+            }
+          }
+          engine->submit();
+          batch.wait();
+        }
+        std::cout << std::setw(10) << engine->name() << std::setw(8) << depth
+                  << std::setw(14) << reads / timer.seconds() << "\n";
+      }
+    }
+  }
+
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
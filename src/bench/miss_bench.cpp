@@ -0,0 +1,109 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * The cost of a miss in the hash table and in the buffer manager.  First
+ * times hash table lookups of absent pages reported by a thrown
+ * HashNotFoundException against tryLookup(); then times readPage() on random
+ * pages of a file the pool holds only part of, so that about 30% of the reads
+ * miss, with the file in the operating system's page cache.
+ *
+ * Usage: miss_bench [entries] [lookups] [pages] [reads]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "bufHashTbl.h"
+#include "buffer.h"
+#include "exceptions/hash_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "miss_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t entries = argc > 1 ? std::atoi(argv[1]) : 100000;
+  const std::uint64_t lookups = argc > 2 ? std::atoll(argv[2]) : 1000000;
+  const std::uint32_t pages = argc > 3 ? std::atoi(argv[3]) : 4096;
+  const std::uint64_t reads = argc > 4 ? std::atoll(argv[4]) : 1000000;
+
+  bench::createFile(kFilename, pages);
+  File file = File::open(kFilename);
+
+  // pages 1 to entries are present, the lookups ask for the ones after
+  BufHashTbl table(entries, entries);
+  for (std::uint32_t i = 0; i < entries; i++) table.insert(file, i + 1, i);
+
+  std::uint64_t found = 0;
+  FrameId frame;
+  bench::Rng rng(7);
+  bench::Timer throwTimer;
+  for (std::uint64_t i = 0; i < lookups; i++) {
+    try {
+      table.lookup(file, entries + 1 + (rng.next() >> 8) % entries, frame);
+      found++;
+    } catch (const HashNotFoundException &) {
+    }
+  }
+  const double throwSeconds = throwTimer.seconds();
+
+  bench::Timer tryTimer;
+  for (std::uint64_t i = 0; i < lookups; i++) {
+    if (table.tryLookup(file, entries + 1 + (rng.next() >> 8) % entries,
+                        frame)) {
+      found++;
+    }
+  }
+  const double trySeconds = tryTimer.seconds();
+
+  std::cout << "hash table misses, " << entries << " entries\n";
+  std::cout << std::setw(14) << "lookup" << std::setw(10) << "ns/miss"
+            << "\n";
+  std::cout << std::fixed << std::setprecision(1) << std::setw(14)
+            << "throwing" << std::setw(10) << throwSeconds / lookups * 1e9
+            << "\n"
+            << std::setw(14) << "tryLookup" << std::setw(10)
+            << trySeconds / lookups * 1e9 << "\n";
+  if (found != 0) std::cout << "unexpected hits " << found << "\n";
+
+  {
+    // a pool of 70% of the file takes about 30% misses on uniform reads
+    BufMgr bufMgr(pages * 7 / 10);
+    Page *page;
+    for (std::uint64_t i = 0; i < reads / 10; i++) {
+      const PageId pageNo = (rng.next() >> 8) % pages + 1;
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    }
+    bufMgr.clearBufStats();
+    bench::Timer readTimer;
+    for (std::uint64_t i = 0; i < reads; i++) {
+      const PageId pageNo = (rng.next() >> 8) % pages + 1;
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    }
+    const double readSeconds = readTimer.seconds();
+    std::cout << "\nreadPage over " << pages << " pages, "
+              << pages * 7 / 10 << " frames\n";
+    std::cout << std::setw(10) << "miss %" << std::setw(10) << "ns/read"
+              << "\n";
+    std::cout << std::setw(10) << 100 * (1 - bufMgr.getBufStats().hitRatio())
+              << std::setw(10) << readSeconds / reads * 1e9 << "\n";
+  }
+
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Full scans of a file nobody modifies, reading the record on every page:
+ * through a std::fstream one page at a time (the old File I/O), with
+ * FileIterator over a File, through the buffer manager, and with
+ * FileIterator::view() over the same file opened with File::openReadOnly(),
+ * which does not copy pages.  Each scan runs with the file in the operating
+ * system's page cache and with a cold cache.
+ *
+ * Usage: mmap_scan_bench [pages] [frames]
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "file_iterator.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "mmap_scan_bench.db";
+
+/**
+ * Runs scan once to warm the page cache and once timed, then times it again
+ * on a cold cache, and prints MB/s for both.
+ */
+void report(const char *label, std::uint32_t pages,
+            const std::function<std::size_t()> &scan) {
+  std::size_t bytes = scan();
+  bench::Timer warmTimer;
+  bytes += scan();
+  const double warm = warmTimer.seconds();
+  bench::dropCache(kFilename);
+  bench::Timer coldTimer;
+  bytes += scan();
+  const double cold = coldTimer.seconds();
+  if (bytes == 0) std::cout << "no records\n";
+  const double mb = pages * (double)Page::SIZE / (1 << 20);
+  std::cout << std::setw(22) << label << std::fixed << std::setprecision(0)
+            << std::setw(12) << mb / warm << std::setw(12) << mb / cold
+            << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 16384;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 1024;
+
+  // the fstream scan knows only the packed layout
+  bench::createFile(kFilename, pages, FileLayout::PACKED);
+  std::cout << pages << " pages, " << frames << " frames\n";
+  std::cout << std::setw(22) << "scan" << std::setw(12) << "warm MB/s"
+            << std::setw(12) << "cold MB/s"
+            << "\n";
+
+  report("fstream", pages, [&]() {
+    std::ifstream stream(kFilename, std::ios::binary);
+    Page page;
+    std::size_t bytes = 0;
+    for (PageId p = 1; p <= pages; p++) {
+      stream.seekg(sizeof(FileHeader) + (p - 1) * Page::SIZE);
+      stream.read(reinterpret_cast<char *>(&page), Page::SIZE);
+      bytes += page.getRecord({p, 1}).size();
+    }
+    return bytes;
+  });
+
+  report("FileIterator", pages, [&]() {
+    File file = File::open(kFilename);
+    std::size_t bytes = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      const Page page = *iter;
+      bytes += page.getRecord({page.page_number(), 1}).size();
+    }
+    return bytes;
+  });
+
+  report("BufMgr", pages, [&]() {
+    File file = File::open(kFilename);
+    std::size_t bytes = 0;
+    {
+      BufMgr bufMgr(frames);
+      Page *page;
+      for (PageId p = 1; p <= pages; p++) {
+        bufMgr.readPage(file, p, page);
+        bytes += page->getRecord({p, 1}).size();
+        bufMgr.unPinPage(file, p, false);
+      }
+    }
+    return bytes;
+  });
+
+  report("mapped view()", pages, [&]() {
+    File file = File::openReadOnly(kFilename);
+    std::size_t bytes = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      const Page &page = iter.view();
+      bytes += page.getRecord({page.page_number(), 1}).size();
+    }
+    return bytes;
+  });
+
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Cost of a buffer pool hit: readPage() plus unPinPage(), against
+ * readPage() returning a PinnedPage that unpins without a hash lookup.
+ *
+ * Usage: pin_bench [pages] [hits]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "pin_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 512;
+  const std::uint64_t hits = argc > 2 ? std::atoll(argv[2]) : 5000000;
+
+  bench::createFile(kFilename, pages);
+  {
+    File file = File::open(kFilename);
+    BufMgr bufMgr(pages);
+    Page *page;
+    for (PageId p = 1; p <= pages; p++) {
+      bufMgr.readPage(file, p, page);
+      bufMgr.unPinPage(file, p, false);
+    }
+
+    std::cout << hits << " hits on " << pages << " resident pages\n";
+    std::cout << std::setw(26) << "unpin" << std::setw(12) << "ns/hit"
+              << "\n";
+    bench::Rng rng(5);
+    bench::Timer pairTimer;
+    for (std::uint64_t i = 0; i < hits; i++) {
+      const PageId pageNo = rng.next() % pages + 1;
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+    }
+    std::cout << std::setw(26) << "readPage + unPinPage" << std::setw(12)
+              << std::fixed << std::setprecision(1)
+              << pairTimer.seconds() * 1e9 / hits << "\n";
+
+    bench::Timer guardTimer;
+    for (std::uint64_t i = 0; i < hits; i++) {
+      const PageId pageNo = rng.next() % pages + 1;
+      PinnedPage pinned = bufMgr.readPage(file, pageNo);
+    }
+    std::cout << std::setw(26) << "PinnedPage" << std::setw(12)
+              << guardTimer.seconds() * 1e9 / hits << "\n";
+  }
+  File::remove(kFilename);
+  return 0;
+}
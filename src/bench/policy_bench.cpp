@@ -0,0 +1,80 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Hit ratios of the replacement policies on a mixed workload: skewed point
+ * lookups (80% of them on 10% of the file) with a full scan of the file
+ * every so often.  The hot set fits in the pool; the scan does not.
+ *
+ * Usage: policy_bench [pages] [frames] [lookups]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "policy_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 256;
+  const std::uint64_t lookups = argc > 3 ? std::atoll(argv[3]) : 200000;
+  const std::uint32_t hotPages = pages / 10;
+  const std::uint64_t scanEvery = lookups / 10;
+
+  bench::createFile(kFilename, pages);
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+
+  std::cout << pages << " pages, " << frames << " frames, " << lookups
+            << " lookups, a full scan every " << scanEvery << " lookups\n";
+  std::cout << std::setw(10) << "policy" << std::setw(12) << "hit ratio"
+            << std::setw(14) << "lookup hits" << std::setw(10) << "seconds"
+            << "\n";
+  for (ReplacementPolicyType policy : policies) {
+    File file = File::open(kFilename);
+    BufMgr bufMgr(frames, policy);
+    bench::Rng rng(7);
+    Page *page;
+    std::uint64_t lookupHits = 0;
+    bench::Timer timer;
+    for (std::uint64_t i = 0; i < lookups; i++) {
+      if (i % scanEvery == scanEvery / 2) {
+        for (PageId p = 1; p <= pages; p++) {
+          bufMgr.readPage(file, p, page);
+          bufMgr.unPinPage(file, p, false);
+        }
+      }
+      const std::uint64_t r = rng.next();
+      const PageId pageNo = (r % 10 < 8) ? (r >> 8) % hotPages + 1
+                                         : (r >> 8) % pages + 1;
+      const std::uint64_t hitsBefore = bufMgr.getBufStats().hits();
+      bufMgr.readPage(file, pageNo, page);
+      bufMgr.unPinPage(file, pageNo, false);
+      lookupHits += bufMgr.getBufStats().hits() - hitsBefore;
+    }
+    const BufStats &stats = bufMgr.getBufStats();
+    std::cout << std::setw(10) << stats.policy << std::setw(12) << std::fixed
+              << std::setprecision(3) << stats.hitRatio() << std::setw(14)
+              << static_cast<double>(lookupHits) / lookups << std::setw(10)
+              << std::setprecision(2) << timer.seconds() << "\n";
+  }
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Resizing the pool under a running workload.  Reader threads read random
+ * pages, dirtying a quarter of them, while the main thread grows and shrinks
+ * the pool.  For every size, reports how long resize() took and the readers'
+ * throughput, hit ratio and readPage latency until the next resize.
+ *
+ * Usage: resize_bench [pages] [threads] [seconds per size]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "resize_bench.db";
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const int numThreads = argc > 2 ? std::atoi(argv[2]) : 2;
+  const double seconds = argc > 3 ? std::atof(argv[3]) : 0.5;
+  const std::vector<std::uint32_t> sizes = {pages / 8, pages / 2, pages,
+                                            pages / 4, pages / 16};
+
+  bench::createFile(kFilename, pages);
+  File file = File::open(kFilename);
+  BufMgr bufMgr(sizes[0], ReplacementPolicyType::CLOCK, pages);
+  bufMgr.getBufStats().metrics.setEnabled(true);
+
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < numThreads; t++) {
+    readers.emplace_back([&, t]() {
+      bench::Rng rng(17 + t);
+      Page *page;
+      while (!stop) {
+        const std::uint64_t r = rng.next();
+        const PageId pageNo = (r >> 8) % pages + 1;
+        bufMgr.readPage(file, pageNo, page);
+        bufMgr.unPinPage(file, pageNo, r % 4 == 0);
+      }
+    });
+  }
+
+  std::cout << numThreads << " readers over " << pages << " pages\n";
+  std::cout << std::setw(8) << "frames" << std::setw(12) << "resize ms"
+            << std::setw(12) << "reads/s" << std::setw(8) << "hit %"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+            << std::setw(10) << "max us"
+            << "\n";
+  const int readOp = static_cast<int>(BufOp::READ_PAGE);
+  for (std::uint32_t frames : sizes) {
+    bench::Timer resizeTimer;
+    bufMgr.resize(frames);
+    const double resizeSeconds = resizeTimer.seconds();
+
+    const BufMetrics::Snapshot before = bufMgr.getBufStats().snapshot();
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    const BufMetrics::Snapshot diff =
+        bufMgr.getBufStats().snapshot() - before;
+    const Histogram &latency = diff.latency[readOp];
+    std::cout << std::setw(8) << frames << std::fixed << std::setprecision(2)
+              << std::setw(12) << resizeSeconds * 1e3 << std::setprecision(0)
+              << std::setw(12) << latency.count() / seconds
+              << std::setprecision(1) << std::setw(8)
+              << 100.0 * diff.count(BufCounter::HITS) /
+                     std::max<std::uint64_t>(
+                         1, diff.count(BufCounter::ACCESSES))
+              << std::setw(10) << latency.percentile(50) / 1e3
+              << std::setw(10) << latency.percentile(99) / 1e3
+              << std::setw(10) << latency.max() / 1e3 << "\n";
+  }
+
+  stop = true;
+  for (std::thread &reader : readers) reader.join();
+  bufMgr.flushFile(file);
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
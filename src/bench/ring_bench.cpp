@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Hit ratio of point lookups on a hot set that fits in the pool, alone and
+ * with a scan of the whole file running alongside (one scan page read per
+ * lookup), first through the shared pool and then through a BufferRing.
+ *
+ * Usage: ring_bench [pages] [frames] [lookups] [ring size]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "ring_bench.db";
+
+enum class Scan { NONE, SHARED, RING };
+
+double lookupHitRatio(BufMgr &bufMgr, File &file, std::uint32_t pages,
+                      std::uint32_t hotPages, std::uint64_t lookups,
+                      Scan scan, std::uint32_t ringSize) {
+  BufferRing ring(ringSize);
+  bench::Rng rng(9);
+  Page *page;
+  PageId scanPage = hotPages;
+  std::uint64_t lookupHits = 0;
+  for (std::uint64_t i = 0; i < lookups; i++) {
+    const PageId pageNo = rng.next() % hotPages + 1;
+    const std::uint64_t hitsBefore = bufMgr.getBufStats().hits();
+    bufMgr.readPage(file, pageNo, page);
+    bufMgr.unPinPage(file, pageNo, false);
+    lookupHits += bufMgr.getBufStats().hits() - hitsBefore;
+
+    if (scan != Scan::NONE) {
+      scanPage = scanPage % pages + 1;
+      bufMgr.readPage(file, scanPage, page,
+                      scan == Scan::RING ? &ring : nullptr);
+      bufMgr.unPinPage(file, scanPage, false);
+    }
+  }
+  return static_cast<double>(lookupHits) / lookups;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 256;
+  const std::uint64_t lookups = argc > 3 ? std::atoll(argv[3]) : 100000;
+  const std::uint32_t ringSize = argc > 4 ? std::atoi(argv[4]) : 16;
+  const std::uint32_t hotPages = frames * 3 / 4;
+
+  bench::createFile(kFilename, pages);
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+
+  std::cout << pages << " pages, " << frames << " frames, " << hotPages
+            << " hot pages, " << lookups << " lookups, ring of " << ringSize
+            << "\n";
+  std::cout << std::setw(10) << "policy" << std::setw(10) << "no scan"
+            << std::setw(14) << "shared scan" << std::setw(12) << "ring scan"
+            << "\n";
+  for (ReplacementPolicyType policy : policies) {
+    File file = File::open(kFilename);
+    double ratios[3];
+    const Scan scans[] = {Scan::NONE, Scan::SHARED, Scan::RING};
+    for (int s = 0; s < 3; s++) {
+      BufMgr bufMgr(frames, policy);
+      // warm up the hot set
+      lookupHitRatio(bufMgr, file, pages, hotPages, lookups / 10, Scan::NONE,
+                     ringSize);
+      ratios[s] = lookupHitRatio(bufMgr, file, pages, hotPages, lookups,
+                                 scans[s], ringSize);
+      if (s == 2) {
+        std::cout << std::setw(10) << bufMgr.getBufStats().policy;
+      }
+    }
+    std::cout << std::fixed << std::setprecision(3) << std::setw(10)
+              << ratios[0] << std::setw(14) << ratios[1] << std::setw(12)
+              << ratios[2] << "\n";
+  }
+  File::remove(kFilename);
+  return 0;
+}
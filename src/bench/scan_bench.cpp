@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Full scans of a file that is not in the operating system's page cache:
+ * with FileIterator, and through the buffer manager with read-ahead off,
+ * with sequential detection and with an explicit readAhead() hint.
+ *
+ * Usage: scan_bench [pages] [frames] [read-ahead window]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+#include "bench/bench_util.h"
+#include "buffer.h"
+#include "file_iterator.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "scan_bench.db";
+
+enum class Mode { OFF, DETECT, HINT };
+
+void report(const char *label, std::uint32_t pages, double seconds,
+            int prefetchHits) {
+  std::cout << std::setw(22) << label << std::fixed << std::setprecision(3)
+            << std::setw(10) << seconds << std::setw(12) << std::setprecision(0)
+            << pages * (double)Page::SIZE / seconds / (1 << 20)
+            << std::setw(14) << prefetchHits << "\n";
+}
+
+void scanBuffered(const char *label, std::uint32_t pages,
+                  std::uint32_t frames, std::uint32_t window, Mode mode) {
+  bench::dropCache(kFilename);
+  File file = File::open(kFilename);
+  BufMgr bufMgr(frames);
+  if (mode == Mode::DETECT) bufMgr.setReadAhead(window);
+  bench::Timer timer;
+  Page *page;
+  for (PageId p = 1; p <= pages; p++) {
+    if (mode == Mode::HINT && p % window == 1) {
+      // keep one window queued beyond the one being read
+      bufMgr.readAhead(file, p == 1 ? 1 : p + window, p == 1 ? 2 * window
+                                                              : window);
+    }
+    bufMgr.readPage(file, p, page);
+    bufMgr.unPinPage(file, p, false);
+  }
+  report(label, pages, timer.seconds(), bufMgr.getBufStats().prefetchHits());
+  bufMgr.flushFile(file);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 2048;
+  const std::uint32_t frames = argc > 2 ? std::atoi(argv[2]) : 256;
+  const std::uint32_t window = argc > 3 ? std::atoi(argv[3]) : 32;
+
+  bench::createFile(kFilename, pages);
+  std::cout << pages << " pages, " << frames << " frames, read-ahead window "
+            << window << ", cold page cache\n";
+  std::cout << std::setw(22) << "scan" << std::setw(10) << "seconds"
+            << std::setw(12) << "MB/s" << std::setw(14) << "prefetch hits"
+            << "\n";
+  {
+    bench::dropCache(kFilename);
+    File file = File::open(kFilename);
+    bench::Timer timer;
+    std::uint32_t scanned = 0;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      scanned += (*iter).page_number() != Page::INVALID_NUMBER;
+    }
+    report("FileIterator", scanned, timer.seconds(), 0);
+  }
+  scanBuffered("BufMgr, no read-ahead", pages, frames, window, Mode::OFF);
+  scanBuffered("BufMgr, detected", pages, frames, window, Mode::DETECT);
+  scanBuffered("BufMgr, readAhead()", pages, frames, window, Mode::HINT);
+  File::remove(kFilename);
+  return 0;
+}
@@ -0,0 +1,92 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Commits from several threads, each a page write followed by File::sync(),
+ * under each durability mode.  Reports commits per second and fdatasync()
+ * calls per commit: one each with Durability::FDATASYNC, and fewer with
+ * Durability::GROUP_SYNC as more threads commit together.
+ *
+ * Usage: sync_bench [commits per thread] [max threads]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "sync_bench.db";
+
+const char *name(const Durability durability) {
+  switch (durability) {
+    case Durability::NONE:
+      return "none";
+    case Durability::FDATASYNC:
+      return "fdatasync";
+    case Durability::GROUP_SYNC:
+      return "group sync";
+  }
+  return "";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const int commits = argc > 1 ? std::atoi(argv[1]) : 200;
+  const int maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+
+  bench::removeIfExists(kFilename);
+  File file = File::create(kFilename);
+  std::vector<Page> pages;
+  for (int t = 0; t < maxThreads; t++) {
+    pages.push_back(file.allocatePage());
+    pages.back().insertRecord("sync_bench");
+    file.writePage(pages.back());
+  }
+
+  std::cout << std::setw(12) << "durability" << std::setw(8) << "threads"
+            << std::setw(12) << "commits/s" << std::setw(14) << "syncs/commit"
+            << "\n";
+  for (Durability durability :
+       {Durability::NONE, Durability::FDATASYNC, Durability::GROUP_SYNC}) {
+    file.setDurability(durability);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+      const std::uint64_t syncsBefore = file.dataSyncs();
+      std::vector<std::thread> workers;
+      bench::Timer timer;
+      for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+          for (int i = 0; i < commits; i++) {
+            file.writePage(pages[t]);
+            file.sync();
+          }
+        });
+      }
+      for (std::thread &worker : workers) worker.join();
+      const double seconds = timer.seconds();
+      const double total = static_cast<double>(threads) * commits;
+      std::cout << std::setw(12) << name(durability) << std::setw(8)
+                << threads << std::fixed << std::setprecision(0)
+                << std::setw(12) << total / seconds << std::setprecision(2)
+                << std::setw(14) << (file.dataSyncs() - syncsBefore) / total
+                << "\n";
+    }
+  }
+
+  file = File();
+  File::remove(kFilename);
+  return 0;
+}
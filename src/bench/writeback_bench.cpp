@@ -0,0 +1,119 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Write-back of random dirty pages, each read before it was modified, as in
+ * the buffer manager: File::writePage(), which takes the next page pointer
+ * from the page directory, against the previous writePage() reproduced below,
+ * which read the page header from disk before every write, in a file of the
+ * packed layout, and File::writePage() again in a page-aligned file, whose
+ * pages the operating system can replace without reading any of them.  Each
+ * runs with the file in the operating system's page cache and with a cold
+ * cache, and reports writes per second.
+ *
+ * Usage: writeback_bench [pages] [writes]
+ */
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "bench/bench_util.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::string kFilename = "writeback_bench.db";
+const std::string kAlignedFilename = "writeback_bench_aligned.db";
+
+off_t position(const PageId page_number) {
+  return sizeof(FileHeader) + (page_number - 1) * Page::SIZE;
+}
+
+/**
+ * Times writes() with the page cache warm and then cold, and prints the
+ * writes per second of both.
+ */
+void report(const char *label, const std::string &filename,
+            std::uint64_t writes, const std::function<void()> &write) {
+  write();
+  bench::Timer warmTimer;
+  write();
+  const double warm = warmTimer.seconds();
+  bench::dropCache(filename);
+  bench::Timer coldTimer;
+  write();
+  const double cold = coldTimer.seconds();
+  std::cout << std::setw(14) << label << std::fixed << std::setprecision(0)
+            << std::setw(14) << writes / warm << std::setw(14) << writes / cold
+            << "\n";
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  const std::uint32_t pages = argc > 1 ? std::atoi(argv[1]) : 16384;
+  const std::uint64_t writes = argc > 2 ? std::atoll(argv[2]) : 20000;
+
+  // the reproduced writePage() knows only the packed layout
+  bench::createFile(kFilename, pages, FileLayout::PACKED);
+  bench::createFile(kAlignedFilename, pages, FileLayout::PAGE_ALIGNED);
+  File file = File::open(kFilename);
+  File aligned = File::open(kAlignedFilename);
+  // every page is rewritten with its own contents, so the file stays valid
+  std::vector<Page> contents(pages);
+  for (PageId i = 1; i <= pages; i++) {
+    contents[i - 1] = file.readPage(i);
+    aligned.readPage(i);
+  }
+  std::vector<PageId> pageNos(writes);
+  bench::Rng rng(5);
+  for (PageId &pageNo : pageNos) pageNo = (rng.next() >> 8) % pages + 1;
+
+  std::cout << pages << " pages, " << writes << " writes\n";
+  std::cout << std::setw(14) << "write-back" << std::setw(14) << "warm/s"
+            << std::setw(14) << "cold/s"
+            << "\n";
+
+  const int fd = ::open(kFilename.c_str(), O_RDWR);
+  report("read+write", kFilename, writes, [&]() {
+    for (PageId pageNo : pageNos) {
+      PageHeader header;
+      if (::pread(fd, &header, sizeof(header), position(pageNo)) !=
+          sizeof(header)) {
+        std::abort();
+      }
+      Page page = contents[pageNo - 1];
+      if (::pwrite(fd, &page, Page::SIZE, position(pageNo)) != Page::SIZE) {
+        std::abort();
+      }
+    }
+  });
+  ::close(fd);
+
+  report("File", kFilename, writes, [&]() {
+    for (PageId pageNo : pageNos) file.writePage(contents[pageNo - 1]);
+  });
+
+  report("File, aligned", kAlignedFilename, writes, [&]() {
+    for (PageId pageNo : pageNos) aligned.writePage(contents[pageNo - 1]);
+  });
+
+  file = File();
+  aligned = File();
+  File::remove(kFilename);
+  File::remove(kAlignedFilename);
+  return 0;
+}
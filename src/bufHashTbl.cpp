@@ -8,9 +8,8 @@
 
 #include "bufHashTbl.h"
 
-#include <functional>
+#include <algorithm>
 #include <iostream>
-#include <memory>
 
 #include "buffer.h"
 #include "exceptions/hash_already_present_exception.h"
@@ -19,74 +18,196 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File& file, const PageId pageNo) {
-  auto hash =
-      std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
-  return hash % HTSIZE;
+namespace {
+
+/**
+ * Number of bits of the hash that select the partition.
+ */
+constexpr int PARTITION_BITS = 7;
+static_assert(BufHashTbl::NUM_PARTITIONS == 1 << PARTITION_BITS,
+              "NUM_PARTITIONS must be 2^PARTITION_BITS");
+
+/**
+ * Smallest bucket array a partition is created with.
+ */
+constexpr std::size_t MIN_BUCKETS = 8;
+
+/**
+ * Bucket array size giving every partition its share of htSize at 50% load.
+ */
+std::size_t partitionBuckets(const int htSize) {
+  std::size_t buckets = MIN_BUCKETS;
+  while (buckets <
+         2 * static_cast<std::size_t>(htSize) / BufHashTbl::NUM_PARTITIONS) {
+    buckets *= 2;
+  }
+  return buckets;
 }
 
-BufHashTbl::BufHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {
-  // allocate an array of pointers to hashBuckets
+}  // namespace
+
+std::uint64_t BufHashTbl::hash(const std::uint64_t key) {
+  // finalizer of MurmurHash3
+  std::uint64_t h = key;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
 }
 
-void BufHashTbl::insert(const File& file, const PageId pageNo,
-                        const FrameId frameNo) {
-  int index = hash(file, pageNo);
-
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-      throw HashAlreadyPresentException(tmpBuc->file.filename(), tmpBuc->pageNo,
-                                        tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+BufHashTbl::Partition& BufHashTbl::partition(const std::uint64_t key) {
+  return partitions[hash(key) >> (64 - PARTITION_BITS)];
+}
+
+BufHashTbl::BufHashTbl(int htSize, const std::uint32_t maxFrames)
+    : HTSIZE(htSize),
+      partitions(NUM_PARTITIONS),
+      maxFrames(maxFrames),
+      frameLinks(new FrameLink[maxFrames]) {
+  const std::size_t buckets = partitionBuckets(htSize);
+  for (Partition& part : partitions) {
+    part.buckets.assign(buckets, hashBucket{0, 0});
+    part.count = 0;
+  }
+  for (FrameId i = 0; i < maxFrames; i++) {
+    frameLinks[i] = FrameLink{NO_FRAME, NO_FRAME, 0};
+  }
+}
+
+std::mutex& BufHashTbl::partitionLatch(const File& file, const PageId pageNo) {
+  return partition(key(file, pageNo)).latch;
+}
+
+void BufHashTbl::resize(const int htSize) {
+  const std::size_t target = partitionBuckets(htSize);
+  for (Partition& part : partitions) {
+    std::lock_guard<std::mutex> guard(part.latch);
+    std::size_t buckets = target;
+    while (4 * part.count > 3 * buckets) buckets *= 2;
+    if (buckets != part.buckets.size()) rehash(part, buckets);
   }
+  HTSIZE = htSize;
+}
 
-  tmpBuc = std::make_shared<hashBucket>();
-  if (!tmpBuc) throw HashTableException();
+void BufHashTbl::grow(Partition& part) {
+  rehash(part, part.buckets.size() * 2);
+}
+
+void BufHashTbl::rehash(Partition& part, const std::size_t buckets) {
+  std::vector<hashBucket> old(buckets, hashBucket{0, 0});
+  old.swap(part.buckets);
+  const std::size_t mask = part.buckets.size() - 1;
+  for (const hashBucket& bucket : old) {
+    if (bucket.key == 0) continue;
+    std::size_t index = hash(bucket.key) & mask;
+    while (part.buckets[index].key != 0) index = (index + 1) & mask;
+    part.buckets[index] = bucket;
+  }
+}
 
-  tmpBuc->file = file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+void BufHashTbl::insert(const File& file, const PageId pageNo,
+                        const FrameId frameNo) {
+  const std::uint64_t k = key(file, pageNo);
+  Partition& part = partition(k);
+  if (4 * (part.count + 1) > 3 * part.buckets.size()) grow(part);
+
+  const std::size_t mask = part.buckets.size() - 1;
+  std::size_t index = hash(k) & mask;
+  while (part.buckets[index].key != 0) {
+    if (part.buckets[index].key == k)
+      throw HashAlreadyPresentException(file.filename(), pageNo,
+                                        part.buckets[index].frameNo);
+    index = (index + 1) & mask;
+  }
+  part.buckets[index].key = k;
+  part.buckets[index].frameNo = frameNo;
+  ++part.count;
+
+  // push the frame on the front of its file's list in this partition
+  auto head = part.fileHeads.try_emplace(file.id(), NO_FRAME).first;
+  frameLinks[frameNo].prev = NO_FRAME;
+  frameLinks[frameNo].next = head->second;
+  frameLinks[frameNo].pageNo = pageNo;
+  if (head->second != NO_FRAME) frameLinks[head->second].prev = frameNo;
+  head->second = frameNo;
 }
 
 void BufHashTbl::lookup(const File& file, const PageId pageNo,
                         FrameId& frameNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      frameNo = tmpBuc->frameNo;  // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  if (!tryLookup(file, pageNo, frameNo)) {
+    throw HashNotFoundException(file.filename(), pageNo);
   }
+}
 
-  throw HashNotFoundException(file.filename(), pageNo);
+bool BufHashTbl::tryLookup(const File& file, const PageId pageNo,
+                           FrameId& frameNo) {
+  const std::uint64_t k = key(file, pageNo);
+  Partition& part = partition(k);
+  const std::size_t mask = part.buckets.size() - 1;
+  for (std::size_t index = hash(k) & mask; part.buckets[index].key != 0;
+       index = (index + 1) & mask) {
+    if (part.buckets[index].key == k) {
+      frameNo = part.buckets[index].frameNo;  // return frameNo by reference
+      return true;
+    }
+  }
+  return false;
 }
 
 void BufHashTbl::remove(const File& file, const PageId pageNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  std::shared_ptr<hashBucket> prevBuc;
-
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (prevBuc)
-        prevBuc->next = tmpBuc->next;
-      else
-        ht[index] = tmpBuc->next;
-
-      tmpBuc.reset();
-      return;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  const std::uint64_t k = key(file, pageNo);
+  Partition& part = partition(k);
+  const std::size_t mask = part.buckets.size() - 1;
+  std::size_t index = hash(k) & mask;
+  while (part.buckets[index].key != k) {
+    if (part.buckets[index].key == 0)
+      throw HashNotFoundException(file.filename(), pageNo);
+    index = (index + 1) & mask;
+  }
+
+  // unlink the frame from its file's list in this partition
+  const FrameId frameNo = part.buckets[index].frameNo;
+  FrameLink& link = frameLinks[frameNo];
+  if (link.next != NO_FRAME) frameLinks[link.next].prev = link.prev;
+  if (link.prev != NO_FRAME) {
+    frameLinks[link.prev].next = link.next;
+  } else if (link.next != NO_FRAME) {
+    part.fileHeads[file.id()] = link.next;
+  } else {
+    part.fileHeads.erase(file.id());
+  }
+  link.prev = link.next = NO_FRAME;
+
+  // Backward-shift deletion: pull later entries of the probe run into the
+  // hole unless that would move them in front of their home bucket.
+  std::size_t hole = index;
+  for (std::size_t next = (hole + 1) & mask; part.buckets[next].key != 0;
+       next = (next + 1) & mask) {
+    const std::size_t home = hash(part.buckets[next].key) & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      part.buckets[hole] = part.buckets[next];
+      hole = next;
     }
   }
+  part.buckets[hole].key = 0;
+  --part.count;
+}
 
-  throw HashNotFoundException(file.filename(), pageNo);
+void BufHashTbl::filePages(const File& file,
+                           std::vector<std::pair<PageId, FrameId>>& pages) {
+  pages.clear();
+  for (Partition& part : partitions) {
+    std::lock_guard<std::mutex> guard(part.latch);
+    auto head = part.fileHeads.find(file.id());
+    if (head == part.fileHeads.end()) continue;
+    for (FrameId frameNo = head->second; frameNo != NO_FRAME;
+         frameNo = frameLinks[frameNo].next) {
+      pages.emplace_back(frameLinks[frameNo].pageNo, frameNo);
+    }
+  }
+  std::sort(pages.begin(), pages.end());
 }
 
 }  // namespace badgerdb
@@ -8,6 +8,11 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "file.h"
@@ -19,56 +24,183 @@ namespace badgerdb {
  */
 struct hashBucket {
   /**
-   * pointer a file object (more on this below)
+   * (file id, page number) packed by BufHashTbl::key(); 0 marks an empty
+   * bucket
    */
-  File file;
-
-  /**
-   * page number within a file
-   */
-  PageId pageNo;
+  std::uint64_t key;
 
   /**
    * frame number of page in the buffer pool
    */
   FrameId frameNo;
-
-  /**
-   * Next node in the hash table
-   */
-  std::shared_ptr<hashBucket> next;
 };
 
 /**
  * @brief Hash table class to keep track of pages in the buffer pool
  *
- * @warning This class is not threadsafe.
+ * An open-addressing table with linear probing, keyed on the file id and page
+ * number packed into one 64-bit integer.  Buckets are stored inline, so
+ * entries cost no heap allocation and a lookup touches one or two cache
+ * lines; deletion shifts the following entries back instead of leaving
+ * tombstones.
+ *
+ * The table is split into NUM_PARTITIONS partitions, each with its own bucket
+ * array and latch.  The table does no locking itself: callers must hold the
+ * latch returned by partitionLatch() for (file, pageNo) around insert(),
+ * lookup() and remove() of that entry.  Threads working on pages that fall
+ * into different partitions therefore never contend.  A partition doubles its
+ * bucket array when it becomes three quarters full.
+ *
+ * Next to the table, every partition threads the frames of each file it
+ * holds onto an intrusive doubly linked list, through links indexed by frame
+ * number.  The lists are guarded by the partition latch that insert() and
+ * remove() already run under, so keeping them costs no extra latch and no
+ * allocation per page, and the pages of one file are listed in time
+ * proportional to their number rather than to the size of the pool.
  */
 class BufHashTbl {
+ public:
+  /**
+   * Number of independently latched partitions.
+   */
+  static const int NUM_PARTITIONS = 128;
+
  private:
   /**
-   *	Size of Hash Table
+   * @brief One independently latched open-addressing table.
+   */
+  struct Partition {
+    /**
+     * Latch guarding this partition
+     */
+    std::mutex latch;
+
+    /**
+     * Buckets; the size is always a power of two
+     */
+    std::vector<hashBucket> buckets;
+
+    /**
+     * Number of occupied buckets
+     */
+    std::uint32_t count;
+
+    /**
+     * First frame of the list of each file with pages in this partition
+     */
+    std::unordered_map<FileId, FrameId> fileHeads;
+  };
+
+  /**
+   * @brief Links of a frame in the frame list of its file.
+   */
+  struct FrameLink {
+    /**
+     * Previous frame of the same file and partition, or NO_FRAME
+     */
+    FrameId prev;
+
+    /**
+     * Next frame of the same file and partition, or NO_FRAME
+     */
+    FrameId next;
+
+    /**
+     * Page held by the frame
+     */
+    PageId pageNo;
+  };
+
+  /**
+   * Marks the end of a frame list.
+   */
+  static constexpr FrameId NO_FRAME = UINT32_MAX;
+
+  /**
+   *	Size of Hash Table (number of entries it is sized for)
    */
   int HTSIZE;
+
   /**
    * Actual Hash table object
    */
-  std::vector<std::shared_ptr<hashBucket>> ht;
+  std::vector<Partition> partitions;
 
   /**
-   * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+   * Number of frames the buffer pool can grow to
+   */
+  std::uint32_t maxFrames;
+
+  /**
+   * File list links of each frame, guarded by the latch of the partition
+   * holding the frame's page
+   */
+  std::unique_ptr<FrameLink[]> frameLinks;
+
+  /**
+   * returns a well-mixed 64-bit hash of a packed key.  The top bits select
+   * the partition and the low bits the bucket within it.
    *
-   * @param file   	File object
-   * @param pageNo  Page number in the file
+   * @param key     Packed (file, pageNo) key
    * @return  			Hash value.
    */
-  int hash(const File& file, const PageId pageNo);
+  static std::uint64_t hash(const std::uint64_t key);
+
+  /**
+   * Returns the partition holding the given key.
+   */
+  Partition& partition(const std::uint64_t key);
+
+  /**
+   * Doubles the bucket array of a partition and reinserts its entries.
+   */
+  static void grow(Partition& part);
+
+  /**
+   * Replaces the bucket array of a partition with one of the given size and
+   * reinserts its entries.
+   */
+  static void rehash(Partition& part, std::size_t buckets);
 
  public:
   /**
    * Constructor of BufHashTbl class
+   *
+   * @param htSize    Number of entries the table should hold without growing
+   * @param maxFrames Number of frames the buffer pool can grow to; frame
+   * numbers inserted must be below it
+   */
+  BufHashTbl(const int htSize, const std::uint32_t maxFrames);  // constructor
+
+  /**
+   * Resizes the table for a new number of entries.  Partitions are rehashed
+   * one at a time, each under its own latch, so lookups in the other
+   * partitions carry on meanwhile.  A partition never shrinks below what its
+   * current entries need.
+   *
+   * @param htSize  Number of entries the table should hold without growing
+   */
+  void resize(const int htSize);
+
+  /**
+   * Packs a file id and page number into a hash table key.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @return  			Key, never 0 for a valid file.
    */
-  BufHashTbl(const int htSize);  // constructor
+  static std::uint64_t key(const File& file, const PageId pageNo) {
+    return (static_cast<std::uint64_t>(file.id()) << 32) | pageNo;
+  }
+
+  /**
+   * Returns the latch of the partition holding (file, pageNo).
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @return  			Latch to hold while accessing that entry.
+   */
+  std::mutex& partitionLatch(const File& file, const PageId pageNo);
 
   /**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
@@ -95,6 +227,17 @@ class BufHashTbl {
    */
   void lookup(const File& file, const PageId pageNo, FrameId& frameNo);
 
+  /**
+   * Check if (file, pageNo) is currently in the buffer pool, without
+   * throwing on a miss.
+   *
+   * @param file  	File object
+   * @param pageNo	Page number in the file
+   * @param frameNo Frame number reference, set only if the page is found
+   * @return  True if the page entry was found.
+   */
+  bool tryLookup(const File& file, const PageId pageNo, FrameId& frameNo);
+
   /**
    * Delete entry (file,pageNo) from hash table.
    *
@@ -104,6 +247,18 @@ class BufHashTbl {
    * table
    */
   void remove(const File& file, const PageId pageNo);
+
+  /**
+   * Lists the pages of a file that are in the hash table, in ascending page
+   * order, with their frames.  Takes each partition latch in turn and must
+   * be called without holding any; the list is a snapshot, and entries may
+   * come and go as soon as it is taken.
+   *
+   * @param file   	File object
+   * @param pages   Set to the (page number, frame number) pairs
+   */
+  void filePages(const File& file,
+                 std::vector<std::pair<PageId, FrameId>>& pages);
 };
 
 }  // namespace badgerdb
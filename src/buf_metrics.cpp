@@ -0,0 +1,326 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "buf_metrics.h"
+
+#include <cmath>
+#include <iomanip>
+
+#include "file.h"
+
+namespace badgerdb {
+
+namespace {
+
+// Values below 2 * SUB_BUCKETS get a bucket each.
+const int SUB_BITS = 3;
+const int SUB_BUCKETS = 1 << SUB_BITS;
+
+const int NUM_OPS = static_cast<int>(BufOp::NUM_OPS);
+const int NUM_COUNTERS = static_cast<int>(BufCounter::NUM_COUNTERS);
+
+const char *const OP_NAMES[NUM_OPS] = {"readPage",  "allocPage", "unPinPage",
+                                       "flushFile", "allocBuf",  "pin wait"};
+
+std::atomic<std::uint64_t> next_instance(1);
+
+// Counters of a shard have a single writer, so a plain load and store is
+// enough; snapshots read them concurrently.
+inline void add(std::atomic<std::uint64_t> &counter, std::uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n,
+                std::memory_order_relaxed);
+}
+
+inline std::uint64_t get(const std::atomic<std::uint64_t> &counter) {
+  return counter.load(std::memory_order_relaxed);
+}
+
+}  // namespace
+
+int Histogram::bucketOf(const std::uint64_t value) {
+  if (value < 2 * SUB_BUCKETS) {
+    return static_cast<int>(value);
+  }
+  const int exponent = 63 - __builtin_clzll(value);
+  const int sub = (value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1);
+  return 2 * SUB_BUCKETS + (exponent - SUB_BITS - 1) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t Histogram::bucketLimit(const int bucket) {
+  if (bucket < 2 * SUB_BUCKETS) {
+    return bucket;
+  }
+  const int exponent = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + SUB_BITS + 1;
+  const std::uint64_t sub = (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+  const std::uint64_t width = std::uint64_t(1) << (exponent - SUB_BITS);
+  return ((SUB_BUCKETS + sub) << (exponent - SUB_BITS)) + (width - 1);
+}
+
+std::uint64_t Histogram::count() const {
+  std::uint64_t total = 0;
+  for (std::uint64_t c : counts_) total += c;
+  return total;
+}
+
+double Histogram::mean() const {
+  const std::uint64_t n = count();
+  return n == 0 ? 0.0 : static_cast<double>(sum_) / n;
+}
+
+std::uint64_t Histogram::percentile(const double p) const {
+  const std::uint64_t n = count();
+  if (n == 0) return 0;
+  std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(p / 100 * n));
+  if (rank == 0) rank = 1;
+  std::uint64_t seen = 0;
+  for (int b = 0; b < NUM_BUCKETS; b++) {
+    seen += counts_[b];
+    if (seen >= rank) return bucketLimit(b);
+  }
+  return bucketLimit(NUM_BUCKETS - 1);
+}
+
+Histogram &Histogram::operator-=(const Histogram &rhs) {
+  for (int b = 0; b < NUM_BUCKETS; b++) {
+    counts_[b] -= rhs.counts_[b];
+  }
+  sum_ -= rhs.sum_;
+  return *this;
+}
+
+BufMetrics::Snapshot BufMetrics::Snapshot::operator-(
+    const Snapshot &earlier) const {
+  Snapshot diff = *this;
+  for (int op = 0; op < NUM_OPS; op++) {
+    diff.latency[op] -= earlier.latency[op];
+  }
+  diff.sweep -= earlier.sweep;
+  diff.cleanEvictions -= earlier.cleanEvictions;
+  diff.dirtyEvictions -= earlier.dirtyEvictions;
+  for (int c = 0; c < NUM_COUNTERS; c++) {
+    diff.counts[c] -= earlier.counts[c];
+  }
+  for (const auto &entry : earlier.files) {
+    auto it = diff.files.find(entry.first);
+    if (it == diff.files.end()) continue;
+    it->second.hits -= entry.second.hits;
+    it->second.misses -= entry.second.misses;
+    if (it->second.hits == 0 && it->second.misses == 0) diff.files.erase(it);
+  }
+  return diff;
+}
+
+void BufMetrics::Snapshot::dump(std::ostream &os) const {
+  os << "accesses " << count(BufCounter::ACCESSES) << ", hits "
+     << count(BufCounter::HITS) << ", misses " << count(BufCounter::MISSES)
+     << ", disk reads " << count(BufCounter::DISKREADS) << ", disk writes "
+     << count(BufCounter::DISKWRITES) << "\n";
+  os << "evictions " << cleanEvictions + dirtyEvictions << " (" << dirtyEvictions
+     << " dirty)\n";
+
+  os << std::left << std::setw(12) << "latency ns" << std::right
+     << std::setw(10) << "count" << std::setw(10) << "mean" << std::setw(10)
+     << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+     << std::setw(10) << "p99.9" << std::setw(10) << "max"
+     << "\n";
+  auto row = [&os](const char *name, const Histogram &h) {
+    os << std::left << std::setw(12) << name << std::right << std::setw(10)
+       << h.count() << std::setw(10) << static_cast<std::uint64_t>(h.mean())
+       << std::setw(10) << h.percentile(50) << std::setw(10)
+       << h.percentile(90) << std::setw(10) << h.percentile(99)
+       << std::setw(10) << h.percentile(99.9) << std::setw(10) << h.max()
+       << "\n";
+  };
+  for (int op = 0; op < NUM_OPS; op++) {
+    row(OP_NAMES[op], latency[op]);
+  }
+  row("sweep", sweep);
+
+  if (files.empty()) return;
+  os << std::left << std::setw(24) << "file" << std::right << std::setw(10)
+     << "hits" << std::setw(10) << "misses" << std::setw(10) << "hit %"
+     << "\n";
+  for (const auto &entry : files) {
+    const FileCounts &counts = entry.second;
+    const std::uint64_t total = counts.hits + counts.misses;
+    os << std::left << std::setw(24) << counts.filename << std::right
+       << std::setw(10) << counts.hits << std::setw(10) << counts.misses
+       << std::setw(10) << std::fixed << std::setprecision(1)
+       << (total == 0 ? 0.0 : 100.0 * counts.hits / total) << "\n";
+  }
+}
+
+/**
+ * Counters of one thread.  Zero-initialized by new Shard().
+ */
+struct BufMetrics::Shard {
+  /**
+   * Files whose hits and misses are kept apart; the rest are counted
+   * together under file ID 0.
+   */
+  static const int FILE_SLOTS = 64;
+
+  struct FileSlot {
+    // set last, once filename is in place
+    std::atomic<FileId> id;
+    std::string filename;
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+  };
+
+  std::atomic<std::uint64_t> counts[NUM_COUNTERS];
+  std::atomic<std::uint64_t> latency[NUM_OPS][Histogram::NUM_BUCKETS];
+  std::atomic<std::uint64_t> latency_sum[NUM_OPS];
+  std::atomic<std::uint64_t> sweep[Histogram::NUM_BUCKETS];
+  std::atomic<std::uint64_t> sweep_sum;
+  std::atomic<std::uint64_t> clean_evictions;
+  std::atomic<std::uint64_t> dirty_evictions;
+  FileSlot files[FILE_SLOTS];
+  std::atomic<std::uint64_t> other_hits;
+  std::atomic<std::uint64_t> other_misses;
+};
+
+BufMetrics::BufMetrics()
+    : instance_(next_instance++), enabled_(false), baseline_(new Snapshot()) {}
+
+BufMetrics::~BufMetrics() {}
+
+BufMetrics::Shard *BufMetrics::localShard() noexcept {
+  thread_local std::uint64_t cached_instance = 0;
+  thread_local Shard *cached_shard = nullptr;
+  if (cached_instance == instance_) {
+    return cached_shard;
+  }
+  try {
+    std::lock_guard<std::mutex> guard(shards_mutex_);
+    // A thread that reuses the ID of one that has exited takes over its shard.
+    Shard *&shard = thread_shards_[std::this_thread::get_id()];
+    if (shard == nullptr) {
+      std::unique_ptr<Shard> created(new Shard());
+      shards_.push_back(std::move(created));
+      shard = shards_.back().get();
+    }
+    cached_instance = instance_;
+    cached_shard = shard;
+    return shard;
+  } catch (...) {
+    // nothing is recorded; the next call tries again
+    return nullptr;
+  }
+}
+
+void BufMetrics::record(const BufOp op, const std::uint64_t nanos) noexcept {
+  if (!enabled()) return;
+  Shard *const shard = localShard();
+  if (shard == nullptr) return;
+  const int o = static_cast<int>(op);
+  add(shard->latency[o][Histogram::bucketOf(nanos)], 1);
+  add(shard->latency_sum[o], nanos);
+}
+
+void BufMetrics::count(const BufCounter counter,
+                       const std::uint64_t n) noexcept {
+  Shard *const shard = localShard();
+  if (shard == nullptr) return;
+  add(shard->counts[static_cast<int>(counter)], n);
+}
+
+std::uint64_t BufMetrics::counter(const BufCounter counter) const {
+  const int c = static_cast<int>(counter);
+  std::lock_guard<std::mutex> guard(shards_mutex_);
+  std::uint64_t total = 0;
+  for (const std::unique_ptr<Shard> &shard : shards_) {
+    total += get(shard->counts[c]);
+  }
+  return total - baseline_->counts[c];
+}
+
+void BufMetrics::recordSweep(const std::uint32_t frames) {
+  if (!enabled()) return;
+  Shard *const shard = localShard();
+  if (shard == nullptr) return;
+  add(shard->sweep[Histogram::bucketOf(frames)], 1);
+  add(shard->sweep_sum, frames);
+}
+
+void BufMetrics::recordEviction(const bool dirty) {
+  if (!enabled()) return;
+  Shard *const shard = localShard();
+  if (shard == nullptr) return;
+  add(dirty ? shard->dirty_evictions : shard->clean_evictions, 1);
+}
+
+void BufMetrics::recordAccess(const File &file, const bool hit) {
+  if (!enabled()) return;
+  Shard *const shard = localShard();
+  if (shard == nullptr) return;
+  const FileId id = file.id();
+  for (int probe = 0; probe < Shard::FILE_SLOTS; probe++) {
+    Shard::FileSlot &slot = shard->files[(id + probe) % Shard::FILE_SLOTS];
+    FileId slot_id = slot.id.load(std::memory_order_relaxed);
+    if (slot_id == 0) {
+      slot.filename = file.filename();
+      slot.id.store(id, std::memory_order_release);
+      slot_id = id;
+    }
+    if (slot_id == id) {
+      add(hit ? slot.hits : slot.misses, 1);
+      return;
+    }
+  }
+  add(hit ? shard->other_hits : shard->other_misses, 1);
+}
+
+BufMetrics::Snapshot BufMetrics::total() const {
+  Snapshot total;
+  for (const std::unique_ptr<Shard> &shard : shards_) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+      total.counts[c] += get(shard->counts[c]);
+    }
+    for (int op = 0; op < NUM_OPS; op++) {
+      Histogram &h = total.latency[op];
+      for (int b = 0; b < Histogram::NUM_BUCKETS; b++) {
+        h.counts_[b] += get(shard->latency[op][b]);
+      }
+      h.sum_ += get(shard->latency_sum[op]);
+    }
+    for (int b = 0; b < Histogram::NUM_BUCKETS; b++) {
+      total.sweep.counts_[b] += get(shard->sweep[b]);
+    }
+    total.sweep.sum_ += get(shard->sweep_sum);
+    total.cleanEvictions += get(shard->clean_evictions);
+    total.dirtyEvictions += get(shard->dirty_evictions);
+    for (const Shard::FileSlot &slot : shard->files) {
+      const FileId id = slot.id.load(std::memory_order_acquire);
+      if (id == 0) continue;
+      FileCounts &counts = total.files[id];
+      counts.filename = slot.filename;
+      counts.hits += get(slot.hits);
+      counts.misses += get(slot.misses);
+    }
+    if (get(shard->other_hits) + get(shard->other_misses) != 0) {
+      FileCounts &counts = total.files[0];
+      counts.filename = "(other files)";
+      counts.hits += get(shard->other_hits);
+      counts.misses += get(shard->other_misses);
+    }
+  }
+  return total;
+}
+
+BufMetrics::Snapshot BufMetrics::snapshot() const {
+  std::lock_guard<std::mutex> guard(shards_mutex_);
+  return total() - *baseline_;
+}
+
+void BufMetrics::reset() {
+  std::lock_guard<std::mutex> guard(shards_mutex_);
+  baseline_.reset(new Snapshot(total()));
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,332 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+class File;
+
+/**
+ * Buffer manager operations whose latency is recorded.  PIN_WAIT is the time
+ * a hit spends waiting for another thread to finish reading or writing the
+ * page.
+ */
+enum class BufOp {
+  READ_PAGE,
+  ALLOC_PAGE,
+  UNPIN_PAGE,
+  FLUSH_FILE,
+  ALLOC_BUF,
+  PIN_WAIT,
+  NUM_OPS
+};
+
+/**
+ * Buffer manager counters, kept per thread by BufMetrics::count().
+ */
+enum class BufCounter {
+  ACCESSES,           // accesses to the buffer pool
+  DISKREADS,          // pages read from disk (including allocs)
+  DISKWRITES,         // pages written back to disk
+  WRITE_CALLS,        // write requests the pages written back took
+  HITS,               // readPage calls that found the page in the pool
+  MISSES,             // readPage calls that had to read the page from disk
+  CLEANER_WRITES,     // dirty pages written back by the background cleaner
+  CLEANER_FREES,      // frames emptied by the background cleaner
+  RESERVE_HITS,       // frames allocated from the free-frame reserve
+  RESERVE_MISSES,     // allocations that found the reserve empty
+  CHECKPOINT_WRITES,  // dirty pages written back by checkpoints
+  READ_RUNS,          // runs of pages readPages() read with one request
+  RING_REUSES,        // frames recycled from an access strategy ring
+  PREFETCHES,         // pages read ahead of a request
+  PREFETCH_HITS,      // readPage calls served by a page read ahead
+  NUM_COUNTERS
+};
+
+/**
+ * @brief Log-linear histogram of non-negative values.
+ *
+ * Values below 16 get a bucket each; above that every power of two is split
+ * into 8 buckets, so a value is known to within 12.5% over the whole 64-bit
+ * range, in the manner of an HDR histogram.  Histograms of the same kind can
+ * be subtracted to get the values recorded in between.
+ */
+class Histogram {
+ public:
+  /**
+   * Number of buckets.
+   */
+  static const int NUM_BUCKETS = 496;
+
+  Histogram() : counts_{}, sum_(0) {}
+
+  /**
+   * Returns the bucket a value falls in.
+   */
+  static int bucketOf(std::uint64_t value);
+
+  /**
+   * Returns the largest value that falls in a bucket.
+   */
+  static std::uint64_t bucketLimit(int bucket);
+
+  /**
+   * Records one value.
+   */
+  void record(std::uint64_t value) {
+    counts_[bucketOf(value)]++;
+    sum_ += value;
+  }
+
+  /**
+   * Returns the number of values recorded.
+   */
+  std::uint64_t count() const;
+
+  /**
+   * Returns the mean of the values recorded, or 0 if there are none.
+   */
+  double mean() const;
+
+  /**
+   * Returns an upper bound of the given percentile (0 to 100) of the values
+   * recorded, or 0 if there are none.
+   */
+  std::uint64_t percentile(double p) const;
+
+  /**
+   * Returns an upper bound of the largest value recorded.
+   */
+  std::uint64_t max() const { return percentile(100); }
+
+  /**
+   * Removes the values of an earlier snapshot of the same histogram.
+   */
+  Histogram &operator-=(const Histogram &rhs);
+
+ private:
+  friend class BufMetrics;
+
+  std::array<std::uint64_t, NUM_BUCKETS> counts_;
+  std::uint64_t sum_;
+};
+
+/**
+ * @brief Detailed instrumentation of a buffer manager.
+ *
+ * Keeps the buffer manager counters, and records latency histograms per
+ * operation, the number of frames the replacement policy examined per
+ * eviction, clean and dirty evictions, and hits and misses per file.  Every
+ * thread records into a shard of its own with plain relaxed loads and
+ * stores, so recording never contends with other threads; snapshot() adds
+ * the shards up.  The counters are always kept.  Everything else is off
+ * until setEnabled() turns it on, so a disabled recorder costs one load of
+ * the flag.
+ */
+class BufMetrics {
+ public:
+  /**
+   * Hits and misses of one file.
+   */
+  struct FileCounts {
+    std::string filename;
+    std::uint64_t hits = 0;
+    std::uint64_t misses = 0;
+  };
+
+  /**
+   * @brief Metrics at one point in time, or the difference of two snapshots.
+   */
+  struct Snapshot {
+    /**
+     * Latency in nanoseconds, by operation
+     */
+    Histogram latency[static_cast<int>(BufOp::NUM_OPS)];
+
+    /**
+     * Frames the replacement policy examined per eviction
+     */
+    Histogram sweep;
+
+    /**
+     * Pages evicted by the replacement policy without and with a write
+     */
+    std::uint64_t cleanEvictions = 0;
+    std::uint64_t dirtyEvictions = 0;
+
+    /**
+     * Buffer manager counters, by BufCounter
+     */
+    std::uint64_t counts[static_cast<int>(BufCounter::NUM_COUNTERS)] = {};
+
+    /**
+     * Returns one of the counters.
+     */
+    std::uint64_t count(BufCounter counter) const {
+      return counts[static_cast<int>(counter)];
+    }
+
+    /**
+     * Hits and misses by file
+     */
+    std::map<FileId, FileCounts> files;
+
+    /**
+     * Returns what was recorded between an earlier snapshot and this one.
+     */
+    Snapshot operator-(const Snapshot &earlier) const;
+
+    /**
+     * Writes the snapshot as a table of text.
+     */
+    void dump(std::ostream &os) const;
+  };
+
+  /**
+   * @brief Records the latency of one operation when it goes out of scope.
+   */
+  class Timer {
+   public:
+    Timer(BufMetrics &metrics, BufOp op)
+        : metrics_(metrics.enabled() ? &metrics : nullptr), op_(op) {
+      if (metrics_ != nullptr) start_ = std::chrono::steady_clock::now();
+    }
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+    ~Timer() {
+      if (metrics_ == nullptr) return;
+      metrics_->record(
+        op_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - start_)
+                 .count());
+    }
+
+   private:
+    BufMetrics *metrics_;
+    BufOp op_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  BufMetrics();
+  ~BufMetrics();
+
+  BufMetrics(const BufMetrics &) = delete;
+  BufMetrics &operator=(const BufMetrics &) = delete;
+
+  /**
+   * Returns whether latencies and the other detailed metrics are being
+   * recorded.
+   */
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * Turns recording of latencies and the other detailed metrics on or off.
+   * The BufCounter counters are always kept.
+   */
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+
+  /**
+   * Records the latency of an operation, in nanoseconds, if enabled.  Never
+   * throws.
+   */
+  void record(BufOp op, std::uint64_t nanos) noexcept;
+
+  /**
+   * Adds to one of the counters.  Never throws.
+   */
+  void count(BufCounter counter, std::uint64_t n = 1) noexcept;
+
+  /**
+   * Returns the current value of one of the counters, since construction or
+   * the last reset().
+   */
+  std::uint64_t counter(BufCounter counter) const;
+
+  /**
+   * Records the number of frames examined to find one victim, if enabled.
+   */
+  void recordSweep(std::uint32_t frames);
+
+  /**
+   * Records a page evicted by the replacement policy, if enabled.
+   *
+   * @param dirty   True if the page had to be written back first.
+   */
+  void recordEviction(bool dirty);
+
+  /**
+   * Records a hit or a miss on a page of a file, if enabled.
+   */
+  void recordAccess(const File &file, bool hit);
+
+  /**
+   * Returns the metrics recorded since construction or the last reset().
+   */
+  Snapshot snapshot() const;
+
+  /**
+   * Starts the metrics over.  Threads may keep recording meanwhile.
+   */
+  void reset();
+
+ private:
+  struct Shard;
+
+  /**
+   * Returns the calling thread's shard, creating it on first use, or null if
+   * it could not be created.  Never throws, so that recording is safe on the
+   * noexcept unpin path of PinnedPage.
+   */
+  Shard *localShard() noexcept;
+
+  /**
+   * Adds up the shards.
+   */
+  Snapshot total() const;
+
+  /**
+   * Distinguishes this object from any other one that was at the same address
+   * before, for the per-thread shard cache.
+   */
+  const std::uint64_t instance_;
+
+  std::atomic<bool> enabled_;
+
+  /**
+   * Shards of all threads that have recorded, and their owners.  Guarded by
+   * shards_mutex_.
+   */
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::unordered_map<std::thread::id, Shard *> thread_shards_;
+
+  /**
+   * Totals at the last reset(), subtracted from snapshots.  Guarded by
+   * shards_mutex_.
+   */
+  std::unique_ptr<Snapshot> baseline_;
+
+  mutable std::mutex shards_mutex_;
+};
+
+}  // namespace badgerdb
@@ -8,14 +8,23 @@
 
 #include "buffer.h"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <utility>
 
 #include "exceptions/bad_buffer_exception.h"
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/hash_already_present_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include "exceptions/read_only_file_exception.h"
+#include "hot_page_list.h"
 
 namespace badgerdb {
 
@@ -25,60 +34,264 @@ constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
+BufMgr::BufMgr(std::uint32_t bufs, ReplacementPolicyType policyType,
+               std::uint32_t maxBufs)
     : numBufs(bufs),
-      hashTable(HASHTABLE_SZ(bufs)),
-      bufDescTable(bufs),
-      bufPool(bufs) {
-  for (FrameId i = 0; i < bufs; i++) {
+      hashTable(HASHTABLE_SZ(bufs), std::max(bufs, maxBufs)),
+      bufDescTable(std::max(bufs, maxBufs)),
+      arena(bufs, true, maxBufs),
+      policy(ReplacementPolicy::create(policyType, bufs, maxBufs)),
+      ioEngine(IoEngine::create(IoEngineType::AUTO)),
+      onFreeList(std::max(bufs, maxBufs), false),
+      cleanerRunning(false),
+      cleanerStop(false),
+      lowWater(0),
+      highWater(0),
+      readAheadWindow(0),
+      prefetchActive(0),
+      prefetchStop(false),
+      dirtyClock(0),
+      checkpointsRequested(0),
+      checkpointStop(false),
+      bufPool(arena.pages()) {
+  for (FrameId i = 0; i < bufDescTable.size(); i++) {
     bufDescTable[i].frameNo = i;
     bufDescTable[i].valid = false;
   }
 
-  clockHand = bufs - 1;
+  bufStats.policy = policy->name();
+  bufStats.poolBacking = PageArena::backingName(arena.backing());
+  bufStats.ioEngine = ioEngine->name();
 }
 
-/**
- * @brief Advance clock to next frame in the buffer pool.
- *
- */
-void BufMgr::advanceClock() {
-  clockHand = (clockHand+1);
-  // make it circlular
-  clockHand = clockHand % numBufs;
+BufMgr::~BufMgr() {
+  if (!hotPagesFile.empty()) {
+    try {
+      dumpHotPages(hotPagesFile);
+    } catch (const BadgerDbException& e) {
+      std::cerr << e.message() << "\n";
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(prefetchLatch);
+    prefetchStop = true;
+    prefetchQueue.clear();
+  }
+  prefetchWakeup.notify_one();
+  if (prefetcher.joinable()) prefetcher.join();
+  {
+    std::lock_guard<std::mutex> guard(checkpointLatch);
+    checkpointStop = true;
+  }
+  checkpointWakeup.notify_one();
+  if (checkpointer.joinable()) checkpointer.join();
+  stopCleaner();
+}
+
+bool BufMgr::tryClaim(FrameId frame) {
+  BufDesc& desc = bufDescTable[frame];
+  if (frame >= numBufs || desc.pinCnt.load() != 0 || !desc.latch.try_lock()) {
+    return false;
+  }
+  // checked again under the latch: resize() retires frames and then latches
+  // each of them to drain it
+  if (desc.pinCnt.load() != 0 || frame >= numBufs) {
+    desc.latch.unlock();
+    return false;
+  }
+  return true;
 }
 
 /**
  * @brief Allocates the buffer
- * 
+ *
+ * The replacement policy proposes victims and claims one through tryClaim().
+ * Frames whose latch is held by another thread are skipped, so any number of
+ * threads can look for victims at once.  A caller with a BufferRing recycles
+ * the ring's frames once it has filled it.
+ *
  * @param frame is the frame to allocate
+ * @param key is the key of the page the frame is wanted for
+ * @param ring is the caller's access strategy ring, or null
  */
-void BufMgr::allocBuf(FrameId &frame)
+void BufMgr::allocBuf(FrameId &frame, std::uint64_t key, BufferRing* ring)
 {
-  int cnt = 0;
-  for (int i = cnt; i <= numBufs; i++)
-  {
-    if(bufDescTable[clockHand].valid && bufDescTable[clockHand].refbit) {
-      bufDescTable[clockHand].refbit = false; //set it to false
-      advanceClock();
-    } else if (bufDescTable[clockHand].valid && bufDescTable[clockHand].pinCnt != 0) { //check two conditions
-      advanceClock();
-      cnt++;
-    } else if (bufDescTable[clockHand].valid && bufDescTable[clockHand].pinCnt == 0 && bufDescTable[clockHand].dirty) {
-      frame = clockHand;
-      flushFile(bufDescTable[clockHand].file);
-      return;
-    } else if (bufDescTable[clockHand].valid && bufDescTable[clockHand].pinCnt == 0 && !bufDescTable[clockHand].dirty) { //check dirty bit
-      hashTable.remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-      frame = clockHand;
-      return;
-    } else {
-      frame = clockHand;
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::ALLOC_BUF);
+  if (ring != nullptr && claimFromRing(*ring, frame)) {
+    bufStats.metrics.count(BufCounter::RING_REUSES);
+    return;
+  }
+
+  if (cleanerRunning.load(std::memory_order_relaxed)) {
+    if (popFree(frame)) {
+      bufStats.metrics.count(BufCounter::RESERVE_HITS);
       return;
     }
+    bufStats.metrics.count(BufCounter::RESERVE_MISSES);
+  }
+
+  // frames the policy offered before one could be used
+  std::uint32_t examined = 0;
+  for (std::uint32_t i = 0; i <= numBufs; i++)
+  {
+    FrameId id;
+    if (!policy->pickVictim(
+            key,
+            [this, &examined](FrameId f) {
+              examined++;
+              return tryClaim(f);
+            },
+            id)) {
+      break;
+    }
+    BufDesc& desc = bufDescTable[id];
+    if (desc.valid) {
+      // write back only the victim if it is dirty; the rest of its file
+      // stays cached
+      bool evicted;
+      try {
+        evicted = evictFrame(id, true);
+      } catch (...) {
+        desc.latch.unlock();
+        throw;
+      }
+      if (!evicted) {
+        // pinned since it was claimed
+        desc.latch.unlock();
+        continue;
+      }
+      bufStats.metrics.recordSweep(examined);
+    }
+    frame = id;
+    return;
   }
   throw BufferExceededException();
 }
+
+/**
+ * @brief Claims the frame a ring would recycle next
+ *
+ * The frame is only taken back if it still holds the page the ring put in
+ * it; a frame the shared pool has since given to another page is left
+ * alone, and the ring gets a new frame from the policy in its place.
+ *
+ * @param ring is the caller's access strategy ring
+ * @param frame is set to the frame, returned latched exclusively
+ * @return false if the ring has no frame to recycle at this position
+ */
+bool BufMgr::claimFromRing(BufferRing& ring, FrameId& frame) {
+  const BufferRing::Slot& slot = ring.slots[ring.next];
+  if (slot.frame >= numBufs || !tryClaim(slot.frame)) {
+    return false;
+  }
+  BufDesc& desc = bufDescTable[slot.frame];
+  if (desc.valid) {
+    bool evicted = false;
+    if (BufHashTbl::key(*desc.file, desc.pageNo) == slot.key) {
+      try {
+        evicted = evictFrame(slot.frame, true);
+      } catch (...) {
+        desc.latch.unlock();
+        throw;
+      }
+    }
+    if (!evicted) {
+      desc.latch.unlock();
+      return false;
+    }
+  }
+  frame = slot.frame;
+  return true;
+}
+
+/**
+ * @brief Removes the page in a latched, valid frame from the pool
+ *
+ * The frame stays in the hash table, marked invalid, while a dirty page is
+ * written back, so a thread that pins it meanwhile waits for the write and
+ * then reads the page from disk again instead of reading a stale copy.
+ *
+ * @param id is the frame, whose latch the caller holds exclusively
+ * @param evicted is true if the frame was chosen by the replacement policy
+ * @param written if not null, set to whether the page had to be written
+ * @return false if the frame is pinned, in which case nothing was done
+ */
+bool BufMgr::evictFrame(FrameId id, const bool evicted, bool* written) {
+  BufDesc& desc = bufDescTable[id];
+  {
+    std::lock_guard<std::mutex> guard(
+        hashTable.partitionLatch(*desc.file, desc.pageNo));
+    if (desc.pinCnt.load() != 0) {
+      return false;
+    }
+    desc.valid = false;
+  }
+
+  //if the page is dirty, write it back to disk
+  if (desc.dirty) {
+    try {
+      desc.file->writePage(bufPool[id]);
+    } catch (...) {
+      desc.valid = true;
+      throw;
+    }
+    bufStats.metrics.count(BufCounter::DISKWRITES);
+    bufStats.metrics.count(BufCounter::WRITE_CALLS);
+    if (evicted) bufStats.metrics.recordEviction(true);
+    desc.dirty = false;
+    if (written != nullptr) *written = true;
+  } else {
+    if (evicted) bufStats.metrics.recordEviction(false);
+    if (written != nullptr) *written = false;
+  }
+
+  //remove the page from the hashtable
+  {
+    std::lock_guard<std::mutex> guard(
+        hashTable.partitionLatch(*desc.file, desc.pageNo));
+    hashTable.remove(*desc.file, desc.pageNo);
+  }
+  policy->recordRemove(id, BufHashTbl::key(*desc.file, desc.pageNo), evicted);
+
+  //clear it from BufDesc
+  desc.clear();
+  return true;
+}
+
+bool BufMgr::pinResident(const File& file, const PageId pageNo,
+                         FrameId& frame) {
+  for (;;) {
+    FrameId id;
+    {
+      std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, pageNo));
+      if (!hashTable.tryLookup(file, pageNo, id)) return false;
+      bufDescTable[id].pinCnt++;
+    }
+    BufDesc& desc = bufDescTable[id];
+    if (!desc.valid.load(std::memory_order_acquire)) {
+      // the page is being read in or written out; wait for that I/O
+      BufMetrics::Timer wait(bufStats.metrics, BufOp::PIN_WAIT);
+      desc.latch.lock_shared();
+      const bool loaded = desc.valid.load(std::memory_order_acquire) &&
+                          desc.pageNo == pageNo && desc.fileId == file.id();
+      desc.latch.unlock_shared();
+      if (!loaded) {
+        // the read failed, or the page was evicted and the frame may already
+        // hold another page; look it up again
+        desc.pinCnt--;
+        continue;
+      }
+    }
+    policy->recordAccess(id);
+    if (desc.prefetched.load(std::memory_order_relaxed) &&
+        desc.prefetched.exchange(false)) {
+      bufStats.metrics.count(BufCounter::PREFETCH_HITS);
+    }
+    frame = id;
+    return true;
+  }
+}
+
 /**
  * @brief the page and need to check if the page is existed in buffer pool already, if yes, just update the pinCount and refbit
  * if not, allocate a new frame, save it in buffer pool and update the hashtable
@@ -87,29 +300,521 @@ void BufMgr::allocBuf(FrameId &frame)
  * @param PageNo    Page number
  * @param page  	page object need to return the page pointer to the place where page saved in buffer pointer
  */
-void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
-  FrameId id;  
-  try{
+void BufMgr::readPage(File& file, const PageId pageNo, Page*& page,
+                      BufferRing* ring) {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::READ_PAGE);
+  page = &bufPool[fetchFrame(file, pageNo, ring)];
+}
+
+PinnedPage BufMgr::readPage(File& file, const PageId pageNo,
+                            BufferRing* ring) {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::READ_PAGE);
+  const FrameId frame = fetchFrame(file, pageNo, ring);
+  return PinnedPage(this, frame, pageNo);
+}
+
+bool BufMgr::readPageIfResident(File& file, const PageId pageNo,
+                                Page*& page) {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::READ_PAGE);
+  FrameId id;
+  if (!pinResident(file, pageNo, id)) return false;
+  bufStats.metrics.count(BufCounter::ACCESSES);
+  bufStats.metrics.count(BufCounter::HITS);
+  bufStats.metrics.recordAccess(file, true);
+  page = &bufPool[id];
+  return true;
+}
+
+FrameId BufMgr::fetchFrame(File& file, const PageId pageNo,
+                           BufferRing* ring) {
+  FrameId id;
+  bufStats.metrics.count(BufCounter::ACCESSES);
+  if (readAheadWindow.load(std::memory_order_relaxed) != 0) {
+    detectSequential(file, pageNo);
+  }
+  for (;;) {
     // look up the page is existed in buffer pool or not
-    hashTable.lookup(file, pageNo, id);
-    // exist in buffer pool, increment pinCnt and set refbit true  
-    bufDescTable[id].pinCnt++;
-    bufDescTable[id].refbit = true;
-    //return page pointer to the page in buffer pool  
-    page = &bufPool[id];
-  }
-  // if the page isn't existed in buffe pool, allocate it with the new frame
-  catch (HashNotFoundException hnfe){
-    //get the new frame  
-    allocBuf(id);
-    Page newPage = file.readPage(pageNo);
-    //add it in buffer pool  
-    bufPool[id] = newPage;
+    if (pinResident(file, pageNo, id)) {
+      bufStats.metrics.count(BufCounter::HITS);
+      bufStats.metrics.recordAccess(file, true);
+      return id;
+    }
+    // if the page isn't existed in buffe pool, read it into a new frame
+    if (loadPage(file, pageNo, id, false, ring)) {
+      bufStats.metrics.count(BufCounter::MISSES);
+      bufStats.metrics.recordAccess(file, false);
+      return id;
+    }
+  }
+}
+
+void BufMgr::readPages(File& file, const std::vector<PageId>& pageNos,
+                       std::vector<Page*>& pages) {
+  // sized before anything is pinned, so that nothing below can throw
+  pages.resize(pageNos.size());
+  std::vector<FrameId> frames;
+  fetchFrames(file, pageNos, frames);
+  for (std::size_t i = 0; i < frames.size(); i++) {
+    pages[i] = &bufPool[frames[i]];
+  }
+}
+
+std::vector<PinnedPage> BufMgr::readPages(File& file,
+                                          const std::vector<PageId>& pageNos) {
+  // reserved before anything is pinned, so that filling it cannot throw
+  std::vector<PinnedPage> pinned;
+  pinned.reserve(pageNos.size());
+  std::vector<FrameId> frames;
+  fetchFrames(file, pageNos, frames);
+  for (std::size_t i = 0; i < frames.size(); i++) {
+    pinned.push_back(PinnedPage(this, frames[i], pageNos[i]));
+  }
+  return pinned;
+}
+
+/**
+ * @brief Pins a batch of pages, reading the missing ones in runs
+ *
+ * Resident pages are pinned first, then the misses are read with
+ * loadBatch().  A miss another thread is already reading is left to
+ * fetchFrame() once the batch's own reads are done.  If anything fails,
+ * every pin taken so far is dropped before the exception propagates.
+ *
+ * @param file      File object
+ * @param pageNos   pages to pin, in any order, repeats allowed
+ * @param frames    set to the frame holding each page
+ */
+void BufMgr::fetchFrames(File& file, const std::vector<PageId>& pageNos,
+                         std::vector<FrameId>& frames) {
+  const std::size_t n = pageNos.size();
+  frames.assign(n, UINT32_MAX);
+  // sized up front, so that nothing allocates once pins are held
+  std::vector<std::size_t> misses;
+  std::vector<PageId> loadPages;
+  misses.reserve(n);
+  loadPages.reserve(n);
+
+  // drops every pin the batch holds; used when giving up
+  auto unpinAll = [&]() {
+    for (std::size_t i = 0; i < n; i++) {
+      if (frames[i] != UINT32_MAX) unpinFrame(frames[i], false);
+    }
+  };
+
+  try {
+    for (std::size_t i = 0; i < n; i++) {
+      if (pinResident(file, pageNos[i], frames[i])) {
+        bufStats.metrics.count(BufCounter::ACCESSES);
+        bufStats.metrics.count(BufCounter::HITS);
+        bufStats.metrics.recordAccess(file, true);
+      } else {
+        misses.push_back(i);
+      }
+    }
+  } catch (...) {
+    unpinAll();
+    throw;
+  }
+  std::sort(misses.begin(), misses.end(), [&](std::size_t a, std::size_t b) {
+    return pageNos[a] < pageNos[b];
+  });
+
+  for (std::size_t m = 0; m < misses.size(); m++) {
+    const PageId pageNo = pageNos[misses[m]];
+    if (loadPages.empty() || loadPages.back() != pageNo) {
+      loadPages.push_back(pageNo);
+    }
+  }
+  std::vector<FrameId> loadFrames;
+  try {
+    loadBatch(file, loadPages, loadFrames, false);
+  } catch (...) {
+    unpinAll();
+    throw;
+  }
+
+  // hand the loaded frames out, with one pin per request for a page
+  std::size_t k = 0;
+  for (std::size_t m = 0; m < misses.size(); m++) {
+    const std::size_t i = misses[m];
+    while (loadPages[k] != pageNos[i]) k++;
+    if (loadFrames[k] != UINT32_MAX) {
+      if (m > 0 && pageNos[misses[m - 1]] == pageNos[i]) {
+        bufDescTable[loadFrames[k]].pinCnt++;
+      }
+      bufStats.metrics.count(BufCounter::ACCESSES);
+      bufStats.metrics.count(BufCounter::MISSES);
+      bufStats.metrics.recordAccess(file, false);
+      frames[i] = loadFrames[k];
+    }
+  }
+  for (std::size_t m = 0; m < misses.size(); m++) {
+    const std::size_t i = misses[m];
+    if (frames[i] != UINT32_MAX) continue;
+    try {
+      frames[i] = fetchFrame(file, pageNos[i], nullptr);
+    } catch (...) {
+      unpinAll();
+      throw;
+    }
+  }
+}
+
+/**
+ * @brief Reads pages that are not resident, one run of consecutive pages
+ * per request
+ *
+ * Frames for the whole batch are allocated before any I/O is issued, and
+ * then every run is issued to the I/O engine at once; a single run, or a
+ * run of a file mapped by File::openReadOnly(), is read on the calling
+ * thread.  A page another thread
+ * is already reading is skipped.  If anything fails, no page of the batch
+ * stays pinned and the pages of the runs that could not be read are dropped
+ * from the pool again before the first exception propagates.
+ *
+ * @param file      File object
+ * @param pageNos   pages to read, sorted and distinct
+ * @param frames    set to the frame each page was read into, or UINT32_MAX
+ * for a page that was skipped
+ * @param prefetch  true to leave the frames unpinned, marked as read ahead
+ */
+void BufMgr::loadBatch(File& file, const std::vector<PageId>& pageNos,
+                       std::vector<FrameId>& frames, const bool prefetch) {
+  const std::size_t n = pageNos.size();
+  frames.assign(n, UINT32_MAX);
+  for (std::size_t k = 0; k < n; k++) {
+    try {
+      allocBuf(frames[k], BufHashTbl::key(file, pageNos[k]));
+    } catch (...) {
+      for (std::size_t r = 0; r < k; r++) {
+        bufDescTable[frames[r]].latch.unlock();
+      }
+      frames.assign(n, UINT32_MAX);
+      throw;
+    }
+  }
+
+  // publish the frames; pages someone else is already reading are skipped
+  for (std::size_t k = 0; k < n; k++) {
+    BufDesc& desc = bufDescTable[frames[k]];
+    desc.Set(file, pageNos[k]);
+    std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, pageNos[k]));
+    try {
+      hashTable.insert(file, pageNos[k], frames[k]);
+    } catch (const HashAlreadyPresentException&) {
+      desc.clear();
+      desc.pinCnt--;
+      desc.latch.unlock();
+      frames[k] = UINT32_MAX;
+    }
+  }
+
+  // read each run of consecutive published pages with one request, all of
+  // them in flight at once
+  std::vector<std::pair<std::size_t, std::size_t>> runs;
+  for (std::size_t k = 0; k < n;) {
+    if (frames[k] == UINT32_MAX) {
+      k++;
+      continue;
+    }
+    std::size_t end = k + 1;
+    while (end < n && frames[end] != UINT32_MAX &&
+           pageNos[end] == pageNos[end - 1] + 1) {
+      end++;
+    }
+    runs.emplace_back(k, end);
+    k = end;
+  }
+  std::vector<std::exception_ptr> errors(runs.size());
+  {
+    IoBatch batch;
+    std::vector<Page*> runPages;
+    for (std::size_t i = 0; i < runs.size(); i++) {
+      runPages.clear();
+      for (std::size_t r = runs[i].first; r < runs[i].second; r++) {
+        runPages.push_back(&bufPool[frames[r]]);
+      }
+      if (runs.size() == 1 || file.isReadOnly()) {
+        // nothing to overlap the read with, or a copy out of the mapping
+        try {
+          file.readPages(pageNos[runs[i].first], runPages.size(),
+                         runPages.data());
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        continue;
+      }
+      ioEngine->read(file, pageNos[runs[i].first], runPages.size(),
+                     runPages.data(), batch.add(&errors[i]));
+    }
+    ioEngine->submit();
+    batch.wait();
+  }
+
+  // runs that failed are dropped from the pool again
+  std::exception_ptr error;
+  for (std::size_t i = 0; i < runs.size(); i++) {
+    if (errors[i]) {
+      if (!error) error = errors[i];
+      for (std::size_t r = runs[i].first; r < runs[i].second; r++) {
+        BufDesc& desc = bufDescTable[frames[r]];
+        {
+          std::lock_guard<std::mutex> guard(
+              hashTable.partitionLatch(file, pageNos[r]));
+          hashTable.remove(file, pageNos[r]);
+        }
+        desc.clear();
+        desc.pinCnt--;
+        desc.latch.unlock();
+        frames[r] = UINT32_MAX;
+      }
+      continue;
+    }
+    bufStats.metrics.count(BufCounter::READ_RUNS);
+    for (std::size_t r = runs[i].first; r < runs[i].second; r++) {
+      BufDesc& desc = bufDescTable[frames[r]];
+      bufStats.metrics.count(BufCounter::DISKREADS);
+      policy->recordInsert(frames[r], BufHashTbl::key(file, pageNos[r]));
+      if (prefetch) {
+        bufStats.metrics.count(BufCounter::PREFETCHES);
+        desc.prefetched = true;
+        desc.pinCnt--;
+      }
+      desc.valid.store(true, std::memory_order_release);
+      desc.latch.unlock();
+    }
+  }
+  if (error) {
+    // the runs read stay in the pool, but none of them pinned
+    for (std::size_t k = 0; k < n && !prefetch; k++) {
+      if (frames[k] != UINT32_MAX) unpinFrame(frames[k], false);
+    }
+    frames.assign(n, UINT32_MAX);
+    std::rethrow_exception(error);
+  }
+}
+
+/**
+ * @brief Reads a page that is not resident into a newly allocated frame
+ *
+ * On a miss the frame is published in the hash table before the page is read
+ * so that concurrent readers of the same page wait for this read instead of
+ * issuing their own.
+ *
+ * @param file   	File object
+ * @param pageNo    Page number
+ * @param frame     frame the page was read into
+ * @param prefetch  true to leave the frame unpinned, marked as read ahead
+ * @param ring      access strategy ring to take the frame from, or null
+ * @return false if the page was already in the hash table
+ */
+bool BufMgr::loadPage(File& file, const PageId pageNo, FrameId& frame,
+                      const bool prefetch, BufferRing* ring) {
+  FrameId id;
+  allocBuf(id, BufHashTbl::key(file, pageNo), ring);
+  BufDesc& desc = bufDescTable[id];
+  desc.Set(file, pageNo);
+  try {
     //update the hashtable
+    std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, pageNo));
     hashTable.insert(file, pageNo, id);
-    bufDescTable[id].Set(file, pageNo);
-    //return page pointer to the page in buffer pool  
-    page = &bufPool[id];
+  } catch (const HashAlreadyPresentException&) {
+    // another thread brought the page in first; use its frame
+    desc.clear();
+    desc.pinCnt--;
+    desc.latch.unlock();
+    return false;
+  }
+  try {
+    //add it in buffer pool
+    bufPool[id] = file.readPage(pageNo);
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> guard(
+          hashTable.partitionLatch(file, pageNo));
+      hashTable.remove(file, pageNo);
+    }
+    desc.clear();
+    desc.pinCnt--;
+    desc.latch.unlock();
+    throw;
+  }
+  bufStats.metrics.count(BufCounter::DISKREADS);
+  policy->recordInsert(id, BufHashTbl::key(file, pageNo));
+  if (prefetch) {
+    bufStats.metrics.count(BufCounter::PREFETCHES);
+    desc.prefetched = true;
+    desc.pinCnt--;
+  }
+  if (ring != nullptr) ring->record(id, BufHashTbl::key(file, pageNo));
+  desc.valid.store(true, std::memory_order_release);
+  desc.latch.unlock();
+  frame = id;
+  return true;
+}
+
+void BufMgr::setIoEngine(const IoEngineType type,
+                         const std::uint32_t queueDepth) {
+  ioEngine = IoEngine::create(type, queueDepth);
+  bufStats.ioEngine = ioEngine->name();
+}
+
+/**
+ * @brief Queues read-ahead for a file being read sequentially
+ *
+ * Once SEQUENTIAL_RUN consecutive pages have been requested, the next window
+ * of pages is queued, and topped up each time the reader has consumed half
+ * of it.
+ */
+void BufMgr::detectSequential(File& file, const PageId pageNo) {
+  const std::uint32_t window = readAheadWindow.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> guard(prefetchLatch);
+  ScanState& scan = scans[file.id()];
+  if (scan.run != 0 && pageNo == scan.last + 1) {
+    scan.run++;
+  } else {
+    scan.run = 1;
+    scan.ahead = pageNo;
+  }
+  scan.last = pageNo;
+  if (scan.run < SEQUENTIAL_RUN || scan.ahead >= pageNo + window / 2) {
+    return;
+  }
+  const PageId first = std::max(scan.ahead, pageNo) + 1;
+  scan.ahead = pageNo + window;
+  queuePrefetch(file, first, scan.ahead - first + 1);
+}
+
+void BufMgr::readAhead(File& file, const PageId first,
+                       const std::uint32_t count) {
+  std::lock_guard<std::mutex> guard(prefetchLatch);
+  queuePrefetch(file, first, count);
+}
+
+void BufMgr::queuePrefetch(File& file, PageId first, std::uint32_t count) {
+  if (prefetchStop) return;
+  prefetchQueue.push_back(PrefetchRequest{file, first, count});
+  if (!prefetcher.joinable()) {
+    prefetcher = std::thread(&BufMgr::prefetchLoop, this);
+  }
+  prefetchWakeup.notify_one();
+}
+
+void BufMgr::cancelReadAhead(const File& file) {
+  std::unique_lock<std::mutex> lock(prefetchLatch);
+  for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin();
+       it != prefetchQueue.end();) {
+    if (it->file.id() == file.id()) {
+      it = prefetchQueue.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  scans.erase(file.id());
+  prefetchIdle.wait(lock, [&] { return prefetchActive != file.id(); });
+}
+
+std::uint32_t BufMgr::dumpHotPages(const std::string& path) {
+  std::vector<FrameId> ranked;
+  policy->rankFrames(ranked);
+  std::vector<HotPage> pages;
+  for (FrameId id : ranked) {
+    BufDesc& desc = bufDescTable[id];
+    std::shared_lock<std::shared_mutex> latch(desc.latch);
+    if (desc.valid) pages.push_back(HotPage{desc.file->filename(), desc.pageNo});
+  }
+  HotPageList::save(path, pages);
+  return pages.size();
+}
+
+std::uint32_t BufMgr::loadHotPages(const std::string& path) {
+  std::vector<HotPage> pages = HotPageList::load(path);
+  if (pages.size() > numBufs) pages.resize(numBufs);
+
+  std::map<std::string, std::vector<PageId>> byFile;
+  for (const HotPage& page : pages) {
+    byFile[page.filename].push_back(page.page_number);
+  }
+
+  std::uint32_t queued = 0;
+  for (auto& entry : byFile) {
+    File file;
+    try {
+      file = File::open(entry.first);
+    } catch (const FileNotFoundException&) {
+      continue;
+    }
+    std::vector<PageId>& pageNos = entry.second;
+    std::sort(pageNos.begin(), pageNos.end());
+    pageNos.erase(std::unique(pageNos.begin(), pageNos.end()), pageNos.end());
+
+    // one read-ahead request per run of consecutive pages
+    std::lock_guard<std::mutex> guard(prefetchLatch);
+    for (std::size_t i = 0; i < pageNos.size();) {
+      std::size_t end = i + 1;
+      while (end < pageNos.size() && pageNos[end] == pageNos[end - 1] + 1) {
+        end++;
+      }
+      queuePrefetch(file, pageNos[i], end - i);
+      queued += end - i;
+      i = end;
+    }
+  }
+  return queued;
+}
+
+void BufMgr::prefetchLoop() {
+  std::unique_lock<std::mutex> lock(prefetchLatch);
+  for (;;) {
+    prefetchWakeup.wait(
+        lock, [this] { return prefetchStop || !prefetchQueue.empty(); });
+    if (prefetchStop) return;
+    {
+      PrefetchRequest request = std::move(prefetchQueue.front());
+      prefetchQueue.pop_front();
+      prefetchActive = request.file.id();
+      lock.unlock();
+
+      // pages not yet resident are read in batches, a run of consecutive
+      // ones at a time, small enough to leave most frames to other threads
+      const std::size_t batchSize = std::max<std::size_t>(
+          1, std::min<std::size_t>(PREFETCH_BATCH, numBufs / 4));
+      const PageId end = request.first + request.count;
+      std::vector<PageId> batch;
+      std::vector<FrameId> frames;
+      bool failed = false;
+      for (PageId next = request.first; next < end && !failed;) {
+        batch.clear();
+        for (; next < end && batch.size() < batchSize; next++) {
+          FrameId id;
+          std::lock_guard<std::mutex> guard(
+              hashTable.partitionLatch(request.file, next));
+          if (!hashTable.tryLookup(request.file, next, id)) {
+            batch.push_back(next);
+          }
+        }
+        if (batch.empty()) continue;
+        try {
+          loadBatch(request.file, batch, frames, true);
+        } catch (const BadgerDbException&) {
+          // past the end of the file, a deleted page or no free frame; read
+          // what can be read page by page
+          for (PageId pageNo : batch) {
+            FrameId id;
+            try {
+              loadPage(request.file, pageNo, id, true);
+            } catch (const BadgerDbException&) {
+              failed = true;
+              break;
+            }
+          }
+        }
+      }
+      // the request, and its File, go away before the request is finished
+    }
+    lock.lock();
+    prefetchActive = 0;
+    prefetchIdle.notify_all();
   }
 }
 
@@ -121,25 +826,69 @@ void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
  * @param dirty   a bool to define the if it is a dirty page or not 
  * 
  * @throws PageNotPinnedException when a page which is expected to be pinned in the buffer pool is found to be not pinned
- * @throws HashNotFoundException when the page is not found
  */
 void BufMgr::unPinPage(File& file, const PageId pageNo, const bool dirty) {
+BufMetrics::Timer timer(bufStats.metrics, BufOp::UNPIN_PAGE);
 FrameId id;
-    //search the page by pageNo
-    try{
-        hashTable.lookup(file, pageNo, id);
-        //if pinCnt is 0, throw exception
-        if (bufDescTable[id].pinCnt == 0){
-            throw PageNotPinnedException(file.filename(), pageNo, id);
-        }
-        bufDescTable[id].pinCnt--;
-        //if it's a dirty page, make dirty to be true
-        if (dirty) {
-          bufDescTable[id].dirty = true;
-        }
+    //search the page by pageNo; a page not in the pool is ignored
+    std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, pageNo));
+    if (!hashTable.tryLookup(file, pageNo, id)) return;
+    //if pinCnt is 0, throw exception
+    if (bufDescTable[id].pinCnt == 0){
+        throw PageNotPinnedException(file.filename(), pageNo, id);
     }
-    catch (HashNotFoundException e){
+    //a page read through a mapped file could never be written back; the
+    //pin is dropped all the same, so the frame does not stay pinned
+    if (dirty && file.isReadOnly()) {
+      bufDescTable[id].pinCnt--;
+      throw ReadOnlyFileException(file.filename());
     }
+    //if it's a dirty page, make dirty to be true (before the pin is
+    //dropped, so an evictor that sees the page unpinned sees it dirty)
+    if (dirty) {
+      markDirty(bufDescTable[id]);
+    }
+    bufDescTable[id].pinCnt--;
+}
+
+/**
+ * @brief Drops a pin held through a PinnedPage
+ *
+ * The frame is known, so unlike unPinPage() no hash table lookup is needed.
+ *
+ * @param frame   frame holding the pinned page
+ * @param dirty   true if the page was modified
+ */
+void BufMgr::unpinFrame(const FrameId frame, const bool dirty) noexcept {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::UNPIN_PAGE);
+  BufDesc& desc = bufDescTable[frame];
+  // dirty is set before the pin is dropped, as in unPinPage()
+  if (dirty) {
+    markDirty(desc);
+  }
+  desc.pinCnt--;
+}
+
+void BufMgr::checkDirtiable(const FrameId frame) const {
+  const File& file = *bufDescTable[frame].file;
+  if (file.isReadOnly()) {
+    throw ReadOnlyFileException(file.filename());
+  }
+}
+
+/**
+ * @brief Marks a page dirty
+ *
+ * Only the thread that turns the flag on reads the dirty clock, so the
+ * clock reading is that of the first modification not yet written back.
+ *
+ * @param desc    descriptor of a pinned frame
+ */
+void BufMgr::markDirty(BufDesc& desc) {
+  if (!desc.dirty.load(std::memory_order_relaxed) &&
+      !desc.dirty.exchange(true)) {
+    desc.firstDirty = ++dirtyClock;
+  }
 }
 
 /**
@@ -149,80 +898,558 @@ FrameId id;
  * @param pageNo is the page number
  * @param page is the page data
  */
-void BufMgr::allocPage(File &file, PageId &pageNo, Page *&page)
+void BufMgr::allocPage(File &file, PageId &pageNo, Page *&page,
+                       BufferRing* ring)
 {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::ALLOC_PAGE);
+  page = &bufPool[allocFrame(file, pageNo, ring)];
+}
 
-  FrameId frameID;
-  allocBuf(frameID); //allocates the buffer
-  Page tempPage = file.allocatePage(); //gets a page
-  bufPool[frameID] = tempPage;      
-  page = &bufPool[frameID];
-  pageNo = page->page_number(); //fetches the page number
-    
-  bufDescTable[frameID].Set(file, pageNo);
+PinnedPage BufMgr::allocPage(File& file, BufferRing* ring) {
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::ALLOC_PAGE);
+  PageId pageNo;
+  const FrameId frame = allocFrame(file, pageNo, ring);
+  return PinnedPage(this, frame, pageNo);
+}
 
+FrameId BufMgr::allocFrame(File& file, PageId& pageNo, BufferRing* ring) {
+  FrameId frameID;
+  bufStats.metrics.count(BufCounter::ACCESSES);
+  allocBuf(frameID, 0, ring); //allocates the buffer
+  BufDesc& desc = bufDescTable[frameID];
+  try {
+    bufPool[frameID] = file.allocatePage(); //gets a page
+  } catch (...) {
+    desc.latch.unlock();
+    throw;
+  }
+  bufStats.metrics.count(BufCounter::DISKREADS);
+  pageNo = bufPool[frameID].page_number(); //fetches the page number
 
-  hashTable.insert(file, pageNo, frameID); //inserts into the hash table
-    
+  desc.Set(file, pageNo);
+  {
+    std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, pageNo));
+    hashTable.insert(file, pageNo, frameID); //inserts into the hash table
+  }
+  policy->recordInsert(frameID, BufHashTbl::key(file, pageNo));
+  if (ring != nullptr) ring->record(frameID, BufHashTbl::key(file, pageNo));
+  desc.valid.store(true, std::memory_order_release);
+  desc.latch.unlock();
+  return frameID;
 }
 /**
  * @brief Scan bufTable for pages belonging to the file, and clear them from bulpool.
  *
+ * Each frame is latched in turn and removed with evictFrame().
+ *
  * @param file    File object
  * 
  * @throws PagePinnedException if some page of the file is pinned.
  * @throws BadBufferException if an invalid page belonging to the file is encountered.
  */
 void BufMgr::flushFile(File& file) {
-      
-    int i;
-  //search if the pages are in the bulPool
-  for (i = 0; i < bufPool.size(); i++) { 
+  BufMetrics::Timer timer(bufStats.metrics, BufOp::FLUSH_FILE);
+  cancelReadAhead(file);
 
-    if(bufDescTable[i].file.filename() == file.filename()) {
-      // if pinCnt of page not equal to 0, can't flush it, throw exception
-      if(bufDescTable[i].pinCnt > 0) { 
-        throw PagePinnedException(bufDescTable[i].file.filename(), bufDescTable[i].pageNo, bufDescTable[i].frameNo);
+  // only the file's own frames are visited, including retired frames a
+  // shrink has not drained, a batch at a time in ascending page order, so
+  // dirty pages go back in long sequential writes
+  std::vector<std::pair<PageId, FrameId>> pages;
+  hashTable.filePages(file, pages);
+  std::vector<FrameId> batch;
+  std::size_t next = 0;
+  while (next < pages.size()) {
+    batch.clear();
+    std::exception_ptr error;
+    while (next < pages.size() && batch.size() < WRITE_BATCH && !error) {
+      const PageId pageNo = pages[next].first;
+      const FrameId id = pages[next].second;
+      BufDesc& desc = bufDescTable[id];
+      // only wait for a latch while holding none, as frames may have changed
+      // pages since the list was taken
+      if (batch.empty()) {
+        desc.latch.lock();
+      } else if (!desc.latch.try_lock()) {
+        break;
       }
+      next++;
+      if (desc.fileId != file.id() || desc.pageNo != pageNo) {
+        desc.latch.unlock();
+        continue;
+      }
+      if (!desc.valid) {
         //if page is not valid, throw exception
-        if(!bufDescTable[i].valid) { 
-        throw BadBufferException(bufDescTable[i].frameNo, bufDescTable[i].dirty, bufDescTable[i].valid, bufDescTable[i].refbit);
+        if (desc.pinCnt == 0) {
+          error = std::make_exception_ptr(
+              BadBufferException(desc.frameNo, desc.dirty, desc.valid,
+                                 false /* refbit, kept by the policy */));
+        }
+        desc.latch.unlock();
+        continue;
       }
+      {
+        std::lock_guard<std::mutex> guard(
+            hashTable.partitionLatch(file, pageNo));
+        if (desc.pinCnt.load() == 0) desc.valid = false;
+      }
+      if (desc.valid) {
+        // if pinCnt of page not equal to 0, can't flush it, throw exception
+        error = std::make_exception_ptr(
+            PagePinnedException(file.filename(), pageNo, desc.frameNo));
+        desc.latch.unlock();
+        continue;
+      }
+      batch.push_back(id);
+    }
 
-      //if the page is dirty, flush the page to disk
-      if(bufDescTable[i].dirty) { 
-        file.writePage(bufPool[i]);
-        bufDescTable[i].dirty = false;
-      } 
+    try {
+      writeBack(batch);
+    } catch (...) {
+      for (FrameId id : batch) {
+        bufDescTable[id].valid = true;
+        bufDescTable[id].latch.unlock();
+      }
+      throw;
+    }
+    for (FrameId id : batch) {
+      BufDesc& desc = bufDescTable[id];
+      {
+        std::lock_guard<std::mutex> guard(
+            hashTable.partitionLatch(file, desc.pageNo));
+        hashTable.remove(file, desc.pageNo);
+      }
+      policy->recordRemove(id, BufHashTbl::key(file, desc.pageNo), false);
+      desc.clear();
+      desc.latch.unlock();
+    }
+    if (error) std::rethrow_exception(error);
+  }
+}
 
-      //remove the page from the hashtable
-      hashTable.remove(file, bufDescTable[i].pageNo);
+/**
+ * @brief Writes dirty pages back, one write per run of consecutive pages
+ *
+ * Frames are sorted by file and page number, so each file is written in
+ * ascending page order, and every run is issued to the I/O engine at once;
+ * a single run is written on the calling thread.
+ * Frames that are not dirty are skipped.  The pages of a run whose write
+ * fails stay dirty; the first failure is rethrown once all runs are done.
+ *
+ * A page is marked clean before it is written, so a thread that has it
+ * pinned and modifies it meanwhile marks it dirty again when it unpins it.
+ *
+ * @param frames  frames to write back, all latched by the caller
+ */
+void BufMgr::writeBack(std::vector<FrameId>& frames) {
+  std::sort(frames.begin(), frames.end(), [this](FrameId a, FrameId b) {
+    const BufDesc& da = bufDescTable[a];
+    const BufDesc& db = bufDescTable[b];
+    return da.fileId != db.fileId ? da.fileId < db.fileId
+                                  : da.pageNo < db.pageNo;
+  });
+  std::vector<std::pair<std::size_t, std::size_t>> runs;
+  std::vector<std::uint64_t> since(frames.size());
+  for (std::size_t k = 0; k < frames.size();) {
+    const BufDesc& first = bufDescTable[frames[k]];
+    if (!first.dirty) {
+      k++;
+      continue;
+    }
+    std::size_t end = k + 1;
+    while (end < frames.size()) {
+      const BufDesc& desc = bufDescTable[frames[end]];
+      if (!desc.dirty || desc.fileId != first.fileId ||
+          desc.pageNo != first.pageNo + (end - k)) {
+        break;
+      }
+      end++;
+    }
+    runs.emplace_back(k, end);
+    k = end;
+  }
 
-      //clear it from BuDesc
-      bufDescTable[i].clear();
+  std::vector<std::exception_ptr> errors(runs.size());
+  {
+    IoBatch batch;
+    std::vector<const Page*> runPages;
+    for (std::size_t i = 0; i < runs.size(); i++) {
+      runPages.clear();
+      for (std::size_t r = runs[i].first; r < runs[i].second; r++) {
+        BufDesc& desc = bufDescTable[frames[r]];
+        runPages.push_back(&bufPool[frames[r]]);
+        since[r] = desc.firstDirty;
+        desc.firstDirty = 0;
+        desc.dirty = false;
+      }
+      BufDesc& first = bufDescTable[frames[runs[i].first]];
+      if (runs.size() == 1) {
+        // nothing to overlap the write with
+        try {
+          first.file->writePages(first.pageNo, runPages.size(),
+                                 runPages.data());
+        } catch (...) {
+          errors[i] = std::current_exception();
+        }
+        break;
+      }
+      ioEngine->write(*first.file, first.pageNo, runPages.size(),
+                      runPages.data(), batch.add(&errors[i]));
+    }
+    ioEngine->submit();
+    batch.wait();
+  }
 
+  std::exception_ptr error;
+  for (std::size_t i = 0; i < runs.size(); i++) {
+    if (errors[i]) {
+      if (!error) error = errors[i];
+      for (std::size_t r = runs[i].first; r < runs[i].second; r++) {
+        bufDescTable[frames[r]].firstDirty = since[r];
+        bufDescTable[frames[r]].dirty = true;
+      }
+      continue;
     }
-  }   
+    bufStats.metrics.count(BufCounter::WRITE_CALLS);
+    bufStats.metrics.count(BufCounter::DISKWRITES,
+                           runs[i].second - runs[i].first);
+  }
+  if (error) std::rethrow_exception(error);
 }
+
 /**
  * @brief the page from buffer pool and remove it from file
  *
  * @param file    File object
  * @param PageNo  Page number
+ * @throws PagePinnedException if the page is pinned.
  */
 void BufMgr::disposePage(File& file, const PageId PageNo) {
   FrameId id;
-  try{
-    // look up the page is existed in buffer pool or not  
-    hashTable.lookup(file, PageNo, id);  
-    bufDescTable[id].clear();
-    hashTable.remove(file, PageNo);  
-    file.deletePage(PageNo);
+  bool found;
+  // look up the page is existed in buffer pool or not
+  {
+    std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, PageNo));
+    found = hashTable.tryLookup(file, PageNo, id);
+  }
+  if (found) {
+    BufDesc& desc = bufDescTable[id];
+    std::unique_lock<std::shared_mutex> latch(desc.latch);
+    {
+      std::lock_guard<std::mutex> guard(hashTable.partitionLatch(file, PageNo));
+      FrameId current;
+      // the page may have been evicted while the latch was awaited
+      found = hashTable.tryLookup(file, PageNo, current) && current == id;
+      if (found && desc.pinCnt.load() != 0) {
+        // a pinned page can't be taken out of the buffer pool
+        throw PagePinnedException(file.filename(), PageNo, desc.frameNo);
+      }
+      if (found) {
+        desc.valid = false;
+        hashTable.remove(file, PageNo);
+      }
+    }
+    if (found) {
+      policy->recordRemove(id, BufHashTbl::key(file, PageNo), false);
+      desc.clear();
+    }
+  }
+  file.deletePage(PageNo);
+}
+
+/**
+ * @brief Takes a frame from the free-frame reserve
+ *
+ * Frames on the reserve are also free as far as the replacement policy is
+ * concerned, so a thread that found the reserve empty may have taken one of
+ * them meanwhile; such frames are skipped.
+ *
+ * @param frame is set to the frame, returned latched exclusively
+ * @return false if the reserve has no usable frame
+ */
+bool BufMgr::popFree(FrameId& frame) {
+  std::lock_guard<std::mutex> guard(freeLatch);
+  while (!freeList.empty()) {
+    const FrameId id = freeList.back();
+    freeList.pop_back();
+    onFreeList[id] = false;
+    if (!tryClaim(id)) {
+      continue;
+    }
+    if (!bufDescTable[id].valid) {
+      if (freeList.size() < lowWater) cleanerWakeup.notify_one();
+      frame = id;
+      return true;
+    }
+    bufDescTable[id].latch.unlock();
+  }
+  cleanerWakeup.notify_one();
+  return false;
+}
+
+/**
+ * @brief Refills the free-frame reserve up to the high watermark
+ *
+ * Runs on the cleaner thread.  Victims come from the replacement policy just
+ * as for a miss; dirty ones are written back here rather than by the thread
+ * that later needs the frame.
+ */
+void BufMgr::refillReserve() {
+  for (std::uint32_t i = 0; i < numBufs; i++) {
+    {
+      std::lock_guard<std::mutex> guard(freeLatch);
+      if (cleanerStop || freeList.size() >= highWater) return;
+    }
+
+    FrameId id;
+    if (!policy->pickVictim(
+            0, [this](FrameId f) { return tryClaim(f); }, id)) {
+      return;
+    }
+    BufDesc& desc = bufDescTable[id];
+    if (desc.valid) {
+      bool evicted, written;
+      try {
+        evicted = evictFrame(id, true, &written);
+      } catch (...) {
+        // leave the page for a foreground miss to write and report
+        desc.latch.unlock();
+        return;
+      }
+      if (!evicted) {
+        desc.latch.unlock();
+        continue;
+      }
+      bufStats.metrics.count(BufCounter::CLEANER_FREES);
+      if (written) bufStats.metrics.count(BufCounter::CLEANER_WRITES);
+    }
+    desc.latch.unlock();
+
+    std::lock_guard<std::mutex> guard(freeLatch);
+    if (!onFreeList[id]) {
+      onFreeList[id] = true;
+      freeList.push_back(id);
+    }
+  }
+}
+
+void BufMgr::cleanerLoop() {
+  std::unique_lock<std::mutex> lock(freeLatch);
+  while (!cleanerStop) {
+    if (freeList.size() < lowWater) {
+      lock.unlock();
+      refillReserve();
+      lock.lock();
+      if (cleanerStop) break;
+    }
+    // woken early by a miss that takes the reserve below the low watermark
+    cleanerWakeup.wait_for(lock, std::chrono::milliseconds(10));
+  }
+}
+
+void BufMgr::startCleaner(std::uint32_t low, std::uint32_t high) {
+  stopCleaner();
+  highWater = std::min(high, numBufs.load());
+  lowWater = std::min(low, highWater);
+  cleanerStop = false;
+  cleanerRunning = true;
+  cleaner = std::thread(&BufMgr::cleanerLoop, this);
+}
+
+void BufMgr::stopCleaner() {
+  if (!cleaner.joinable()) return;
+  cleanerRunning = false;
+  {
+    std::lock_guard<std::mutex> guard(freeLatch);
+    cleanerStop = true;
+  }
+  cleanerWakeup.notify_one();
+  cleaner.join();
+
+  std::lock_guard<std::mutex> guard(freeLatch);
+  for (FrameId id : freeList) onFreeList[id] = false;
+  freeList.clear();
+}
+
+void BufMgr::resize(std::uint32_t newBufs) {
+  if (newBufs == 0 || newBufs > capacity()) {
+    throw BufferExceededException();
+  }
+  std::lock_guard<std::mutex> guard(resizeLatch);
+  const std::uint32_t oldBufs = numBufs;
+  if (newBufs > oldBufs) {
+    // a shrink that failed part way may have left pages in these frames
+    drainFrames(oldBufs, newBufs);
+    arena.resize(newBufs);
+    hashTable.resize(HASHTABLE_SZ(newBufs));
+    policy->resize(newBufs);
+    numBufs = newBufs;
+  } else if (newBufs < oldBufs) {
+    // retire the frames first so that nothing new goes into them
+    numBufs = newBufs;
+    policy->resize(newBufs);
+    {
+      std::lock_guard<std::mutex> freeGuard(freeLatch);
+      std::vector<FrameId>::iterator kept = std::remove_if(
+          freeList.begin(), freeList.end(),
+          [newBufs](FrameId id) { return id >= newBufs; });
+      for (std::vector<FrameId>::iterator it = kept; it != freeList.end();
+           ++it) {
+        onFreeList[*it] = false;
+      }
+      freeList.erase(kept, freeList.end());
+      highWater = std::min(highWater, newBufs);
+      lowWater = std::min(lowWater, highWater);
+    }
+    drainFrames(newBufs, oldBufs);
+    hashTable.resize(HASHTABLE_SZ(newBufs));
+    arena.resize(newBufs);
+  }
+}
+
+void BufMgr::drainFrames(FrameId first, FrameId end) {
+  std::vector<FrameId> pending;
+  for (FrameId id = first; id < end; id++) pending.push_back(id);
+  while (!pending.empty()) {
+    std::vector<FrameId> pinned;
+    for (FrameId id : pending) {
+      BufDesc& desc = bufDescTable[id];
+      std::unique_lock<std::shared_mutex> latch(desc.latch);
+      // an empty frame can still carry the pins of readers that looked up
+      // its last page and have yet to see it go
+      if (desc.valid ? !evictFrame(id, false) : desc.pinCnt.load() != 0) {
+        pinned.push_back(id);
+      }
+    }
+    pending.swap(pinned);
+    if (!pending.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+}
+
+std::uint64_t BufMgr::beginCheckpoint() {
+  std::lock_guard<std::mutex> guard(checkpointLatch);
+  const std::uint64_t number = ++checkpointsRequested;
+  if (!checkpointer.joinable()) {
+    checkpointer = std::thread(&BufMgr::checkpointLoop, this);
+  }
+  checkpointWakeup.notify_one();
+  return number;
+}
+
+Checkpoint BufMgr::waitForCheckpoint(const std::uint64_t number) {
+  std::unique_lock<std::mutex> lock(checkpointLatch);
+  checkpointDone.wait(lock, [&] { return lastCheckpoint.number >= number; });
+  return lastCheckpoint;
+}
+
+Checkpoint BufMgr::getLastCheckpoint() {
+  std::lock_guard<std::mutex> guard(checkpointLatch);
+  return lastCheckpoint;
+}
+
+std::vector<DirtyPage> BufMgr::dirtyPageTable() {
+  std::vector<DirtyPage> pages;
+  for (FrameId i = 0; i < bufDescTable.size(); i++) {
+    BufDesc& desc = bufDescTable[i];
+    if (!desc.dirty) continue;
+    std::shared_lock<std::shared_mutex> latch(desc.latch);
+    const std::uint64_t since = desc.firstDirty;
+    if (desc.valid && desc.dirty && since != 0) {
+      pages.push_back(DirtyPage{desc.file->filename(), desc.pageNo, since});
+    }
+  }
+  std::sort(pages.begin(), pages.end(),
+            [](const DirtyPage& a, const DirtyPage& b) {
+              return a.firstDirty < b.firstDirty;
+            });
+  return pages;
+}
+
+void BufMgr::checkpointLoop() {
+  std::unique_lock<std::mutex> lock(checkpointLatch);
+  for (;;) {
+    checkpointWakeup.wait(lock, [this] {
+      return checkpointStop || checkpointsRequested > lastCheckpoint.number;
+    });
+    if (checkpointStop) return;
+    const std::uint64_t number = checkpointsRequested;
+    lock.unlock();
+
+    // pages dirtied from here on belong to the next checkpoint
+    Checkpoint done = writeCheckpoint(dirtyClock);
+    done.number = number;
+
+    lock.lock();
+    lastCheckpoint = done;
+    checkpointDone.notify_all();
+  }
+}
+
+/**
+ * @brief Writes back the pages first dirtied at or before dirtyBound
+ *
+ * Frames are latched shared a batch at a time, which keeps them from being
+ * evicted or reused while hits, pins and modifications carry on.  As in
+ * flushFile(), only the first latch of a batch is waited for.  Pages whose
+ * write fails are counted and skipped; they stay dirty.  The headers of the
+ * open files are written back last.
+ *
+ * @param dirtyBound  dirty clock reading the checkpoint started at
+ * @return  marker of the checkpoint, without its number
+ */
+Checkpoint BufMgr::writeCheckpoint(const std::uint64_t dirtyBound) {
+  Checkpoint done;
+  done.dirtyBound = dirtyBound;
+  auto due = [dirtyBound](const BufDesc& desc) {
+    const std::uint64_t since = desc.firstDirty;
+    return desc.dirty && since != 0 && since <= dirtyBound;
+  };
+
+  std::vector<FrameId> batch;
+  FrameId next = 0;
+  while (next < bufDescTable.size()) {
+    batch.clear();
+    while (next < bufDescTable.size() && batch.size() < WRITE_BATCH) {
+      BufDesc& desc = bufDescTable[next];
+      if (!due(desc)) {
+        next++;
+        continue;
+      }
+      if (batch.empty()) {
+        desc.latch.lock_shared();
+      } else if (!desc.latch.try_lock_shared()) {
+        break;
+      }
+      next++;
+      if (desc.valid && due(desc)) {
+        batch.push_back(desc.frameNo);
+      } else {
+        desc.latch.unlock_shared();
+      }
+    }
+
+    try {
+      writeBack(batch);
+    } catch (const BadgerDbException&) {
+      // a page deleted from its file, or an I/O error
+    }
+    for (FrameId id : batch) {
+      if (due(bufDescTable[id])) {
+        done.pagesFailed++;
+      } else {
+        done.pagesWritten++;
+      }
+      bufDescTable[id].latch.unlock_shared();
+    }
   }
-  //all pages are free and cleaned  
-  catch (HashNotFoundException hnfe){
-    printf("deleted page is not existed");
+  try {
+    File::syncAll();
+  } catch (const BadgerDbException&) {
+    // written by the next checkpoint, or when the file is closed
   }
+  bufStats.metrics.count(BufCounter::CHECKPOINT_WRITES, done.pagesWritten);
+  return done;
 }
 
 void BufMgr::printSelf(void) {
@@ -8,11 +8,25 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "bufHashTbl.h"
+#include "buf_metrics.h"
 #include "file.h"
+#include "io_engine.h"
+#include "page_arena.h"
+#include "pinned_page.h"
+#include "replacement_policy.h"
 
 namespace badgerdb {
 
@@ -23,20 +37,32 @@ class BufMgr;
 
 /**
  * @brief Class for maintaining information about buffer pool frames
+ *
+ * The identity of a frame (file, pageNo) only changes while its latch is held
+ * exclusively, and a frame can only be pinned through the hash table while the
+ * corresponding partition latch is held.  Pin count, dirty and valid are
+ * atomic so the hit path never has to take the frame latch.  Recency
+ * information is kept by the replacement policy, not here.
  */
 class BufDesc {
  public:
   /**
    * Constructor of BufDesc class
    */
-  BufDesc() { clear(); }
+  BufDesc() : pinCnt(0) { clear(); }
 
  private:
   friend class BufMgr;
   /**
-   * Pointer to file to which corresponding frame is assigned
+   * Shared handle of the file to which corresponding frame is assigned, from
+   * File::handle(), so assigning a frame never takes the file open lock
+   */
+  std::shared_ptr<File> file;
+
+  /**
+   * Id of that file, 0 if the frame holds no page
    */
-  File file;
+  FileId fileId;
 
   /**
    * Page within file to which corresponding frame is assigned
@@ -51,111 +77,408 @@ class BufDesc {
   /**
    * Number of times this page has been pinned
    */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
   /**
    * True if page is dirty;  false otherwise
    */
-  bool dirty;
+  std::atomic<bool> dirty;
+
+  /**
+   * Reading of the buffer manager's dirty clock when the page last went from
+   * clean to dirty; 0 while clean
+   */
+  std::atomic<std::uint64_t> firstDirty;
 
   /**
-   * True if page is valid
+   * True if page is valid.  A frame that is in the hash table but not yet
+   * valid is still being read in (or written out) by the holder of its latch.
    */
-  bool valid;
+  std::atomic<bool> valid;
 
   /**
-   * Has this buffer frame been reference recently
+   * True if the page was read ahead and has not been requested since
    */
-  bool refbit;
+  std::atomic<bool> prefetched;
 
   /**
-   * Initialize buffer frame for a new user
+   * Reader/writer latch.  Held exclusively while the frame changes identity
+   * or while its page is read from or written to disk.
+   */
+  std::shared_mutex latch;
+
+  /**
+   * Initialize buffer frame for a new user.  The pin count is left alone:
+   * threads that pinned the frame while it was being torn down drop their
+   * pins themselves once they see it is no longer valid.
    */
   void clear() {
-    pinCnt = 0;
-    file = File();
+    file.reset();
+    fileId = 0;
     pageNo = Page::INVALID_NUMBER;
+    firstDirty = 0;
     dirty = false;
-    refbit = false;
     valid = false;
+    prefetched = false;
   }
 
   /**
    * Set values of member variables corresponding to assignment of frame to a
    * page in the file. Called when a frame in buffer pool is allocated to any
-   * page in the file through readPage() or allocPage()
+   * page in the file through readPage() or allocPage().  The frame is left
+   * invalid; the caller marks it valid once the page contents are in place.
+   * The caller's pin is added to any pins still held by threads that looked
+   * up the frame's previous page and have not yet seen it go invalid.
    *
    * @param filePtr	File object
    * @param pageNum	Page number in the file
    */
   void Set(File& file, PageId pageNum) {
-    this->file = file;
+    this->file = file.handle();
+    fileId = file.id();
     pageNo = pageNum;
-    pinCnt = 1;
+    pinCnt++;
+    firstDirty = 0;
     dirty = false;
-    valid = true;
-    refbit = true;
+    valid = false;
+    prefetched = false;
   }
 
   void Print() {
-    if (file.isValid()) {
-      std::cout << "file:" << file.filename() << " ";
+    if (file != nullptr && file->isValid()) {
+      std::cout << "file:" << file->filename() << " ";
       std::cout << "pageNo:" << pageNo << " ";
     } else
       std::cout << "file:NULL ";
 
     std::cout << "valid:" << valid << " ";
     std::cout << "pinCnt:" << pinCnt << " ";
-    std::cout << "dirty:" << dirty << " ";
-    std::cout << "refbit:" << refbit << "\n";
+    std::cout << "dirty:" << dirty << "\n";
   }
 };
 
 /**
  * @brief Class to maintain statistics of buffer usage
+ *
+ * The counters live in per-thread shards of the metrics, so counting a hit
+ * never contends with another thread; reading one adds the shards up.
  */
 struct BufStats {
+  /**
+   * Name of the replacement policy of the buffer manager
+   */
+  const char* policy;
+
+  /**
+   * Where the buffer pool memory comes from: "hugetlb", "thp" or "4k"
+   */
+  const char* poolBacking;
+
+  /**
+   * Name of the I/O engine batched reads and write-back go through
+   */
+  const char* ioEngine;
+
+  /**
+   * Counters, latency histograms, eviction and per-file counters, kept per
+   * thread
+   */
+  BufMetrics metrics;
+
   /**
    * Total number of accesses to buffer pool
    */
-  int accesses;
+  std::uint64_t accesses() const {
+    return metrics.counter(BufCounter::ACCESSES);
+  }
 
   /**
    * Number of pages read from disk (including allocs)
    */
-  int diskreads;
+  std::uint64_t diskreads() const {
+    return metrics.counter(BufCounter::DISKREADS);
+  }
 
   /**
    * Number of pages written back to disk
    */
-  int diskwrites;
+  std::uint64_t diskwrites() const {
+    return metrics.counter(BufCounter::DISKWRITES);
+  }
+
+  /**
+   * Number of write requests the pages written back took; a run of
+   * consecutive pages written together counts once
+   */
+  std::uint64_t writeCalls() const {
+    return metrics.counter(BufCounter::WRITE_CALLS);
+  }
+
+  /**
+   * Number of readPage calls that found the page in the buffer pool
+   */
+  std::uint64_t hits() const { return metrics.counter(BufCounter::HITS); }
+
+  /**
+   * Number of readPage calls that had to read the page from disk
+   */
+  std::uint64_t misses() const { return metrics.counter(BufCounter::MISSES); }
+
+  /**
+   * Number of dirty pages written back by the background cleaner
+   */
+  std::uint64_t cleanerWrites() const {
+    return metrics.counter(BufCounter::CLEANER_WRITES);
+  }
+
+  /**
+   * Number of frames emptied by the background cleaner
+   */
+  std::uint64_t cleanerFrees() const {
+    return metrics.counter(BufCounter::CLEANER_FREES);
+  }
+
+  /**
+   * Number of frames allocated from the free-frame reserve
+   */
+  std::uint64_t reserveHits() const {
+    return metrics.counter(BufCounter::RESERVE_HITS);
+  }
+
+  /**
+   * Number of frame allocations that found the reserve empty while the
+   * cleaner was running, and had to find a victim themselves
+   */
+  std::uint64_t reserveMisses() const {
+    return metrics.counter(BufCounter::RESERVE_MISSES);
+  }
+
+  /**
+   * Number of dirty pages written back by checkpoints
+   */
+  std::uint64_t checkpointWrites() const {
+    return metrics.counter(BufCounter::CHECKPOINT_WRITES);
+  }
+
+  /**
+   * Number of runs of consecutive pages readPages() read with one request
+   */
+  std::uint64_t readRuns() const {
+    return metrics.counter(BufCounter::READ_RUNS);
+  }
+
+  /**
+   * Number of frames recycled from an access strategy ring
+   */
+  std::uint64_t ringReuses() const {
+    return metrics.counter(BufCounter::RING_REUSES);
+  }
+
+  /**
+   * Number of pages read ahead of a request
+   */
+  std::uint64_t prefetches() const {
+    return metrics.counter(BufCounter::PREFETCHES);
+  }
+
+  /**
+   * Number of readPage calls served by a page that was read ahead
+   */
+  std::uint64_t prefetchHits() const {
+    return metrics.counter(BufCounter::PREFETCH_HITS);
+  }
+
+  /**
+   * Fraction of readPage calls that were hits, or 0 if there were none
+   */
+  double hitRatio() const {
+    const BufMetrics::Snapshot snap = metrics.snapshot();
+    const std::uint64_t total =
+        snap.count(BufCounter::HITS) + snap.count(BufCounter::MISSES);
+    return total == 0
+               ? 0.0
+               : static_cast<double>(snap.count(BufCounter::HITS)) / total;
+  }
+
+  /**
+   * Average number of bytes written back per write request, or 0 if nothing
+   * was written
+   */
+  double bytesPerWrite() const {
+    const BufMetrics::Snapshot snap = metrics.snapshot();
+    const std::uint64_t calls = snap.count(BufCounter::WRITE_CALLS);
+    const std::uint64_t pages = snap.count(BufCounter::DISKWRITES);
+    return calls == 0 ? 0.0 : static_cast<double>(pages) * Page::SIZE / calls;
+  }
 
   /**
    * Clear all values
    */
-  void clear() { accesses = diskreads = diskwrites = 0; }
+  void clear() { metrics.reset(); }
+
+  /**
+   * Returns the counters and detailed metrics, to be dumped or subtracted
+   * from a later snapshot
+   */
+  BufMetrics::Snapshot snapshot() const { return metrics.snapshot(); }
+
+  /**
+   * Writes a snapshot of the statistics as text
+   */
+  void dump(std::ostream& os) const {
+    const BufMetrics::Snapshot snap = snapshot();
+    const std::uint64_t calls = snap.count(BufCounter::WRITE_CALLS);
+    os << "policy " << policy << ", pool " << poolBacking << ", io "
+       << ioEngine << "\n";
+    os << "write calls " << calls << ", bytes per write "
+       << (calls == 0 ? 0
+                      : snap.count(BufCounter::DISKWRITES) * Page::SIZE / calls)
+       << "\n";
+    snap.dump(os);
+  }
 
   /**
    * Constructor of BufStats class
    */
-  BufStats() { clear(); }
+  BufStats() : policy(""), poolBacking(""), ioEngine("") {}
 };
 
 /**
- * @brief The central class which manages the buffer pool including frame
- * allocation and deallocation to pages in the file
+ * @brief Access strategy for scans and bulk loads: a small ring of frames
+ *
+ * Passing a ring to BufMgr::readPage() or BufMgr::allocPage() makes the
+ * pages it reads in recycle the ring's frames, once the ring is full, instead
+ * of taking frames from the shared pool.  A large scan then evicts at most
+ * the ring's worth of pages other callers are using.  Pages that are already
+ * resident are used where they are.  A ring belongs to one caller at a time
+ * and is not thread safe.
  */
-class BufMgr {
+class BufferRing {
+ public:
+  /**
+   * Constructor of BufferRing class
+   *
+   * @param size    Number of frames in the ring
+   */
+  explicit BufferRing(std::uint32_t size)
+      : slots(size == 0 ? 1 : size), next(0) {}
+
+  /**
+   * Number of frames in the ring
+   */
+  std::uint32_t size() const { return slots.size(); }
+
  private:
+  friend class BufMgr;
+
   /**
-   * Current position of clockhand in our buffer pool
+   * A frame of the ring and the page the ring last read into it
    */
-  FrameId clockHand;
+  struct Slot {
+    Slot() : frame(UINT32_MAX), key(0) {}
+    FrameId frame;
+    std::uint64_t key;
+  };
 
   /**
-   * Number of frames in the buffer pool
+   * Record the frame a page was just read into, at the current position.
+   */
+  void record(FrameId frame, std::uint64_t key) {
+    slots[next].frame = frame;
+    slots[next].key = key;
+    next = (next + 1) % slots.size();
+  }
+
+  /**
+   * Frames of the ring
+   */
+  std::vector<Slot> slots;
+
+  /**
+   * Position of the frame to recycle next
+   */
+  std::uint32_t next;
+};
+
+/**
+ * @brief Marker of a completed checkpoint, see BufMgr::checkpoint().
+ */
+struct Checkpoint {
+  /**
+   * Number of the last checkpoint request this one satisfied, counting from
+   * 1; 0 if no checkpoint has completed
+   */
+  std::uint64_t number = 0;
+
+  /**
+   * Dirty clock reading the checkpoint started at: every page first dirtied
+   * at or before it was written back, unless pagesFailed is not 0
+   */
+  std::uint64_t dirtyBound = 0;
+
+  /**
+   * Number of dirty pages written back
+   */
+  std::uint32_t pagesWritten = 0;
+
+  /**
+   * Number of dirty pages that could not be written and are still dirty
+   */
+  std::uint32_t pagesFailed = 0;
+};
+
+/**
+ * @brief Entry of the dirty page table, see BufMgr::dirtyPageTable().
+ */
+struct DirtyPage {
+  /**
+   * Name of the file the page belongs to
    */
-  std::uint32_t numBufs;
+  std::string filename;
+
+  /**
+   * Page number in the file
+   */
+  PageId pageNo;
+
+  /**
+   * Dirty clock reading when the page went from clean to dirty
+   */
+  std::uint64_t firstDirty;
+};
+
+/**
+ * @brief The central class which manages the buffer pool including frame
+ * allocation and deallocation to pages in the file
+ *
+ * All public methods may be called concurrently.  A hit takes only the latch
+ * of one hash table partition plus an atomic pin; misses ask the replacement
+ * policy for a victim concurrently, each thread claiming frames by
+ * try-locking their latches.
+ *
+ * An optional background cleaner (startCleaner()) keeps a reserve of clean,
+ * unpinned frames between a low and a high watermark, so that misses take a
+ * frame off the reserve without running the replacement policy or writing a
+ * dirty page on the caller's thread.
+ *
+ * Read-ahead: a prefetch thread reads pages into unpinned frames ahead of a
+ * scan, either on an explicit readAhead() hint or, once setReadAhead() is
+ * given a window, when readPage() sees a file being read sequentially.
+ *
+ * The pool can be resized while in use, up to the capacity it was created
+ * with: see resize().
+ *
+ * Checkpoints: a checkpoint thread writes back every page dirty when the
+ * checkpoint began, while the pool keeps serving requests, without evicting
+ * anything or waiting for pins to be dropped; see checkpoint().
+ */
+class BufMgr {
+ private:
+  /**
+   * Number of frames in the buffer pool.  Frames from here up to the
+   * capacity are retired and are never claimed.
+   */
+  std::atomic<std::uint32_t> numBufs;
 
   /**
    * Hash table mapping (File, page) to frame
@@ -174,30 +497,578 @@ class BufMgr {
   BufStats bufStats;
 
   /**
-   * Advance clock to next frame in the buffer pool
+   * Memory of the frames of the buffer pool
    */
-  void advanceClock();
+  PageArena arena;
 
   /**
-   * Allocate a free frame.
+   * Replacement policy choosing the frames to evict
+   */
+  std::unique_ptr<ReplacementPolicy> policy;
+
+  /**
+   * Engine the reads of loadBatch() and the writes of writeBack() are issued
+   * through, all of a batch in flight at once
+   */
+  std::unique_ptr<IoEngine> ioEngine;
+
+  /**
+   * Claim callback handed to the replacement policy: latches the frame
+   * exclusively if it is unpinned and nobody else holds its latch.
+   *
+   * @param frame   Frame to claim
+   * @return  True if the frame is now latched by the caller.
+   */
+  bool tryClaim(FrameId frame);
+
+  /**
+   * Allocate a free frame.  The frame is returned unpinned, invalid, absent
+   * from the hash table and with its latch held exclusively; the caller must
+   * release the latch.
    *
    * @param frame   	Frame reference, frame ID of allocated frame returned
    * via this variable
+   * @param key     Hash table key of the page the frame is for, or 0 for a
+   * newly allocated page
+   * @param ring    Access strategy ring of the caller, or null
    * @throws BufferExceededException If no such buffer is found which can be
    * allocated
    */
-  void allocBuf(FrameId& frame);
+  void allocBuf(FrameId& frame, std::uint64_t key, BufferRing* ring = nullptr);
+
+  /**
+   * Claim the ring's next frame for reuse, evicting the page the ring read
+   * into it.
+   *
+   * @param ring    Access strategy ring
+   * @param frame   Frame claimed, latched exclusively
+   * @return  False if the ring has no reusable frame at its position.
+   */
+  bool claimFromRing(BufferRing& ring, FrameId& frame);
+
+  /**
+   * Writes back the page in a frame if it is dirty and removes it from the
+   * buffer pool.  The caller must hold the frame latch exclusively and the
+   * frame must be valid.  Only this one page is written.
+   *
+   * @param frame   Frame to empty
+   * @param evicted True if the frame was chosen by the replacement policy
+   * @param written If not null, set to true if the page was written back
+   * @return  False if the frame is pinned; nothing is done then.
+   */
+  bool evictFrame(FrameId frame, const bool evicted, bool* written = nullptr);
+
+  /**
+   * Empties a range of retired frames, writing back dirty pages.  Each frame
+   * is latched only while its own page is removed; pinned frames are
+   * retried until their pins are dropped.
+   *
+   * @param first   First frame to empty
+   * @param end     Frame after the last one to empty
+   */
+  void drainFrames(FrameId first, FrameId end);
+
+  /**
+   * Serializes resize() calls
+   */
+  std::mutex resizeLatch;
+
+  /**
+   * Frames of the free-frame reserve: unpinned, invalid and absent from the
+   * hash table when they were added.  Guarded by freeLatch.
+   */
+  std::vector<FrameId> freeList;
+
+  /**
+   * True for the frames currently on freeList.  Guarded by freeLatch.
+   */
+  std::vector<bool> onFreeList;
+
+  /**
+   * Latch protecting the reserve, the watermarks and cleanerStop
+   */
+  std::mutex freeLatch;
+
+  /**
+   * Signalled when the reserve drops below the low watermark
+   */
+  std::condition_variable cleanerWakeup;
+
+  /**
+   * Background cleaner thread, if started
+   */
+  std::thread cleaner;
+
+  /**
+   * True while the cleaner is running and misses should use the reserve
+   */
+  std::atomic<bool> cleanerRunning;
+
+  /**
+   * Tells the cleaner thread to exit
+   */
+  bool cleanerStop;
+
+  /**
+   * The cleaner refills the reserve to highWater once it drops below lowWater
+   */
+  std::uint32_t lowWater;
+  std::uint32_t highWater;
+
+  /**
+   * A range of pages for the prefetch thread to read
+   */
+  struct PrefetchRequest {
+    File file;
+    PageId first;
+    std::uint32_t count;
+  };
+
+  /**
+   * Sequential access detection for one file
+   */
+  struct ScanState {
+    /**
+     * Last page requested
+     */
+    PageId last;
+
+    /**
+     * Number of consecutive pages requested in a row, ending at last
+     */
+    std::uint32_t run;
+
+    /**
+     * Highest page already queued for read-ahead
+     */
+    PageId ahead;
+  };
+
+  /**
+   * Consecutive pages a file must be read in before read-ahead starts
+   */
+  static const std::uint32_t SEQUENTIAL_RUN = 4;
+
+  /**
+   * Most pages the read-ahead thread reads in one batch
+   */
+  static const std::uint32_t PREFETCH_BATCH = 64;
+
+  /**
+   * Pages to keep read ahead of a sequential reader; 0 disables detection
+   */
+  std::atomic<std::uint32_t> readAheadWindow;
+
+  /**
+   * Latch protecting prefetchQueue, scans, prefetchActive and prefetchStop
+   */
+  std::mutex prefetchLatch;
+
+  /**
+   * Read-ahead requests not yet started
+   */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+  /**
+   * Sequential access detection state, by file
+   */
+  std::unordered_map<FileId, ScanState> scans;
+
+  /**
+   * File whose pages the prefetch thread is reading, or 0
+   */
+  FileId prefetchActive;
+
+  /**
+   * Tells the prefetch thread to exit
+   */
+  bool prefetchStop;
+
+  /**
+   * Signalled when a request is queued or the prefetch thread should exit
+   */
+  std::condition_variable prefetchWakeup;
+
+  /**
+   * Signalled when the prefetch thread finishes a request
+   */
+  std::condition_variable prefetchIdle;
+
+  /**
+   * Prefetch thread, started by the first read-ahead request
+   */
+  std::thread prefetcher;
+
+  /**
+   * Dirty clock, ticked whenever a page goes from clean to dirty
+   */
+  std::atomic<std::uint64_t> dirtyClock;
+
+  /**
+   * Latch protecting the checkpoint state below
+   */
+  std::mutex checkpointLatch;
+
+  /**
+   * Number of the last checkpoint requested
+   */
+  std::uint64_t checkpointsRequested;
+
+  /**
+   * Marker of the last checkpoint completed
+   */
+  Checkpoint lastCheckpoint;
+
+  /**
+   * Tells the checkpoint thread to exit
+   */
+  bool checkpointStop;
+
+  /**
+   * Signalled when a checkpoint is requested or the thread should exit
+   */
+  std::condition_variable checkpointWakeup;
+
+  /**
+   * Signalled when a checkpoint completes
+   */
+  std::condition_variable checkpointDone;
+
+  /**
+   * Checkpoint thread, started by the first checkpoint request
+   */
+  std::thread checkpointer;
+
+  /**
+   * Body of the checkpoint thread.
+   */
+  void checkpointLoop();
+
+  /**
+   * Write back every page first dirtied at or before a dirty clock reading.
+   *
+   * @return  Marker of the checkpoint, without its number.
+   */
+  Checkpoint writeCheckpoint(std::uint64_t dirtyBound);
+
+  /**
+   * Mark the page of a pinned frame dirty, starting its dirty clock if it
+   * was clean.
+   */
+  void markDirty(BufDesc& desc);
+
+  /**
+   * Read a page that is not in the buffer pool into a newly allocated frame.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param frame   Frame the page was read into
+   * @param prefetch  True to leave the frame unpinned and mark it read ahead;
+   * otherwise it is returned pinned
+   * @param ring    Access strategy ring to take the frame from, or null
+   * @return  False if another thread brought the page in first.
+   */
+  bool loadPage(File& file, const PageId pageNo, FrameId& frame,
+                const bool prefetch, BufferRing* ring = nullptr);
+
+  /**
+   * Queue read-ahead if pageNo continues a sequential run in its file.
+   */
+  void detectSequential(File& file, const PageId pageNo);
+
+  /**
+   * Queue a read-ahead request and start the prefetch thread if needed.
+   * The caller holds prefetchLatch.
+   */
+  void queuePrefetch(File& file, PageId first, std::uint32_t count);
+
+  /**
+   * Drop queued read-ahead of the file and wait for any in progress.
+   */
+  void cancelReadAhead(const File& file);
+
+  /**
+   * Body of the prefetch thread
+   */
+  void prefetchLoop();
+
+  /**
+   * Pin the page, reading it in if needed; readPage() without the Page
+   * pointer.
+   *
+   * @return  Frame holding the pinned page.
+   */
+  FrameId fetchFrame(File& file, const PageId pageNo, BufferRing* ring);
+
+  /**
+   * Pin a batch of pages, reading the missing ones in runs of consecutive
+   * pages; readPages() without the Page pointers.
+   *
+   * @param frames  Set to the frame holding each page, in request order.
+   */
+  void fetchFrames(File& file, const std::vector<PageId>& pageNos,
+                   std::vector<FrameId>& frames);
+
+  /**
+   * Read pages that are not resident into newly allocated frames, one run
+   * of consecutive pages per read.
+   *
+   * @param pageNos   Pages to read, sorted and distinct.
+   * @param frames    Set to the frame each page was read into, or UINT32_MAX
+   * for a page another thread was already reading.
+   * @param prefetch  True to leave the frames unpinned, marked as read ahead.
+   */
+  void loadBatch(File& file, const std::vector<PageId>& pageNos,
+                 std::vector<FrameId>& frames, bool prefetch);
+
+  /**
+   * Most frames flushFile() holds latched while writing them back
+   */
+  static const std::uint32_t WRITE_BATCH = 256;
+
+  /**
+   * Write the dirty pages among latched frames back in runs of consecutive
+   * pages, sorted by file and page number, and mark them clean.
+   *
+   * @param frames  Frames to write back, all latched by the caller; sorted
+   * in place.
+   */
+  void writeBack(std::vector<FrameId>& frames);
+
+  /**
+   * File the hot page list is written to on destruction, if not empty
+   */
+  std::string hotPagesFile;
+
+  /**
+   * Allocate a page in the file and pin it in a frame; allocPage() without
+   * the Page pointer.
+   *
+   * @return  Frame holding the pinned page.
+   */
+  FrameId allocFrame(File& file, PageId& pageNo, BufferRing* ring);
+
+  /**
+   * Drop a pin on a frame held by a PinnedPage, without a hash table lookup.
+   * Never throws, as PinnedPage calls it from its destructor.
+   *
+   * @param frame   Frame holding the pinned page
+   * @param dirty   True if the page needs to be marked dirty
+   */
+  void unpinFrame(const FrameId frame, const bool dirty) noexcept;
+
+  /**
+   * Checks that the page in a pinned frame may be dirtied.
+   *
+   * @param frame   Frame holding the pinned page
+   * @throws  ReadOnlyFileException If the page was read through a file
+   * opened with File::openReadOnly(), so it could never be written back
+   */
+  void checkDirtiable(const FrameId frame) const;
+
+  friend class PinnedPage;
+
+  /**
+   * Take a frame off the reserve, latched exclusively.
+   *
+   * @param frame   Frame taken from the reserve
+   * @return  False if the reserve is empty.
+   */
+  bool popFree(FrameId& frame);
+
+  /**
+   * Evict frames chosen by the replacement policy, writing back dirty ones,
+   * until the reserve reaches the high watermark.
+   */
+  void refillReserve();
+
+  /**
+   * Body of the cleaner thread
+   */
+  void cleanerLoop();
+
+  /**
+   * Pin (file, pageNo) if it is resident, waiting for an in-progress read of
+   * the page to complete.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param frame   Frame holding the page, if found
+   * @return  True if the page was found and pinned.
+   */
+  bool pinResident(const File& file, const PageId pageNo, FrameId& frame);
 
  public:
   /**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated: frame i is
+   * bufPool[i], all of them in one contiguous arena
    */
-  std::vector<Page> bufPool;
+  Page* bufPool;
 
   /**
    * Constructor of BufMgr class
+   *
+   * @param bufs    Number of frames in the buffer pool
+   * @param policyType  Page replacement policy to use
+   * @param maxBufs Number of frames the pool can be grown to with resize();
+   * less than bufs means bufs.  Only address space is set aside for frames
+   * beyond bufs until they are used.
+   */
+  BufMgr(std::uint32_t bufs,
+         ReplacementPolicyType policyType = ReplacementPolicyType::CLOCK,
+         std::uint32_t maxBufs = 0);
+
+  /**
+   * Destructor of BufMgr class.  Stops the cleaner if it is running.
    */
-  BufMgr(std::uint32_t bufs);
+  ~BufMgr();
+
+  /**
+   * Start the background cleaner, which keeps between lowWater and highWater
+   * clean, unpinned frames ready for misses.  Restarts it with the new
+   * watermarks if it is already running.  Must not be called concurrently
+   * with startCleaner() or stopCleaner().
+   *
+   * @param lowWater  The cleaner refills the reserve when it drops below this
+   * @param highWater Size the reserve is refilled to, at most the pool size
+   */
+  void startCleaner(std::uint32_t lowWater, std::uint32_t highWater);
+
+  /**
+   * Number of frames in the buffer pool
+   */
+  std::uint32_t size() const { return numBufs; }
+
+  /**
+   * Number of frames the buffer pool can be resized to
+   */
+  std::uint32_t capacity() const { return arena.capacity(); }
+
+  /**
+   * Change the number of frames in the buffer pool while it is in use.
+   *
+   * Growing makes the new frames free and rehashes the hash table one
+   * partition at a time.  Shrinking retires the frames past the new size
+   * first, so no new page goes into them, then drains them one at a time:
+   * dirty pages are written back and pages are dropped from the pool.
+   * Readers only ever wait for the one frame being drained.  Shrinking waits
+   * for pins held on pages in the retired frames to be dropped, so the caller
+   * must not hold any itself.
+   *
+   * If writing back a page fails the exception propagates; the pool keeps
+   * its new size and pages not drained yet stay readable in their frames
+   * until a later resize() or flushFile() removes them.
+   *
+   * @param newBufs New number of frames
+   * @throws BufferExceededException If newBufs is 0 or above capacity()
+   */
+  void resize(std::uint32_t newBufs);
+
+  /**
+   * Stop the background cleaner and empty the reserve.  Does nothing if the
+   * cleaner is not running.
+   */
+  void stopCleaner();
+
+  /**
+   * Read pages into the buffer pool in the background, without pinning
+   * them.  Pages already resident, and frames that cannot be freed, are
+   * skipped; reading stops at the first page that does not exist.
+   *
+   * @param file   	File object
+   * @param first   First page to read
+   * @param count   Number of consecutive pages to read
+   */
+  void readAhead(File& file, const PageId first, const std::uint32_t count);
+
+  /**
+   * Set how many pages to read ahead of a file that readPage() sees being
+   * read sequentially.  0, the default, turns detection off.
+   *
+   * @param window  Number of pages to keep read ahead
+   */
+  void setReadAhead(const std::uint32_t window) { readAheadWindow = window; }
+
+  /**
+   * Replace the I/O engine batched reads (readPages(), read-ahead) and
+   * write-back (flushFile(), checkpoints) go through.  The default is
+   * IoEngineType::AUTO.  Must not be called while other threads use the
+   * buffer manager or read-ahead or a checkpoint is in progress.
+   *
+   * @param type        Engine to use
+   * @param queueDepth  Most requests the engine keeps in flight at once
+   * @throws BadgerDbException If type is URING and io_uring is not available
+   */
+  void setIoEngine(IoEngineType type,
+                   std::uint32_t queueDepth = IoEngine::DEFAULT_QUEUE_DEPTH);
+
+  /**
+   * Write the pages in the buffer pool to a hot page list, hottest first as
+   * ranked by the replacement policy.  Pages may come and go meanwhile.
+   *
+   * @param path    File to write the list to
+   * @return  Number of pages written.
+   * @throws BadgerDbException If the file cannot be written
+   */
+  std::uint32_t dumpHotPages(const std::string& path);
+
+  /**
+   * Warm the buffer pool up with the pages of a hot page list written by
+   * dumpHotPages(), as many of the hottest ones as there are frames.  The
+   * pages are read by the read-ahead thread in ascending page order, in runs
+   * of consecutive pages, so the pool serves requests while it warms up.
+   * Pages of files that no longer exist are skipped.
+   *
+   * @param path    File to read the list from
+   * @return  Number of pages queued for reading.
+   * @throws FileNotFoundException If there is no such file
+   * @throws BadgerDbException If the file is not a hot page list
+   */
+  std::uint32_t loadHotPages(const std::string& path);
+
+  /**
+   * Set a file to write the hot page list to when the buffer manager is
+   * destroyed; an empty path, the default, writes none.
+   */
+  void setHotPagesFile(const std::string& path) { hotPagesFile = path; }
+
+  /**
+   * Start a checkpoint in the background and return its number.  The
+   * checkpoint writes back every page that is dirty when it begins, in runs
+   * of consecutive pages, while the pool keeps serving requests.  Pinned
+   * pages are written too, and nothing is evicted.  The headers of all open
+   * files are then written back with File::syncAll().  Requests made while a
+   * checkpoint is running are served together by the next one.
+   *
+   * @return  Number of the checkpoint, to pass to waitForCheckpoint().
+   */
+  std::uint64_t beginCheckpoint();
+
+  /**
+   * Wait for a checkpoint started by beginCheckpoint() to complete.
+   *
+   * @param number  Number of the checkpoint
+   * @return  Marker of the checkpoint that satisfied it.
+   */
+  Checkpoint waitForCheckpoint(std::uint64_t number);
+
+  /**
+   * Take a checkpoint and wait for it to complete.
+   *
+   * @return  Marker of the checkpoint.
+   */
+  Checkpoint checkpoint() { return waitForCheckpoint(beginCheckpoint()); }
+
+  /**
+   * Return the marker of the last checkpoint completed.
+   */
+  Checkpoint getLastCheckpoint();
+
+  /**
+   * Return the dirty pages in the buffer pool, oldest first by the time they
+   * went from clean to dirty.  Pages may be dirtied or cleaned meanwhile.
+   */
+  std::vector<DirtyPage> dirtyPageTable();
 
   /**
    * Reads the given page from the file into a frame and returns the pointer to
@@ -209,8 +1080,60 @@ class BufMgr {
    * @param PageNo  Page number in the file to be read
    * @param page  	Reference to page pointer. Used to fetch the Page object
    * in which requested page from file is read in.
+   * @param ring    Access strategy ring to read the page into on a miss, or
+   * null to use the shared pool
+   */
+  void readPage(File& file, const PageId pageNo, Page*& page,
+                BufferRing* ring = nullptr);
+
+  /**
+   * Reads the given page like readPage() above, returning a handle that
+   * unpins it when it goes out of scope.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @param ring    Access strategy ring, or null
+   * @return  Handle holding the pin on the page.
    */
-  void readPage(File& file, const PageId pageNo, Page*& page);
+  PinnedPage readPage(File& file, const PageId pageNo,
+                      BufferRing* ring = nullptr);
+
+  /**
+   * Pins the given page if it is in the buffer pool, without reading it from
+   * disk and without throwing if it is not.  A page found must be unpinned
+   * with unPinPage() as after readPage().
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param page  	Set to the page if it is found
+   * @return  True if the page was in the buffer pool and is now pinned.
+   */
+  bool readPageIfResident(File& file, const PageId pageNo, Page*& page);
+
+  /**
+   * Reads a batch of pages, pinning each of them, like one readPage() call per
+   * page.  Misses are read in runs of consecutive page numbers, one request
+   * per run, so pages that lie together in the file cost one I/O.  If any
+   * page cannot be read, no page of the batch is left pinned.
+   *
+   * @param file   	File object
+   * @param pageNos Pages to read, in any order; a page may appear more than
+   * once and is then pinned once per appearance
+   * @param pages   Set to the pointer to each page, in the order of pageNos
+   */
+  void readPages(File& file, const std::vector<PageId>& pageNos,
+                 std::vector<Page*>& pages);
+
+  /**
+   * Reads a batch of pages like readPages() above, returning handles that
+   * unpin them when they go out of scope.
+   *
+   * @param file   	File object
+   * @param pageNos Pages to read
+   * @return  One handle per entry of pageNos, in the same order.
+   */
+  std::vector<PinnedPage> readPages(File& file,
+                                    const std::vector<PageId>& pageNos);
 
   /**
    * Unpin a page from memory since it is no longer required for it to remain in
@@ -221,6 +1144,9 @@ class BufMgr {
    * @param dirty		True if the page to be unpinned needs to be
    * marked dirty
    * @throws  PageNotPinnedException If the page is not already pinned
+   * @throws  ReadOnlyFileException If dirty is true and the file was opened
+   * with File::openReadOnly(); the pin is dropped and the page is not marked
+   * dirty
    */
   void unPinPage(File& file, const PageId pageNo, const bool dirty);
 
@@ -233,13 +1159,29 @@ class BufMgr {
    * returned via this reference.
    * @param page  	Reference to page pointer. The newly allocated in-memory
    * Page object is returned via this reference.
+   * @param ring    Access strategy ring to put the page in, or null to use
+   * the shared pool
+   */
+  void allocPage(File& file, PageId& pageNo, Page*& page,
+                 BufferRing* ring = nullptr);
+
+  /**
+   * Allocates a new page like allocPage() above, returning a handle that
+   * unpins it when it goes out of scope.  The page number is available from
+   * the handle.
+   *
+   * @param file   	File object
+   * @param ring    Access strategy ring, or null
+   * @return  Handle holding the pin on the new page.
    */
-  void allocPage(File& file, PageId& pageNo, Page*& page);
+  PinnedPage allocPage(File& file, BufferRing* ring = nullptr);
 
   /**
    * Writes out all dirty pages of the file to disk.
    * All the frames assigned to the file need to be unpinned from buffer pool
    * before this function can be successfully called. Otherwise Error returned.
+   * Costs time in the number of the file's pages in the pool, not the size
+   * of the pool; dirty pages are written in ascending page order.
    *
    * @param file   	File object
    * @throws  PagePinnedException If any page of the file is pinned in the
@@ -256,6 +1198,7 @@ class BufMgr {
    *
    * @param file   	File object
    * @param PageNo  Page number
+   * @throws  PagePinnedException If the page is pinned in the buffer pool
    */
   void disposePage(File& file, const PageId PageNo);
 
@@ -0,0 +1,67 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "clock_policy.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(std::uint32_t numFrames, std::uint32_t maxFrames)
+    : numFrames(numFrames),
+      hand(numFrames - 1),
+      refbits(new std::atomic<bool>[maxFrames]) {
+  for (FrameId i = 0; i < maxFrames; i++) refbits[i] = false;
+}
+
+void ClockPolicy::recordInsert(FrameId frame, std::uint64_t key) {
+  refbits[frame].store(true, std::memory_order_relaxed);
+}
+
+void ClockPolicy::recordRemove(FrameId frame, std::uint64_t key,
+                               bool evicted) {
+  refbits[frame].store(false, std::memory_order_relaxed);
+}
+
+/**
+ * Gives up after two full turns of the clock, the first of which may only
+ * clear reference bits.
+ */
+bool ClockPolicy::pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                             FrameId& frame) {
+  const std::uint32_t frames = numFrames.load(std::memory_order_relaxed);
+  for (std::uint32_t i = 0; i < 2 * frames; i++) {
+    const FrameId id =
+        (hand.fetch_add(1, std::memory_order_relaxed) + 1) % frames;
+    if (refbits[id].load(std::memory_order_relaxed) &&
+        refbits[id].exchange(false, std::memory_order_relaxed)) {
+      continue;  // second chance
+    }
+    if (tryClaim(id)) {
+      frame = id;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockPolicy::resize(std::uint32_t newFrames) {
+  // retired frames simply fall off the clock
+  numFrames.store(newFrames, std::memory_order_relaxed);
+}
+
+void ClockPolicy::rankFrames(std::vector<FrameId>& frames) {
+  // referenced since the hand last passed them, then the rest
+  const std::uint32_t n = numFrames.load(std::memory_order_relaxed);
+  for (FrameId i = 0; i < n; i++) {
+    if (refbits[i].load(std::memory_order_relaxed)) frames.push_back(i);
+  }
+  for (FrameId i = 0; i < n; i++) {
+    if (!refbits[i].load(std::memory_order_relaxed)) frames.push_back(i);
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,57 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Single reference bit clock.
+ *
+ * Hits set the frame's reference bit; the hand clears set bits and evicts the
+ * first claimable frame whose bit is already clear.  No latch is taken
+ * anywhere, and concurrent sweepers each move the hand to a different frame.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  ClockPolicy(std::uint32_t numFrames, std::uint32_t maxFrames);
+
+  const char* name() const override { return "CLOCK"; }
+  void recordAccess(FrameId frame) override {
+    refbits[frame].store(true, std::memory_order_relaxed);
+  }
+  void recordInsert(FrameId frame, std::uint64_t key) override;
+  void recordRemove(FrameId frame, std::uint64_t key, bool evicted) override;
+  bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                  FrameId& frame) override;
+  void resize(std::uint32_t newFrames) override;
+  void rankFrames(std::vector<FrameId>& frames) override;
+
+ private:
+  /**
+   * Number of frames in use
+   */
+  std::atomic<std::uint32_t> numFrames;
+
+  /**
+   * Current position of clockhand; the frame under it is hand % numFrames
+   */
+  std::atomic<FrameId> hand;
+
+  /**
+   * Has this buffer frame been reference recently
+   */
+  std::unique_ptr<std::atomic<bool>[]> refbits;
+};
+
+}  // namespace badgerdb
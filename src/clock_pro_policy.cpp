@@ -0,0 +1,209 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "clock_pro_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ClockProPolicy::ClockProPolicy(std::uint32_t numFrames,
+                               std::uint32_t maxFrames)
+    : numFrames(numFrames),
+      coldTarget(std::max<std::uint32_t>(1, numFrames / 2)),
+      hotCount(0),
+      nonResidentCount(0),
+      entryOf(maxFrames),
+      refbits(new std::atomic<bool>[maxFrames]),
+      freeFrames(maxFrames) {
+  handHot = handCold = handTest = clock.end();
+  for (FrameId i = 0; i < maxFrames; i++) refbits[i] = false;
+  for (FrameId i = 0; i < numFrames; i++) freeFrames.pushBack(i);
+}
+
+ClockProPolicy::Hand ClockProPolicy::advance(Hand hand) {
+  if (clock.empty()) return clock.end();
+  if (hand == clock.end() || ++hand == clock.end()) return clock.begin();
+  return hand;
+}
+
+ClockProPolicy::Hand ClockProPolicy::insertAtHead(const Entry& entry) {
+  if (clock.empty()) {
+    clock.push_back(entry);
+    handHot = handCold = handTest = clock.begin();
+    return clock.begin();
+  }
+  return clock.insert(handHot, entry);
+}
+
+void ClockProPolicy::erase(Hand entry) {
+  if (handHot == entry) handHot = advance(handHot);
+  if (handCold == entry) handCold = advance(handCold);
+  if (handTest == entry) handTest = advance(handTest);
+  clock.erase(entry);
+  if (clock.empty()) handHot = handCold = handTest = clock.end();
+}
+
+bool ClockProPolicy::endTest(Hand entry) {
+  entry->test = false;
+  coldTarget = std::max<std::uint32_t>(1, coldTarget - 1);
+  if (entry->frame != FrameList::NONE) return false;
+  nonResident.erase(entry->key);
+  --nonResidentCount;
+  erase(entry);
+  return true;
+}
+
+void ClockProPolicy::runHandHot() {
+  for (std::size_t steps = clock.size(); steps > 0 && handHot != clock.end();
+       steps--) {
+    Hand entry = handHot;
+    if (entry->hot) {
+      handHot = advance(entry);
+      if (!refbits[entry->frame].exchange(false, std::memory_order_relaxed)) {
+        entry->hot = false;
+        --hotCount;
+        return;
+      }
+      continue;
+    }
+    if (entry->test && endTest(entry)) continue;  // erase() moved the hand
+    handHot = advance(entry);
+  }
+}
+
+void ClockProPolicy::demoteExcessHot() {
+  while (hotCount > 0 && hotCount > numFrames - coldTarget) {
+    const std::uint32_t before = hotCount;
+    runHandHot();
+    if (hotCount == before) return;  // every hot page was just referenced
+  }
+}
+
+void ClockProPolicy::runHandTest() {
+  for (std::size_t steps = clock.size();
+       nonResidentCount > numFrames && steps > 0 && handTest != clock.end();
+       steps--) {
+    Hand entry = handTest;
+    if (!entry->hot && entry->test && endTest(entry)) continue;
+    handTest = advance(entry);
+  }
+}
+
+void ClockProPolicy::recordInsert(FrameId frame, std::uint64_t key) {
+  std::lock_guard<std::mutex> guard(latch);
+  freeFrames.remove(frame);
+  refbits[frame].store(false, std::memory_order_relaxed);
+  auto ghost = nonResident.find(key);
+  if (ghost != nonResident.end()) {
+    // re-referenced within its test period: the cold area is too small
+    coldTarget = std::min<std::uint32_t>(
+        coldTarget + 1, std::max<std::uint32_t>(1, numFrames - 1));
+    const Hand old = ghost->second;
+    nonResident.erase(ghost);
+    --nonResidentCount;
+    erase(old);
+    entryOf[frame] = insertAtHead(Entry{key, frame, true, false});
+    ++hotCount;
+    demoteExcessHot();
+  } else {
+    entryOf[frame] = insertAtHead(Entry{key, frame, false, true});
+  }
+}
+
+void ClockProPolicy::recordRemove(FrameId frame, std::uint64_t key,
+                                  bool evicted) {
+  std::lock_guard<std::mutex> guard(latch);
+  const Hand entry = entryOf[frame];
+  if (entry->hot) --hotCount;
+  if (evicted && !entry->hot && entry->test) {
+    // keep the metadata until the test period ends
+    entry->frame = FrameList::NONE;
+    nonResident[key] = entry;
+    ++nonResidentCount;
+    runHandTest();
+  } else {
+    erase(entry);
+  }
+  refbits[frame].store(false, std::memory_order_relaxed);
+  if (frame < numFrames) freeFrames.pushBack(frame);
+}
+
+bool ClockProPolicy::pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                                FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (freeFrames.claimFromBack(tryClaim, frame)) return true;
+
+  // HAND_cold
+  for (std::size_t steps = 2 * clock.size();
+       steps > 0 && handCold != clock.end(); steps--) {
+    if (hotCount > 0 && hotCount == clock.size() - nonResidentCount) {
+      runHandHot();  // no resident cold page left to evict
+    }
+    const Hand entry = handCold;
+    handCold = advance(entry);
+    if (entry->hot || entry->frame == FrameList::NONE) continue;
+    if (refbits[entry->frame].exchange(false, std::memory_order_relaxed)) {
+      if (entry->test) {
+        entry->test = false;
+        entry->hot = true;
+        ++hotCount;
+        demoteExcessHot();
+      } else {
+        entry->test = true;
+        clock.splice(handHot, clock, entry);
+      }
+      continue;
+    }
+    if (tryClaim(entry->frame)) {
+      frame = entry->frame;
+      return true;
+    }
+  }
+
+  // every cold page is pinned; take any resident page that is not
+  for (const Entry& entry : clock) {
+    if (entry.frame != FrameList::NONE && tryClaim(entry.frame)) {
+      frame = entry.frame;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ClockProPolicy::resize(std::uint32_t newFrames) {
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId i = numFrames; i < newFrames; i++) freeFrames.pushBack(i);
+  for (FrameId i = newFrames; i < numFrames; i++) freeFrames.remove(i);
+  numFrames = newFrames;
+  coldTarget = std::min(coldTarget, std::max<std::uint32_t>(1, numFrames - 1));
+  demoteExcessHot();
+  runHandTest();
+}
+
+void ClockProPolicy::rankFrames(std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(latch);
+  // hot pages, then cold pages in their test period, then the other cold ones
+  for (const Entry& entry : clock) {
+    if (entry.frame != FrameList::NONE && entry.hot) {
+      frames.push_back(entry.frame);
+    }
+  }
+  for (const Entry& entry : clock) {
+    if (entry.frame != FrameList::NONE && !entry.hot && entry.test) {
+      frames.push_back(entry.frame);
+    }
+  }
+  for (const Entry& entry : clock) {
+    if (entry.frame != FrameList::NONE && !entry.hot && !entry.test) {
+      frames.push_back(entry.frame);
+    }
+  }
+}
+
+}  // namespace badgerdb
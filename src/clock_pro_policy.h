@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "policy_lists.h"
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief CLOCK-Pro (Jiang, Chen and Zhang).
+ *
+ * One circular list holds resident hot pages, resident cold pages and the
+ * metadata of recently evicted cold pages that are still in their test
+ * period.  HAND_cold evicts cold pages, promoting a referenced cold page in
+ * its test period to hot.  HAND_hot demotes unreferenced hot pages and ends
+ * test periods.  HAND_test ends test periods to bound the non-resident
+ * entries to the number of frames.  The size of the cold area adapts: a miss
+ * on a page in its test period grows it, a test period ending without a
+ * reference shrinks it.
+ *
+ * Hits only set an atomic reference bit, as in CLOCK.
+ */
+class ClockProPolicy : public ReplacementPolicy {
+ public:
+  ClockProPolicy(std::uint32_t numFrames, std::uint32_t maxFrames);
+
+  const char* name() const override { return "CLOCK-Pro"; }
+  void recordAccess(FrameId frame) override {
+    refbits[frame].store(true, std::memory_order_relaxed);
+  }
+  void recordInsert(FrameId frame, std::uint64_t key) override;
+  void recordRemove(FrameId frame, std::uint64_t key, bool evicted) override;
+  bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                  FrameId& frame) override;
+  void resize(std::uint32_t newFrames) override;
+  void rankFrames(std::vector<FrameId>& frames) override;
+
+ private:
+  /**
+   * @brief A page in the clock.
+   */
+  struct Entry {
+    std::uint64_t key;
+
+    /**
+     * Frame holding the page, or FrameList::NONE if it is not resident
+     */
+    FrameId frame;
+
+    bool hot;
+
+    /**
+     * True while a cold page is in its test period
+     */
+    bool test;
+  };
+
+  typedef std::list<Entry>::iterator Hand;
+
+  /**
+   * Moves a hand one entry clockwise, wrapping around.
+   */
+  Hand advance(Hand hand);
+
+  /**
+   * Inserts an entry at the list head, just behind HAND_hot.
+   */
+  Hand insertAtHead(const Entry& entry);
+
+  /**
+   * Removes an entry, moving any hand that points at it.
+   */
+  void erase(Hand entry);
+
+  /**
+   * Ends the test period of a cold entry, dropping it if it is not resident.
+   * Shrinks the cold target.
+   *
+   * @return  True if the entry was dropped.
+   */
+  bool endTest(Hand entry);
+
+  /**
+   * Runs HAND_hot until one hot page has been demoted (or a full turn).
+   */
+  void runHandHot();
+
+  /**
+   * Runs HAND_hot until the hot pages fit next to the cold target.
+   */
+  void demoteExcessHot();
+
+  /**
+   * Runs HAND_test until the number of non-resident entries fits.
+   */
+  void runHandTest();
+
+  std::mutex latch;
+  std::uint32_t numFrames;
+
+  /**
+   * Target number of resident cold pages, in [1, numFrames - 1]
+   */
+  std::uint32_t coldTarget;
+
+  std::uint32_t hotCount;
+  std::uint32_t nonResidentCount;
+
+  std::list<Entry> clock;
+  Hand handHot;
+  Hand handCold;
+  Hand handTest;
+
+  /**
+   * Entry of each resident frame
+   */
+  std::vector<Hand> entryOf;
+
+  /**
+   * Entries of non-resident pages in their test period
+   */
+  std::unordered_map<std::uint64_t, Hand> nonResident;
+
+  std::unique_ptr<std::atomic<bool>[]> refbits;
+  FrameList freeFrames;
+};
+
+}  // namespace badgerdb
@@ -8,33 +8,136 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
 #include <cstdio>
-#include <fstream>
+#include <cstring>
+#include <exception>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+namespace {
+
+/**
+ * Tag following the file header on the first page of a page-aligned file.
+ */
+struct LayoutTag {
+  char magic[8];
+  std::uint32_t version;
+};
+
+const char LAYOUT_MAGIC[8] = {'B', 'D', 'B', 'L', 'A', 'Y', 'O', 'T'};
+
+/**
+ * Returns the node a slot of a radix tree points to, creating it first if
+ * the slot is empty.  Of threads racing to create it, one wins and the
+ * others delete theirs.
+ */
+template <typename Node>
+Node *childOf(std::atomic<Node *> &slot) {
+  Node *node = slot.load(std::memory_order_acquire);
+  if (node != nullptr) return node;
+  std::unique_ptr<Node> created(new Node());
+  if (slot.compare_exchange_strong(node, created.get(),
+                                   std::memory_order_acq_rel,
+                                   std::memory_order_acquire)) {
+    return created.release();
+  }
+  return node;
+}
+
+/**
+ * Syncs the directory holding a file, so that a rename onto the file
+ * survives a crash.
+ *
+ * @throws  FileIOException   If the directory cannot be opened or synced.
+ */
+void syncDirectoryOf(const std::string &filename) {
+  const std::string::size_type slash = filename.find_last_of('/');
+  const std::string directory =
+      slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+  const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) throw FileIOException(directory, errno);
+  const int result = ::fsync(fd);
+  const int error = errno;
+  ::close(fd);
+  if (result != 0) throw FileIOException(directory, error);
+}
+
+}  // namespace
+
+File::DescriptorMap File::open_descriptors_;
 File::CountMap File::open_counts_;
+File::MutexMap File::open_mutexes_;
+File::FreeSpaceMapMap File::open_free_space_maps_;
+File::HeaderCacheMap File::open_headers_;
+File::PageDirectoryMap File::open_page_directories_;
+File::SyncStateMap File::open_sync_states_;
+File::IdMap File::file_ids_;
+std::mutex File::open_mutex_;
 
-File File::create(const std::string &filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string &filename, const FileFormat format,
+                  const FileLayout layout) {
+  return File(filename, true /* create_new */, format, layout);
 }
 
 File File::open(const std::string &filename) {
   return File(filename, false /* create_new */);
 }
 
+File File::openReadOnly(const std::string &filename) {
+  File file(filename, false /* create_new */);
+  struct stat st;
+  if (::fstat(file.descriptor_->fd, &st) != 0) {
+    throw FileIOException(filename, errno);
+  }
+  const std::size_t bytes = st.st_size;
+  if (bytes < sizeof(FileHeader)) {
+    throw BadgerDbException("File has no header: " + filename);
+  }
+  void *base = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED,
+                      file.descriptor_->fd, 0 /* offset */);
+  if (base == MAP_FAILED) {
+    throw FileIOException(filename, errno);
+  }
+  // another File for the file may hold a newer header than the one on disk
+  const FileHeader header = file.readHeader();
+  const PageId whole_pages =  // counting the header
+      file.layout_ == FileLayout::PAGE_ALIGNED
+          ? bytes / Page::SIZE
+          : 1 + (bytes - sizeof(FileHeader)) / Page::SIZE;
+  file.mapping_ = std::make_shared<const Mapping>(
+      static_cast<const char *>(base), bytes,
+      std::min(header.num_pages, whole_pages));
+  std::lock_guard<std::mutex> guard(open_mutex_);
+  file.id_ = idOf(filename, true /* mapped */);
+  return file;
+}
+
 void File::remove(const std::string &filename) {
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
@@ -49,40 +152,79 @@ bool File::isOpen(const std::string &filename) {
   if (!exists(filename)) {
     return false;
   }
+  std::lock_guard<std::mutex> guard(open_mutex_);
   return open_counts_.find(filename) != open_counts_.end();
 }
 
 bool File::exists(const std::string &filename) {
-  std::fstream file(filename);
-  if (file) {
-    file.close();
-    return true;
-  }
-
-  return false;
+  return ::access(filename.c_str(), F_OK) == 0;
 }
 
 File::File(const File &other)
     : filename_(other.filename_),
-      stream_(open_streams_[filename_]),
-      valid_(other.valid_) {
-  ++open_counts_[filename_];
+      id_(other.id_),
+      mapping_(other.mapping_),
+      format_(other.format_),
+      layout_(other.layout_),
+      valid_(other.valid_),
+      handle_(std::atomic_load(&other.handle_)) {
+  if (!valid_) return;
+  std::lock_guard<std::mutex> guard(open_mutex_);
+  descriptor_ = open_descriptors_[filename_];
+  io_mutex_ = open_mutexes_[filename_];
+  free_space_map_ = open_free_space_maps_[filename_];
+  header_cache_ = open_headers_[filename_];
+  page_directory_ = open_page_directories_[filename_];
+  sync_state_ = open_sync_states_[filename_];
+  OpenCount &count = open_counts_[filename_];
+  ++count.refs;
+  ++count.opens;
 }
 
 File &File::operator=(const File &rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  std::shared_ptr<const Mapping> mapping = rhs.mapping_;
+  std::shared_ptr<File> handle = std::atomic_load(&rhs.handle_);
   close();  // close my file and associate me with the new one
   filename_ = rhs.filename_;
+  format_ = rhs.format_;
+  layout_ = rhs.layout_;
   valid_ = rhs.valid_;
-  openIfNeeded(false /* create_new */);
+  if (valid_) openIfNeeded(false /* create_new */);
+  // after openIfNeeded(), which hands out the id of writable handles
+  id_ = rhs.id_;
+  mapping_ = mapping;
+  std::atomic_store(&handle_, handle);
   return *this;
 }
 
 File::~File() { close(); }
 
+std::shared_ptr<File> File::handle() const {
+  // self_ is set before the copy is published and never changes after
+  if (std::shared_ptr<File> self = self_.lock()) return self;
+  std::shared_ptr<File> handle = std::atomic_load(&handle_);
+  if (handle != nullptr) return handle;
+  std::shared_ptr<File> created = std::make_shared<File>(*this);
+  // the shared copy must not own itself, or it would never be freed
+  created->handle_.reset();
+  created->self_ = created;
+  if (std::atomic_compare_exchange_strong(&handle_, &handle, created)) {
+    return created;
+  }
+  return handle;  // another thread made one first
+}
+
 Page File::allocatePage() {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  // the neighbours rewritten below may be the target of a write in flight
+  waitForWrites();
   FileHeader header = readHeader();
+  if (format_ == FileFormat::BITMAP) {
+    return allocateFromBitmap(header);
+  }
   Page new_page;
   Page existing_page;
   if (header.num_free_pages > 0) {
@@ -157,9 +299,15 @@ Page File::readPage(const PageId page_number) const {
 
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  if (mapping_ && page_number < mapping_->num_pages) {
+    std::memcpy(static_cast<void *>(&page),
+                mapping_->base + pagePosition(page_number), Page::SIZE);
+  } else {
+    // past the end of the file the page keeps its initial, free contents
+    readAt(&page, Page::SIZE, pagePosition(page_number));
+  }
+  const Page *pages[] = {&page};
+  rememberPages(page_number, 1, pages);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
@@ -167,23 +315,200 @@ Page File::readPage(const PageId page_number, const bool allow_free) const {
   return page;
 }
 
-void File::writePage(const Page &new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+void File::readPages(const PageId first_page_number, const std::uint32_t count,
+                     Page *const *pages) const {
+  checkRun(first_page_number, count);
+  if (mapping_ && first_page_number + count <= mapping_->num_pages) {
+    for (std::uint32_t i = 0; i < count; i++) {
+      std::memcpy(static_cast<void *>(pages[i]),
+                  mapping_->base + pagePosition(first_page_number + i),
+                  Page::SIZE);
+    }
+    finishRead(first_page_number, count, pages, count * Page::SIZE);
+    return;
+  }
+  // Pages lie back to back in the file, so one preadv covers the whole run
+  // (or IOV_MAX pages of it); a short read is finished page by page.
+  const off_t position = pagePosition(first_page_number);
+  std::vector<iovec> iov(count);
+  for (std::uint32_t i = 0; i < count; i++) {
+    iov[i].iov_base = pages[i];
+    iov[i].iov_len = Page::SIZE;
+  }
+  for (std::uint32_t first = 0; first < count; first += IOV_MAX) {
+    const std::uint32_t batch = std::min<std::uint32_t>(count - first, IOV_MAX);
+    ssize_t n;
+    do {
+      n = ::preadv(descriptor_->fd, &iov[first], batch,
+                   position + first * Page::SIZE);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw FileIOException(filename_, errno);
+    finishRead(first_page_number + first, batch, pages + first, n);
+  }
+}
+
+void File::checkRun(const PageId first_page_number,
+                    const std::uint32_t count) const {
+  FileHeader header = readHeader();
+  if (first_page_number + count > header.num_pages) {
+    throw InvalidPageException(
+        std::max(first_page_number, header.num_pages), filename_);
+  }
+}
+
+void File::finishRead(const PageId first_page_number, const std::uint32_t count,
+                      Page *const *pages, const std::size_t bytes) const {
+  const off_t position = pagePosition(first_page_number);
+  for (std::uint32_t i = 0; i < count; i++) {
+    const std::size_t skip = i * Page::SIZE;
+    std::size_t got = bytes > skip ? bytes - skip : 0;
+    if (got > Page::SIZE) got = Page::SIZE;
+    if (got < Page::SIZE &&
+        readAt(reinterpret_cast<char *>(pages[i]) + got, Page::SIZE - got,
+               position + skip + got) < Page::SIZE - got) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+  }
+  rememberPages(first_page_number, count, pages);
+}
+
+PageId File::storedNextPage(const PageId page_number) {
+  const FileHeader header = readHeader();
+  if (page_number == Page::INVALID_NUMBER || page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  if (format_ == FileFormat::BITMAP) {
+    if (isBitmapPage(page_number) || !freeSpaceMap(header).test(page_number)) {
+      throw InvalidPageException(page_number, filename_);
+    }
+    return Page::INVALID_NUMBER;
+  }
+  std::atomic<PageId> &entry = page_directory_->entry(page_number);
+  PageId next = entry.load(std::memory_order_relaxed);
+  if (next == PageDirectory::UNKNOWN) {
+    next = PageDirectory::entryFor(readPageHeader(page_number));
+    entry.store(next, std::memory_order_relaxed);
+  }
+  if (next == PageDirectory::FREE) {
     // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+    throw InvalidPageException(page_number, filename_);
   }
+  return next;
+}
+
+void File::rememberPages(const PageId first_page_number,
+                         const std::uint32_t count,
+                         const Page *const *pages) const {
+  if (format_ != FileFormat::LINKED_LIST) return;
+  // A page written meanwhile has its entry already, which is kept: the copy
+  // read may predate the write.  Writers store their entry after writing the
+  // page, so one that races with this still has the last word.
+  for (std::uint32_t i = 0; i < count; i++) {
+    std::atomic<PageId> &entry = page_directory_->entry(first_page_number + i);
+    PageId next = entry.load(std::memory_order_relaxed);
+    if (next == PageDirectory::UNKNOWN) {
+      entry.compare_exchange_strong(
+          next, PageDirectory::entryFor(pages[i]->header_),
+          std::memory_order_relaxed);
+    }
+  }
+}
+
+void File::writePage(const Page &new_page) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
   // Page on disk may have had its next page pointer updated since it was read;
   // we don't modify that, but we do keep all the other modifications to the
   // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
+  PageHeader header = new_page.header_;
+  header.next_page_number = storedNextPage(new_page.page_number());
   writePage(new_page.page_number(), header, new_page);
 }
 
+void File::writePages(const PageId first_page_number,
+                      const std::uint32_t count, const Page *const *pages) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  std::vector<char> run;
+  buildRun(first_page_number, count, pages, run);
+  writeAt(run.data(), run.size(), pagePosition(first_page_number));
+}
+
+void File::buildRun(const PageId first_page_number, const std::uint32_t count,
+                    const Page *const *pages, std::vector<char> &run) {
+  // The next page pointers come from the page directory.  If it is missing
+  // some, the run on disk is read for them in one request first.
+  run.assign(count * Page::SIZE, 0);
+  if (format_ == FileFormat::LINKED_LIST) {
+    bool known = true;
+    for (std::uint32_t i = 0; i < count && known; i++) {
+      known = page_directory_->entry(first_page_number + i).load(
+                  std::memory_order_relaxed) != PageDirectory::UNKNOWN;
+    }
+    if (!known && first_page_number + count <= readHeader().num_pages) {
+      const std::uint32_t read =
+          readAt(run.data(), run.size(), pagePosition(first_page_number)) /
+          Page::SIZE;
+      for (std::uint32_t i = 0; i < read; i++) {
+        page_directory_->entry(first_page_number + i)
+            .store(PageDirectory::entryFor(*reinterpret_cast<const PageHeader *>(
+                       &run[i * Page::SIZE])),
+                   std::memory_order_relaxed);
+      }
+    }
+  }
+  for (std::uint32_t i = 0; i < count; i++) {
+    const PageId next_page_number = storedNextPage(first_page_number + i);
+    PageHeader *header = reinterpret_cast<PageHeader *>(&run[i * Page::SIZE]);
+    std::memcpy(header, pages[i], Page::SIZE);
+    header->next_page_number = next_page_number;
+  }
+}
+
+void File::prepareWrite(const PageId first_page_number,
+                        const std::uint32_t count, const Page *const *pages,
+                        std::vector<char> &run) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  buildRun(first_page_number, count, pages, run);
+  std::lock_guard<std::mutex> guard(descriptor_->writes_mutex);
+  descriptor_->writes_in_flight++;
+}
+
+void File::finishWrite(const PageId first_page_number, const char *images,
+                       const std::size_t length, const std::size_t bytes) {
+  if (bytes < length) {
+    writeAt(images + bytes, length - bytes,
+            pagePosition(first_page_number) + bytes);
+  }
+}
+
+void File::endWrite() noexcept {
+  std::lock_guard<std::mutex> guard(descriptor_->writes_mutex);
+  if (--descriptor_->writes_in_flight == 0) {
+    descriptor_->writes_done.notify_all();
+  }
+}
+
+void File::waitForWrites() const {
+  std::unique_lock<std::mutex> lock(descriptor_->writes_mutex);
+  descriptor_->writes_done.wait(
+      lock, [this] { return descriptor_->writes_in_flight == 0; });
+}
+
 void File::deletePage(const PageId page_number) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  // the neighbours rewritten below may be the target of a write in flight
+  waitForWrites();
   FileHeader header = readHeader();
+  if (format_ == FileFormat::BITMAP) {
+    deleteFromBitmap(page_number, header);
+    return;
+  }
   Page existing_page = readPage(page_number);
   Page previous_page;
   // If this page is the head of the used list, update the header to point to
@@ -212,33 +537,314 @@ void File::deletePage(const PageId page_number) {
   writeHeader(header);
 }
 
+const Page &File::viewPage(const PageId page_number) const {
+  if (!mapping_) {
+    throw BadgerDbException("File is not mapped: " + filename_);
+  }
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= mapping_->num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Page &page = *reinterpret_cast<const Page *>(
+      mapping_->base + pagePosition(page_number));
+  if (!page.isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void File::checkWritable() const {
+  if (mapping_) {
+    throw ReadOnlyFileException(filename_);
+  }
+}
+
+void File::adviseScan(const PageId page_number) const {
+  if (!mapping_ || page_number >= mapping_->num_pages ||
+      page_number % READ_AHEAD_PAGES != 1) {
+    return;
+  }
+  // madvise wants a start on a boundary of the system's pages
+  static const std::size_t system_page = ::sysconf(_SC_PAGESIZE);
+  const std::size_t start =
+      pagePosition(page_number) / system_page * system_page;
+  const std::size_t end = std::min<std::size_t>(
+      mapping_->bytes, pagePosition(page_number + READ_AHEAD_PAGES));
+  ::madvise(const_cast<char *>(mapping_->base) + start, end - start,
+            MADV_WILLNEED);
+}
+
 FileIterator File::begin() {
-  const FileHeader &header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  if (mapping_) {
+    ::madvise(const_cast<char *>(mapping_->base), mapping_->bytes,
+              MADV_SEQUENTIAL);
+  }
+  const PageId first = firstUsedPage();
+  adviseScan(first);
+  return FileIterator(this, first);
+}
+
+PageId File::firstUsedPage() const {
+  if (format_ == FileFormat::BITMAP) {
+    return nextUsedPage(Page::INVALID_NUMBER);
+  }
+  return readHeader().first_used_page;
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  const FileHeader header = readHeader();
+  const FreeSpaceMap &map = freeSpaceMap(header);
+  // a word at a time; bitmap pages are marked occupied too, so skip them
+  PageId next = page_number + 1;
+  while (next < header.num_pages) {
+    const std::uint64_t word = map.occupied[next / 64] >> (next % 64);
+    if (word == 0) {
+      next = (next / 64 + 1) * 64;
+      continue;
+    }
+    next += __builtin_ctzll(word);
+    if (next >= header.num_pages) break;
+    if (!isBitmapPage(next)) return next;
+    next++;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+File::FreeSpaceMap &File::freeSpaceMap(const FileHeader &header) const {
+  FreeSpaceMap &map = *free_space_map_;
+  const std::size_t words = (header.num_pages + 63) / 64;
+  if (map.occupied.size() < words) map.occupied.resize(words, 0);
+  if (map.loaded) return map;
+
+  map.set(0);  // the header
+  std::vector<std::uint8_t> bits(Page::DATA_SIZE);
+  for (PageId bitmap_page = 1; bitmap_page < header.num_pages;
+       bitmap_page += BITMAP_PAGE_BITS + 1) {
+    map.set(bitmap_page);
+    const std::size_t read =
+        readAt(bits.data(), bits.size(),
+               pagePosition(bitmap_page) + sizeof(PageHeader));
+    std::fill(bits.begin() + read, bits.end(), 0);
+    for (PageId i = 0;
+         i < BITMAP_PAGE_BITS && bitmap_page + 1 + i < header.num_pages; i++) {
+      if ((bits[i / 8] >> (i % 8)) & 1) map.set(bitmap_page + 1 + i);
+    }
+  }
+  map.lowest_free = 1;
+  map.loaded = true;
+  return map;
+}
+
+void File::writeBitmapByte(const FreeSpaceMap &map, const PageId page_number) {
+  const PageId bitmap_page = bitmapPageOf(page_number);
+  const PageId bit = page_number - bitmap_page - 1;
+  const PageId first = bitmap_page + 1 + bit / 8 * 8;
+  std::uint8_t byte = 0;
+  for (PageId i = 0; i < 8; i++) {
+    if (first + i < map.occupied.size() * 64 && map.test(first + i)) {
+      byte |= 1 << i;
+    }
+  }
+  writeAt(&byte, 1, pagePosition(bitmap_page) + sizeof(PageHeader) + bit / 8);
+}
+
+Page File::allocateFromBitmap(FileHeader &header) {
+  FreeSpaceMap &map = freeSpaceMap(header);
+  PageId page_number = Page::INVALID_NUMBER;
+  if (header.num_free_pages > 0) {
+    // the lowest free page, found in memory without reading any page
+    PageId next = map.lowest_free;
+    while (next < header.num_pages) {
+      const std::uint64_t word = ~map.occupied[next / 64] >> (next % 64);
+      if (word == 0) {
+        next = (next / 64 + 1) * 64;
+        continue;
+      }
+      next += __builtin_ctzll(word);
+      if (next < header.num_pages) page_number = next;
+      break;
+    }
+    map.lowest_free = page_number != Page::INVALID_NUMBER ? page_number
+                                                          : header.num_pages;
+  }
+
+  if (page_number != Page::INVALID_NUMBER) {
+    --header.num_free_pages;
+  } else {
+    page_number = header.num_pages;
+    if (isBitmapPage(page_number)) {
+      // the first page of a group is the group's bitmap page, all clear
+      const std::vector<char> empty(Page::SIZE, 0);
+      writeAt(empty.data(), empty.size(), pagePosition(page_number));
+      header.num_pages = page_number + 1;
+      freeSpaceMap(header).set(page_number);
+      page_number++;
+    }
+    header.num_pages = page_number + 1;
+    freeSpaceMap(header);
+  }
+
+  map.set(page_number);
+  Page new_page;
+  new_page.set_page_number(page_number);
+  writePage(page_number, new_page);
+  writeBitmapByte(map, page_number);
+  writeHeader(header);
+  return new_page;
+}
+
+void File::deleteFromBitmap(const PageId page_number, FileHeader &header) {
+  FreeSpaceMap &map = freeSpaceMap(header);
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number >= header.num_pages || isBitmapPage(page_number) ||
+      !map.test(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  map.clear(page_number);
+  map.lowest_free = std::min(map.lowest_free, page_number);
+  // the page is cleared on disk too, so reading it fails as in the other
+  // format
+  Page free_page;
+  writePage(page_number, free_page);
+  writeBitmapByte(map, page_number);
+  ++header.num_free_pages;
+  writeHeader(header);
+}
+
+FileLayout File::readLayout() const {
+  // A packed file has a page right after its header, and a page never starts
+  // with the tag, so a file with the tag is page-aligned.
+  LayoutTag tag;
+  if (readAt(&tag, sizeof(tag), sizeof(FileHeader)) < sizeof(tag) ||
+      std::memcmp(tag.magic, LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC)) != 0) {
+    return FileLayout::PACKED;
+  }
+  if (tag.version != static_cast<std::uint32_t>(FileLayout::PAGE_ALIGNED)) {
+    throw BadgerDbException("Unknown file layout version " +
+                            std::to_string(tag.version) + ": " + filename_);
+  }
+  struct stat st;
+  if (::fstat(descriptor_->fd, &st) != 0) {
+    throw FileIOException(filename_, errno);
+  }
+  if (st.st_size % Page::SIZE != 0) {
+    throw BadgerDbException("Page-aligned file is " +
+                            std::to_string(st.st_size) +
+                            " bytes, not a whole number of pages: " +
+                            filename_);
+  }
+  return FileLayout::PAGE_ALIGNED;
+}
+
+void File::writeFirstPage(const FileHeader &header) {
+  std::vector<char> first(Page::SIZE, 0);
+  LayoutTag tag;
+  std::memcpy(tag.magic, LAYOUT_MAGIC, sizeof(LAYOUT_MAGIC));
+  tag.version = static_cast<std::uint32_t>(FileLayout::PAGE_ALIGNED);
+  std::memcpy(first.data(), &header, sizeof(header));
+  std::memcpy(first.data() + sizeof(header), &tag, sizeof(tag));
+  writeAt(first.data(), first.size(), 0 /* pos */);
+}
+
+void File::upgradeLayout(const std::string &filename) {
+  if (!exists(filename)) {
+    throw FileNotFoundException(filename);
+  }
+  if (isOpen(filename)) {
+    throw FileOpenException(filename);
+  }
+  // The pages are copied to a new file, which then replaces the old one, so
+  // a crash leaves one or the other.
+  const std::string upgrade_name = filename + ".upgrade";
+  try {
+    {
+      File file = File::open(filename);
+      if (file.layout_ == FileLayout::PAGE_ALIGNED) return;
+      if (exists(upgrade_name)) {
+        remove(upgrade_name);  // left by an upgrade that did not finish
+      }
+      File upgraded =
+          File::create(upgrade_name, file.format_, FileLayout::PAGE_ALIGNED);
+
+      std::lock_guard<std::recursive_mutex> io_guard(*file.io_mutex_);
+      const FileHeader header = file.readHeader();
+      std::vector<char> page(Page::SIZE);
+      for (PageId page_number = 1; page_number < header.num_pages;
+           page_number++) {
+        const std::size_t read =
+            file.readAt(page.data(), page.size(),
+                        pagePosition(FileLayout::PACKED, page_number));
+        std::fill(page.begin() + read, page.end(), 0);
+        upgraded.writeAt(page.data(), page.size(),
+                         pagePosition(FileLayout::PAGE_ALIGNED, page_number));
+      }
+      // written last, so that the cached header of the new file, written
+      // back when it was created, is not written over it
+      upgraded.writeFirstPage(header);
+      if (::fdatasync(upgraded.descriptor_->fd) != 0) {
+        throw FileIOException(upgrade_name, errno);
+      }
+    }
+    if (::rename(upgrade_name.c_str(), filename.c_str()) != 0) {
+      throw FileIOException(filename, errno);
+    }
+  } catch (...) {
+    std::remove(upgrade_name.c_str());
+    throw;
+  }
+  syncDirectoryOf(filename);
 }
 
 FileIterator File::end() { return FileIterator(this, Page::INVALID_NUMBER); }
 
-File::File(const std::string &name, const bool create_new)
-    : filename_(name), valid_(true) {
+File::File(const std::string &name, const bool create_new,
+           const FileFormat format, const FileLayout layout)
+    : filename_(name),
+      id_(0),
+      format_(format),
+      layout_(layout),
+      valid_(true) {
   openIfNeeded(create_new);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
+    if (format != FileFormat::LINKED_LIST) {
+      header.first_used_page =
+          FileHeader::FORMAT_TAG | static_cast<PageId>(format);
+    }
+    // written at once, so the file can be opened even if it is never closed
+    if (layout == FileLayout::PAGE_ALIGNED) writeFirstPage(header);
     writeHeader(header);
+    sync();
+  } else {
+    try {
+      layout_ = readLayout();
+      format_ = readHeader().format();
+    } catch (...) {
+      close();  // the destructor does not run for a throwing constructor
+      throw;
+    }
   }
 }
 
 void File::openIfNeeded(const bool create_new) {
+  std::lock_guard<std::mutex> guard(open_mutex_);
   if (open_counts_.find(filename_) !=
       open_counts_.end()) {  // exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    OpenCount &count = open_counts_[filename_];
+    ++count.refs;
+    ++count.opens;
+    descriptor_ = open_descriptors_[filename_];
+    io_mutex_ = open_mutexes_[filename_];
+    free_space_map_ = open_free_space_maps_[filename_];
+    header_cache_ = open_headers_[filename_];
+    page_directory_ = open_page_directories_[filename_];
+    sync_state_ = open_sync_states_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -246,7 +852,7 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
@@ -254,18 +860,78 @@ void File::openIfNeeded(const bool create_new) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    const int fd = ::open(filename_.c_str(), flags | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      valid_ = false;
+      throw FileIOException(filename_, errno);
+    }
+    descriptor_ = std::make_shared<Descriptor>(fd);
+    io_mutex_ = std::make_shared<std::recursive_mutex>();
+    free_space_map_ = std::make_shared<FreeSpaceMap>();
+    header_cache_ = std::make_shared<HeaderCache>();
+    page_directory_ = std::make_shared<PageDirectory>();
+    sync_state_ = std::make_shared<SyncState>();
+    open_descriptors_[filename_] = descriptor_;
+    open_mutexes_[filename_] = io_mutex_;
+    open_free_space_maps_[filename_] = free_space_map_;
+    open_headers_[filename_] = header_cache_;
+    open_page_directories_[filename_] = page_directory_;
+    open_sync_states_[filename_] = sync_state_;
+    open_counts_[filename_] = OpenCount{1, 1};
+  }
+  if (valid_) {
+    id_ = idOf(filename_, false /* mapped */);
   }
 }
 
+FileId File::idOf(const std::string &filename, const bool mapped) {
+  const IdMap::key_type key(filename, mapped);
+  IdMap::iterator it = file_ids_.find(key);
+  if (it == file_ids_.end()) {
+    it = file_ids_.emplace(key, file_ids_.size() + 1).first;
+  }
+  return it->second;
+}
+
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+  // a default-constructed File never took a reference
+  if (!valid_) return;
+  std::unique_lock<std::mutex> lock(open_mutex_);
+  // The last reference syncs the file without the open lock, which a slow
+  // fdatasync() or group sync would otherwise hold up every open, copy and
+  // close in the process.  An object for the file may be opened and closed
+  // meanwhile without syncing, as this one still holds a reference, so the
+  // sync is repeated until none was.
+  std::uint64_t opens = open_counts_[filename_].opens;
+  while (open_counts_[filename_].refs == 1) {
+    lock.unlock();
+    try {
+      syncFile(filename_, *descriptor_, *io_mutex_, *header_cache_,
+               *sync_state_);
+    } catch (const FileIOException &) {
+      // nowhere to report it from a destructor; sync() first to find out
+    }
+    lock.lock();
+    if (open_counts_[filename_].opens == opens) break;
+    opens = open_counts_[filename_].opens;
+  }
+  OpenCount &count = open_counts_[filename_];
+  --count.refs;
+  descriptor_.reset();
+  io_mutex_.reset();
+  mapping_.reset();
+  free_space_map_.reset();
+  header_cache_.reset();
+  page_directory_.reset();
+  sync_state_.reset();
+  if (count.refs == 0) {
+    open_descriptors_.erase(filename_);
     open_counts_.erase(filename_);
+    open_mutexes_.erase(filename_);
+    open_free_space_maps_.erase(filename_);
+    open_headers_.erase(filename_);
+    open_page_directories_.erase(filename_);
+    open_sync_states_.erase(filename_);
   }
 }
 
@@ -275,32 +941,298 @@ void File::writePage(const PageId page_number, const Page &new_page) {
 
 void File::writePage(const PageId page_number, const PageHeader &header,
                      const Page &new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  if (&header == &new_page.header_) {
+    writeAt(&new_page, Page::SIZE, pagePosition(page_number));
+  } else {
+    // header and data come from different places; gather them into one write
+    iovec iov[2];
+    iov[0].iov_base = const_cast<PageHeader *>(&header);
+    iov[0].iov_len = sizeof(header);
+    iov[1].iov_base = const_cast<char *>(&new_page.data_[0]);
+    iov[1].iov_len = Page::DATA_SIZE;
+    ssize_t n;
+    do {
+      n = ::pwritev(descriptor_->fd, iov, 2, pagePosition(page_number));
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw FileIOException(filename_, errno);
+    if (static_cast<std::size_t>(n) < Page::SIZE) {
+      // a short write; finish it from a contiguous copy
+      Page page = new_page;
+      page.header_ = header;
+      writeAt(reinterpret_cast<const char *>(&page) + n, Page::SIZE - n,
+              pagePosition(page_number) + n);
+    }
+  }
+  if (format_ == FileFormat::LINKED_LIST) {
+    page_directory_->entry(page_number)
+        .store(PageDirectory::entryFor(header), std::memory_order_relaxed);
+  }
 }
 
-FileHeader File::readHeader() const {
+/**
+ * Field loads are acquires, so a field stored by a concurrent store() makes
+ * the odd version it started with visible to the second version load.
+ */
+FileHeader File::HeaderCache::load() const {
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  for (;;) {
+    const std::uint32_t before = version.load(std::memory_order_acquire);
+    header.num_pages = num_pages.load(std::memory_order_acquire);
+    header.first_used_page = first_used_page.load(std::memory_order_acquire);
+    header.num_free_pages = num_free_pages.load(std::memory_order_acquire);
+    header.first_free_page = first_free_page.load(std::memory_order_acquire);
+    if (before % 2 == 0 &&
+        version.load(std::memory_order_relaxed) == before) {
+      return header;
+    }
+    std::this_thread::yield();  // a store is under way
+  }
+}
 
-  return header;
+void File::HeaderCache::store(const FileHeader &header) {
+  const std::uint32_t before = version.load(std::memory_order_relaxed);
+  version.store(before + 1, std::memory_order_relaxed);
+  num_pages.store(header.num_pages, std::memory_order_release);
+  first_used_page.store(header.first_used_page, std::memory_order_release);
+  num_free_pages.store(header.num_free_pages, std::memory_order_release);
+  first_free_page.store(header.first_free_page, std::memory_order_release);
+  version.store(before + 2, std::memory_order_release);
+}
+
+File::PageDirectory::Leaf::Leaf() {
+  for (std::atomic<PageId> &entry : next) {
+    entry.store(UNKNOWN, std::memory_order_relaxed);
+  }
+}
+
+File::PageDirectory::Mid::Mid() {
+  for (std::atomic<Leaf *> &leaf : leaves) {
+    leaf.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+File::PageDirectory::Mid::~Mid() {
+  for (std::atomic<Leaf *> &leaf : leaves) delete leaf.load();
+}
+
+File::PageDirectory::PageDirectory() {
+  for (std::atomic<Mid *> &mid : root) {
+    mid.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+File::PageDirectory::~PageDirectory() {
+  for (std::atomic<Mid *> &mid : root) delete mid.load();
+}
+
+std::atomic<PageId> &File::PageDirectory::entry(const PageId page_number) {
+  Mid *mid = childOf(root[page_number >> (LEAF_BITS + MID_BITS)]);
+  Leaf *leaf =
+      childOf(mid->leaves[(page_number >> LEAF_BITS) & ((1 << MID_BITS) - 1)]);
+  return leaf->next[page_number & ((1 << LEAF_BITS) - 1)];
+}
+
+FileHeader File::readHeader() const {
+  HeaderCache &cache = *header_cache_;
+  if (!cache.loaded.load(std::memory_order_acquire)) {
+    std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+    if (!cache.loaded.load(std::memory_order_relaxed)) {
+      FileHeader header = FileHeader();
+      if (mapping_) {
+        std::memcpy(&header, mapping_->base, sizeof(header));
+      } else {
+        readAt(&header, sizeof(header), 0 /* pos */);
+      }
+      cache.store(header);
+      cache.loaded.store(true, std::memory_order_release);
+    }
+  }
+  return cache.load();
 }
 
 void File::writeHeader(const FileHeader &header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> io_guard(*io_mutex_);
+  header_cache_->store(header);
+  header_cache_->loaded.store(true, std::memory_order_release);
+  header_cache_->dirty = true;
+}
+
+void File::writeBackHeader(const std::string &filename,
+                           const Descriptor &descriptor, HeaderCache &cache) {
+  if (!cache.dirty) return;
+  const FileHeader header = cache.load();
+  const char *bytes = reinterpret_cast<const char *>(&header);
+  std::size_t done = 0;
+  while (done < sizeof(header)) {
+    const ssize_t n = ::pwrite(descriptor.fd, bytes + done,
+                               sizeof(header) - done, done /* pos */);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw FileIOException(filename, errno);
+    done += n;
+  }
+  cache.dirty = false;
+}
+
+void File::sync() {
+  syncFile(filename_, *descriptor_, *io_mutex_, *header_cache_, *sync_state_);
+}
+
+void File::syncFile(const std::string &filename, const Descriptor &descriptor,
+                    std::recursive_mutex &io_mutex, HeaderCache &cache,
+                    SyncState &state) {
+  {
+    std::lock_guard<std::recursive_mutex> io_guard(io_mutex);
+    writeBackHeader(filename, descriptor, cache);
+  }
+  std::unique_lock<std::mutex> lock(state.mutex);
+  if (state.durability == Durability::NONE) return;
+  // copied, so that setDataSync() can replace it while a sync is under way
+  const std::function<int(int)> data_sync = state.data_sync;
+  auto dataSync = [&]() {
+    return data_sync ? data_sync(descriptor.fd) : ::fdatasync(descriptor.fd);
+  };
+  if (state.durability == Durability::FDATASYNC) {
+    state.data_syncs++;
+    lock.unlock();
+    if (dataSync() != 0) {
+      throw FileIOException(filename, errno);
+    }
+    return;
+  }
+
+  // Everything this call wrote is in before it takes its ticket.  The first
+  // call to find no fdatasync() in progress makes one covering every ticket
+  // taken so far; the others wait for one that covers theirs.
+  const std::uint64_t ticket = ++state.requested;
+  while (state.completed < ticket) {
+    if (state.syncing) {
+      state.synced.wait(lock);
+      continue;
+    }
+    const std::uint64_t from = state.completed + 1;
+    const std::uint64_t through = state.requested;
+    state.syncing = true;
+    state.data_syncs++;
+    lock.unlock();
+    const int result = dataSync();
+    const int error = errno;
+    lock.lock();
+    if (result != 0) {
+      // kept until every call it covered has looked, however many syncs
+      // complete before they wake up
+      state.failures.push_back(
+          SyncState::Failure{from, through, error, through - from + 1});
+    }
+    state.completed = through;
+    state.syncing = false;
+    state.synced.notify_all();
+  }
+  for (std::vector<SyncState::Failure>::iterator it = state.failures.begin();
+       it != state.failures.end(); ++it) {
+    if (ticket >= it->from && ticket <= it->through) {
+      const int error = it->error;
+      if (--it->unseen == 0) state.failures.erase(it);
+      throw FileIOException(filename, error);
+    }
+  }
+}
+
+void File::setDurability(const Durability durability) {
+  std::lock_guard<std::mutex> guard(sync_state_->mutex);
+  sync_state_->durability = durability;
+}
+
+Durability File::durability() const {
+  std::lock_guard<std::mutex> guard(sync_state_->mutex);
+  return sync_state_->durability;
+}
+
+std::uint64_t File::dataSyncs() const {
+  std::lock_guard<std::mutex> guard(sync_state_->mutex);
+  return sync_state_->data_syncs;
+}
+
+void File::setDataSync(std::function<int(int)> data_sync) {
+  std::lock_guard<std::mutex> guard(sync_state_->mutex);
+  sync_state_->data_sync = std::move(data_sync);
+}
+
+void File::syncAll() {
+  struct Open {
+    std::string filename;
+    std::shared_ptr<Descriptor> descriptor;
+    std::shared_ptr<std::recursive_mutex> io_mutex;
+    std::shared_ptr<HeaderCache> header;
+    std::shared_ptr<SyncState> state;
+  };
+  // the files are synced outside the open latch; what they share stays
+  // alive, and their headers are written at most once, if they are closed
+  // meanwhile
+  std::vector<Open> open;
+  {
+    std::lock_guard<std::mutex> guard(open_mutex_);
+    for (const HeaderCacheMap::value_type &entry : open_headers_) {
+      open.push_back({entry.first, open_descriptors_[entry.first],
+                      open_mutexes_[entry.first], entry.second,
+                      open_sync_states_[entry.first]});
+    }
+  }
+  std::exception_ptr error;
+  for (const Open &file : open) {
+    try {
+      syncFile(file.filename, *file.descriptor, *file.io_mutex, *file.header,
+               *file.state);
+    } catch (const FileIOException &) {
+      if (!error) error = std::current_exception();
+    }
+  }
+  if (error) std::rethrow_exception(error);
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
-  PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  PageHeader header = {};
+  if (mapping_ && page_number < mapping_->num_pages) {
+    std::memcpy(&header, mapping_->base + pagePosition(page_number),
+                sizeof(header));
+    return header;
+  }
+  readAt(&header, sizeof(header), pagePosition(page_number));
 
   return header;
 }
 
+std::size_t File::readAt(void *buffer, const std::size_t length,
+                         const off_t position) const {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pread(descriptor_->fd, static_cast<char *>(buffer) + done,
+                length - done, position + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw FileIOException(filename_, errno);
+    if (n == 0) break;  // end of file
+    done += n;
+  }
+  return done;
+}
+
+void File::writeAt(const void *buffer, const std::size_t length,
+                   const off_t position) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pwrite(descriptor_->fd, static_cast<const char *>(buffer) + done,
+                 length - done, position + done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) throw FileIOException(filename_, errno);
+    done += n;
+  }
+}
+
+File::Descriptor::~Descriptor() { ::close(fd); }
+
+File::Mapping::~Mapping() {
+  ::munmap(const_cast<char *>(base), bytes);
+}
+
 }  // namespace badgerdb
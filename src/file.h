@@ -8,10 +8,19 @@
 
 #pragma once
 
-#include <fstream>
+#include <sys/types.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "page.h"
 
@@ -19,17 +28,83 @@ namespace badgerdb {
 
 class FileIterator;
 
+/**
+ * @brief On-disk formats of a file, numbered by version.
+ */
+enum class FileFormat : std::uint8_t {
+  /**
+   * Used and free pages are kept on two lists linked through the pages'
+   * next page numbers, starting in the file header.
+   */
+  LINKED_LIST = 1,
+
+  /**
+   * Which pages are used is kept in bitmap pages, one at the start of every
+   * group of Page::DATA_SIZE * 8 pages.  Pages are iterated in physical
+   * order and their next page numbers are not used.
+   */
+  BITMAP = 2
+};
+
+/**
+ * @brief Placements of the pages of a file on disk, numbered by version.
+ */
+enum class FileLayout : std::uint32_t {
+  /**
+   * The file header takes the first sizeof(FileHeader) bytes and the pages
+   * follow it back to back, so none of them is aligned.
+   */
+  PACKED = 1,
+
+  /**
+   * The file header, and a tag naming the layout, take the whole first page,
+   * so page N starts at N * Page::SIZE.  Files of this layout are always a
+   * whole number of pages long.
+   */
+  PAGE_ALIGNED = 2
+};
+
+/**
+ * @brief How far File::sync() goes to make a file's changes durable.
+ */
+enum class Durability {
+  /**
+   * Changes are left to the operating system to write out.
+   */
+  NONE,
+
+  /**
+   * Every sync() waits for its own fdatasync() of the file.
+   */
+  FDATASYNC,
+
+  /**
+   * sync() calls made together share one fdatasync(): a call waits for the
+   * one in progress, if any, and then for the next, which covers all calls
+   * that arrived meanwhile.
+   */
+  GROUP_SYNC
+};
+
 /**
  * @brief Header metadata for files on disk which contain pages.
  */
 struct FileHeader {
+  /**
+   * Value of first_used_page in files of any format but
+   * FileFormat::LINKED_LIST, ORed with the format's version number.  No
+   * linked-list file has that many pages.
+   */
+  static const PageId FORMAT_TAG = 0xFFFFFF00;
+
   /**
    * Number of pages allocated in the file.
    */
   PageId num_pages;
 
   /**
-   * Page number of the first used page in the file.
+   * Page number of the first used page in the file; FORMAT_TAG and the
+   * format version in files of other formats.
    */
   PageId first_used_page;
 
@@ -39,10 +114,20 @@ struct FileHeader {
   PageId num_free_pages;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * Page number of the first free (allocated but unused) page in the file;
+   * unused, and 0, outside the linked-list format.
    */
   PageId first_free_page;
 
+  /**
+   * Returns the format of the file this header belongs to.
+   */
+  FileFormat format() const {
+    return (first_used_page & FORMAT_TAG) == FORMAT_TAG
+               ? static_cast<FileFormat>(first_used_page & ~FORMAT_TAG)
+               : FileFormat::LINKED_LIST;
+  }
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -60,16 +145,29 @@ struct FileHeader {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a file descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the
+ * same underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the
- * File class detects this (by looking in the open_streams_ map) and just
- * returns a file object with the already created stream for the file without
+ * File class detects this (by looking in the open_descriptors_ map) and just
+ * returns a file object with the already open descriptor for the file without
  * actually opening the UNIX file again.
  *
- * @warning This class is not threadsafe.
+ * File objects may be shared between threads.  Opening, copying and closing
+ * are serialized on a process-wide latch.  All I/O is positional (pread and
+ * pwrite), with no file position shared between threads, so reading and
+ * writing whole pages needs no latch.  Operations that read, modify and write
+ * back the file's structure (allocatePage, deletePage and writePage, which
+ * keeps the page's next pointer from disk) are serialized on a latch shared
+ * by all File objects for that file.
+ *
+ * The file header is read once and kept in memory, shared by all File
+ * objects for the file; changes to it are written back by sync() and when the
+ * last of them is closed.  So are the next page pointers of the pages of a
+ * linked-list file, as they are read or written, so writing a page back
+ * takes a single write.  Both are read without the latch, so reading pages
+ * never waits for it.
  */
 class File {
  public:
@@ -77,25 +175,63 @@ class File {
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param format    On-disk format of the file.
+   * @param layout    Placement of the pages of the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string &filename);
+  static File create(const std::string &filename,
+                     FileFormat format = FileFormat::LINKED_LIST,
+                     FileLayout layout = FileLayout::PAGE_ALIGNED);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
    * It first checks if the file is already open. If so, then the new File
-   * object created uses the same input-output stream to read to or write fom
-   * that already open file. Reference count (open_counts_ static variable
-   * inside the File object) is incremented whenever an already open file is
-   * opened again. Otherwise the UNIX file is actually opened. The fileName and
-   * the stream associated with this File object are inserted into the
-   * open_streams_ map.
+   * object created uses the same descriptor to read to or write fom that
+   * already open file. Reference count (open_counts_ static variable inside
+   * the File object) is incremented whenever an already open file is opened
+   * again. Otherwise the UNIX file is actually opened. The fileName and the
+   * descriptor associated with this File object are inserted into the
+   * open_descriptors_ map.  The layout of the file is detected from its
+   * first page.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  BadgerDbException       If the file is of a layout version this
+   *                                  code does not know.
    */
   static File open(const std::string &filename);
 
+  /**
+   * Opens an existing file for reading only, with its pages mapped into
+   * memory.  Pages can be looked at in place with viewPage(); readPage() and
+   * readPages() copy them out of the mapping, and iterating over the file
+   * asks the operating system to read ahead of the iterator.  Meant for scans
+   * of files nobody modifies: the file must not change while it is mapped,
+   * and pages allocated after the mapping was made are not visible.  Writing
+   * through the returned object, or any copy of it, throws
+   * ReadOnlyFileException.  The descriptor is shared with other File objects
+   * for the file as open() would share it.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the file cannot be mapped.
+   */
+  static File openReadOnly(const std::string &filename);
+
+  /**
+   * Rewrites a file of the packed layout in the page-aligned layout; page
+   * numbers and contents stay the same.  Does nothing if the file is
+   * page-aligned already.  The pages are copied to a file named filename
+   * followed by ".upgrade", which is synced and then renamed over the old
+   * file, so a crash leaves either the old file or the upgraded one.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the file doesn't exist.
+   * @throws  FileOpenException       If the file is currently open.
+   * @throws  FileIOException         If the file could not be read or written.
+   */
+  static void upgradeLayout(const std::string &filename);
+
   /**
    * Deletes an existing file.
    *
@@ -172,6 +308,33 @@ class File {
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads a run of consecutive existing pages from the file with a single
+   * request, into caller-provided pages.
+   *
+   * @param first_page_number   Number of the first page to read.
+   * @param count               Number of pages to read.
+   * @param pages               Where to put each page; pages[i] receives
+   *                            page first_page_number + i.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void readPages(const PageId first_page_number, const std::uint32_t count,
+                 Page *const *pages) const;
+
+  /**
+   * Returns an existing page of a file opened with openReadOnly() in place in
+   * the mapping, without copying it.  The page stays valid as long as this
+   * File object or a copy of it exists.
+   *
+   * @param page_number   Number of page to look at.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the mapping
+   *                                or is not currently used.
+   * @throws  BadgerDbException     If the file is not mapped.
+   */
+  const Page &viewPage(const PageId page_number) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
@@ -181,6 +344,21 @@ class File {
    */
   void writePage(const Page &new_page);
 
+  /**
+   * Writes a run of consecutive existing pages into the file with a single
+   * write request, replacing their contents as writePage() would.  Nothing is
+   * written if one of the pages is not in the file.
+   *
+   * @param first_page_number   Number of the first page to write.
+   * @param count               Number of pages to write.
+   * @param pages               Pages to write; pages[i] is written as page
+   *                            first_page_number + i.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or has been deleted.
+   */
+  void writePages(const PageId first_page_number, const std::uint32_t count,
+                  const Page *const *pages);
+
   /**
    * Deletes a page from the file.
    *
@@ -188,6 +366,55 @@ class File {
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Writes the file header back to disk if it has changed since it was last
+   * written, then, unless the file's durability is Durability::NONE, waits
+   * for everything written to the file so far to reach the disk.
+   *
+   * @throws  FileIOException  If the header could not be written or the file
+   *                           could not be synced.
+   */
+  void sync();
+
+  /**
+   * Calls sync() on every open file.
+   *
+   * @throws  FileIOException  If a file could not be synced; the others are
+   *                           still synced.
+   */
+  static void syncAll();
+
+  /**
+   * Sets how far sync() goes for this file.  The setting is shared by all
+   * File objects for the file, and goes back to Durability::NONE once the
+   * last of them is closed.
+   *
+   * @param durability  New durability of the file.
+   */
+  void setDurability(const Durability durability);
+
+  /**
+   * Returns how far sync() goes for this file.
+   */
+  Durability durability() const;
+
+  /**
+   * Returns the number of fdatasync() calls made for this file since it was
+   * opened by the first of the File objects that have it open.
+   */
+  std::uint64_t dataSyncs() const;
+
+  /**
+   * Replaces fdatasync() for the file, for all File objects that have it
+   * open, with a function taking the descriptor and returning what
+   * fdatasync() would, with errno set on failure.  An empty function goes
+   * back to fdatasync().  Meant for tests that need syncs to fail or to take
+   * a while.
+   *
+   * @param data_sync   Function to call instead of fdatasync().
+   */
+  void setDataSync(std::function<int(int)> data_sync);
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -195,6 +422,29 @@ class File {
    */
   const std::string &filename() const { return filename_; }
 
+  /**
+   * Returns the integer id of the file this object represents.  All File
+   * objects for the same filename share the id, and it stays the same when
+   * the file is closed and opened again.  Objects opened with openReadOnly()
+   * share a separate id, so a buffer manager never caches a page read
+   * through a mapped handle in the frame of a writable one.
+   *
+   * @return Id of file, or 0 for an invalid file.
+   */
+  FileId id() const { return id_; }
+
+  /**
+   * Returns a shared copy of this object, made on the first call and handed
+   * out again after that.  Copying the handle only bumps a reference count,
+   * so holders that keep the file open for a while, such as buffer frames,
+   * avoid taking the process-wide open lock for every copy.  Called on the
+   * shared copy itself, it returns that copy.  Safe to call from several
+   * threads at once.
+   *
+   * @return Shared copy of this object.
+   */
+  std::shared_ptr<File> handle() const;
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -217,14 +467,35 @@ class File {
    */
   constexpr bool isValid() const { return valid_; }
 
+  /**
+   * Returns the on-disk format of the file.
+   */
+  FileFormat format() const { return format_; }
+
+  /**
+   * Returns the placement of the pages of the file on disk.
+   */
+  FileLayout layout() const { return layout_; }
+
+  /**
+   * Returns true if the file was opened with openReadOnly(), so it is mapped
+   * and cannot be written.
+   */
+  bool isReadOnly() const { return mapping_ != nullptr; }
+
   /**
    * Creates an empty file
    * @return File object with valid_ bit set to false
    */
-  File() : valid_(false) {}
+  File()
+      : id_(0),
+        format_(FileFormat::LINKED_LIST),
+        layout_(FileLayout::PAGE_ALIGNED),
+        valid_(false) {}
 
  private:
   friend class BufMgr;
+  friend class UringIoEngine;
 
   /**
    * Constructs a file object representing a file on the filesystem.
@@ -235,28 +506,421 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param format      Format of the file if it is created.
+   * @param layout      Layout of the file if it is created.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  explicit File(const std::string &name, const bool create_new);
+  explicit File(const std::string &name, const bool create_new,
+                FileFormat format = FileFormat::LINKED_LIST,
+                FileLayout layout = FileLayout::PAGE_ALIGNED);
+
+  /**
+   * Returns the layout of the open file, read from its first page.
+   *
+   * @throws  BadgerDbException   If the file names a layout version this code
+   *                              does not know, or is page-aligned but not a
+   *                              whole number of pages long.
+   */
+  FileLayout readLayout() const;
+
+  /**
+   * Writes the first page of a page-aligned file: the given header, the
+   * layout tag and zeros.
+   *
+   * @param header  File header to write.
+   */
+  void writeFirstPage(const FileHeader &header);
+
+  /**
+   * Number of pages a bitmap page keeps track of, the ones right after it.
+   */
+  static const PageId BITMAP_PAGE_BITS = Page::DATA_SIZE * 8;
+
+  /**
+   * Returns true if the page with the given number is a bitmap page in a
+   * file of the bitmap format.
+   */
+  static bool isBitmapPage(const PageId page_number) {
+    return page_number != Page::INVALID_NUMBER &&
+           (page_number - 1) % (BITMAP_PAGE_BITS + 1) == 0;
+  }
+
+  /**
+   * Returns the number of the bitmap page keeping track of the page with the
+   * given number in a file of the bitmap format.
+   */
+  static PageId bitmapPageOf(const PageId page_number) {
+    return 1 + (page_number - 1) / (BITMAP_PAGE_BITS + 1) *
+                   (BITMAP_PAGE_BITS + 1);
+  }
+
+  /**
+   * @brief In-memory copy of the bitmap pages of a file, shared by all File
+   * objects for the file and only used under their I/O latch.
+   */
+  struct FreeSpaceMap {
+    FreeSpaceMap() : loaded(false), lowest_free(1) {}
+
+    bool test(PageId page_number) const {
+      return (occupied[page_number / 64] >> (page_number % 64)) & 1;
+    }
+    void set(PageId page_number) {
+      occupied[page_number / 64] |= std::uint64_t(1) << (page_number % 64);
+    }
+    void clear(PageId page_number) {
+      occupied[page_number / 64] &= ~(std::uint64_t(1) << (page_number % 64));
+    }
+
+    /**
+     * Whether the bitmap pages have been read in yet.
+     */
+    bool loaded;
+
+    /**
+     * One bit per page of the file, set for used pages and for the pages
+     * that are not data pages (page 0, the header, and bitmap pages).
+     */
+    std::vector<std::uint64_t> occupied;
+
+    /**
+     * No page below this one is free.
+     */
+    PageId lowest_free;
+  };
+
+  /**
+   * @brief The header of a file, shared by all File objects for the file.
+   *
+   * The fields are atomics behind a sequence counter, so readers take a
+   * consistent copy without any latch; they are only replaced, and dirty is
+   * only used, under the file's I/O latch.
+   */
+  struct HeaderCache {
+    HeaderCache()
+        : loaded(false),
+          dirty(false),
+          version(0),
+          num_pages(0),
+          first_used_page(0),
+          num_free_pages(0),
+          first_free_page(0) {}
+
+    /**
+     * Returns a consistent copy of the header.
+     */
+    FileHeader load() const;
+
+    /**
+     * Replaces the header; the I/O latch must be held.
+     */
+    void store(const FileHeader &header);
+
+    /**
+     * Whether the header has been read in yet.
+     */
+    std::atomic<bool> loaded;
+
+    /**
+     * Whether the header has changed since it was last written.
+     */
+    bool dirty;
+
+    /**
+     * Incremented before and after the fields are replaced, so odd while
+     * they are.
+     */
+    std::atomic<std::uint32_t> version;
+
+    std::atomic<PageId> num_pages;
+    std::atomic<PageId> first_used_page;
+    std::atomic<PageId> num_free_pages;
+    std::atomic<PageId> first_free_page;
+  };
+
+  /**
+   * @brief The next page pointers of the pages of a linked-list file, as on
+   * disk, shared by all File objects for the file.  Pages are added as they
+   * are read or written.
+   *
+   * A radix tree of atomic entries whose nodes are created on demand and
+   * never freed before the directory, so entries can be looked up and set
+   * without any latch.  Writers of the file, who hold its I/O latch, store
+   * entries; readers only fill in entries that are still UNKNOWN.
+   */
+  struct PageDirectory {
+    /**
+     * Entry of a page whose header has not been seen yet
+     */
+    static constexpr PageId UNKNOWN = ~PageId(0);
+
+    /**
+     * Entry of a page that is not in use
+     */
+    static constexpr PageId FREE = UNKNOWN - 1;
+
+    /**
+     * Bits of the page number that select an entry within a leaf, a leaf
+     * within a middle node and a middle node within the root.
+     */
+    static constexpr int LEAF_BITS = 12;
+    static constexpr int MID_BITS = 10;
+    static constexpr int ROOT_BITS = 32 - LEAF_BITS - MID_BITS;
+
+    struct Leaf {
+      Leaf();
+      std::atomic<PageId> next[1 << LEAF_BITS];
+    };
+
+    struct Mid {
+      Mid();
+      ~Mid();
+      std::atomic<Leaf *> leaves[1 << MID_BITS];
+    };
+
+    PageDirectory();
+    ~PageDirectory();
+    PageDirectory(const PageDirectory &) = delete;
+    PageDirectory &operator=(const PageDirectory &) = delete;
+
+    /**
+     * Returns the entry of a page, creating the nodes leading to it if
+     * needed.
+     */
+    std::atomic<PageId> &entry(PageId page_number);
+
+    /**
+     * Returns the entry for a page with the given header.
+     */
+    static PageId entryFor(const PageHeader &header) {
+      return header.current_page_number == Page::INVALID_NUMBER
+                 ? FREE
+                 : header.next_page_number;
+    }
+
+    std::atomic<Mid *> root[1 << ROOT_BITS];
+  };
+
+  /**
+   * Returns the free-space map of a file in the bitmap format, reading the
+   * bitmap pages in on first use and growing it to the file's size.  The I/O
+   * latch must be held.
+   *
+   * @param header  Current header of the file.
+   */
+  FreeSpaceMap &freeSpaceMap(const FileHeader &header) const;
+
+  /**
+   * Writes the byte of the page's bitmap page holding the page's bit, as the
+   * free-space map has it.
+   */
+  void writeBitmapByte(const FreeSpaceMap &map, const PageId page_number);
+
+  /**
+   * allocatePage() for a file in the bitmap format; the I/O latch is held.
+   */
+  Page allocateFromBitmap(FileHeader &header);
+
+  /**
+   * deletePage() for a file in the bitmap format; the I/O latch is held.
+   */
+  void deleteFromBitmap(const PageId page_number, FileHeader &header);
+
+  /**
+   * Returns the number of the first used page in the file, or
+   * Page::INVALID_NUMBER if there is none.
+   */
+  PageId firstUsedPage() const;
 
   /**
-   * Returns the position of the page with the given number in the file (as an
-   * offset from the beginning of the file).
+   * Returns the number of the next used page in physical order after the
+   * given one in a file of the bitmap format, or Page::INVALID_NUMBER if
+   * there is none.
    *
+   * @param page_number   Number of a page, or Page::INVALID_NUMBER to start
+   *                      at the beginning of the file.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Returns the position of the page with the given number in a file of the
+   * given layout (as an offset from the beginning of the file).
+   *
+   * @param layout        Layout of the file.
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static off_t pagePosition(const FileLayout layout,
+                            const PageId page_number) {
+    if (layout == FileLayout::PAGE_ALIGNED) {
+      return static_cast<off_t>(page_number) * Page::SIZE;
+    }
+    return sizeof(FileHeader) +
+           (static_cast<off_t>(page_number - 1) * Page::SIZE);
   }
 
+  /**
+   * Returns the position of the page with the given number in this file.
+   *
+   * @param page_number   Number of page.
+   * @return  Position of page in file.
+   */
+  off_t pagePosition(const PageId page_number) const {
+    return pagePosition(layout_, page_number);
+  }
+
+  /**
+   * Reads up to length bytes at the given position, stopping early only at
+   * the end of the file.
+   *
+   * @param buffer    Where to put the bytes.
+   * @param length    Number of bytes to read.
+   * @param position  Offset in the file to read from.
+   * @return  Number of bytes read.
+   * @throws  FileIOException  If the read fails.
+   */
+  std::size_t readAt(void *buffer, std::size_t length, off_t position) const;
+
+  /**
+   * Writes length bytes at the given position.
+   *
+   * @param buffer    Bytes to write.
+   * @param length    Number of bytes to write.
+   * @param position  Offset in the file to write at.
+   * @throws  FileIOException  If the write fails.
+   */
+  void writeAt(const void *buffer, std::size_t length, off_t position);
+
+  /**
+   * Checks that a run of pages lies within the file.
+   *
+   * @param first_page_number   Number of the first page of the run.
+   * @param count               Number of pages in the run.
+   * @throws  InvalidPageException  If a page of the run is past the end of
+   *                                the file.
+   */
+  void checkRun(const PageId first_page_number,
+                const std::uint32_t count) const;
+
+  /**
+   * Completes a read of a run of pages of which the first <bytes> bytes are
+   * already in place, and checks that every page of the run is in use.
+   *
+   * @param first_page_number   Number of the first page of the run.
+   * @param count               Number of pages in the run.
+   * @param pages               Where each page goes.
+   * @param bytes               Number of bytes of the run already read.
+   * @throws  InvalidPageException  If a page ends past the end of the file or
+   *                                is not currently used.
+   */
+  void finishRead(const PageId first_page_number, const std::uint32_t count,
+                  Page *const *pages, std::size_t bytes) const;
+
+  /**
+   * Builds the images writePages() writes for a run of pages, with the next
+   * page pointers the pages have on disk; the file's io_mutex_ must be held.
+   *
+   * @param first_page_number   Number of the first page of the run.
+   * @param count               Number of pages in the run.
+   * @param pages               Pages to write.
+   * @param run                 Set to the images, back to back.
+   * @throws  InvalidPageException  If a page of the run is not in the file or
+   *                                is not currently used.
+   */
+  void buildRun(const PageId first_page_number, const std::uint32_t count,
+                const Page *const *pages, std::vector<char> &run);
+
+  /**
+   * Builds the images of a run of pages for a write issued by an I/O engine,
+   * and counts the write in flight until endWrite().  Allocating and deleting
+   * pages wait for the writes in flight, as they rewrite pages on disk that
+   * such a write may cover.
+   *
+   * @param first_page_number   Number of the first page of the run.
+   * @param count               Number of pages in the run.
+   * @param pages               Pages to write.
+   * @param run                 Set to the images to write, back to back.
+   * @throws  ReadOnlyFileException  If the file was opened with
+   *                                 openReadOnly().
+   * @throws  InvalidPageException   If a page of the run is not in the file
+   *                                 or is not currently used.
+   */
+  void prepareWrite(const PageId first_page_number, const std::uint32_t count,
+                    const Page *const *pages, std::vector<char> &run);
+
+  /**
+   * Completes a write of page images of which the first <bytes> bytes are
+   * already on disk.
+   *
+   * @param first_page_number   Number of the first page of the images.
+   * @param images              The images, back to back.
+   * @param length              Length of the images in bytes.
+   * @param bytes               Number of bytes already written.
+   * @throws  FileIOException   If the rest could not be written.
+   */
+  void finishWrite(const PageId first_page_number, const char *images,
+                   std::size_t length, std::size_t bytes);
+
+  /**
+   * Ends a write begun with prepareWrite(), whether or not it succeeded.
+   * Never throws.
+   */
+  void endWrite() noexcept;
+
+  /**
+   * Waits until no write begun with prepareWrite() is in flight; the file's
+   * io_mutex_ must be held, so that no new one begins.
+   */
+  void waitForWrites() const;
+
+  /**
+   * Throws ReadOnlyFileException if the file was opened with openReadOnly().
+   */
+  void checkWritable() const;
+
+  /**
+   * Returns the next page pointer an existing page has on disk, reading its
+   * header only if the page directory does not have it; the file's io_mutex_
+   * must be held.  Pages of the bitmap format have no next page pointers.
+   *
+   * @param page_number   Number of the page.
+   * @return  The next page pointer.
+   * @throws  InvalidPageException  If the page is not in the file or is not
+   *                                currently used.
+   */
+  PageId storedNextPage(const PageId page_number);
+
+  /**
+   * Adds the next page pointers of pages just read to the page directory,
+   * unless it has them already.  Does nothing outside the linked-list format.
+   *
+   * @param first_page_number   Number of the first page read.
+   * @param count               Number of pages read.
+   * @param pages               The pages.
+   */
+  void rememberPages(const PageId first_page_number, const std::uint32_t count,
+                     const Page *const *pages) const;
+
+  /**
+   * Asks the operating system to read the mapped pages from the given one on
+   * ahead of a scan, once every READ_AHEAD_PAGES pages.  Does nothing if the
+   * file is not mapped.
+   *
+   * @param page_number   Number of the page the scan is at.
+   */
+  void adviseScan(const PageId page_number) const;
+
+  /**
+   * Pages of a mapped file read ahead at a time during a scan.
+   */
+  static const std::uint32_t READ_AHEAD_PAGES = 64;
+
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
    * @throws  FileExistsException     If the underlying file exists and
@@ -267,7 +931,16 @@ class File {
   void openIfNeeded(const bool create_new);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Returns the id of the given file's handles of one kind, handing out a
+   * new one the first time.  Called with open_mutex_ held.
+   *
+   * @param filename  Name of the file.
+   * @param mapped    True for handles opened with openReadOnly().
+   */
+  static FileId idOf(const std::string &filename, bool mapped);
+
+  /**
+   * Releases the underlying file descriptor in <descriptor_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -277,8 +950,8 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as a free page.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
@@ -311,19 +984,21 @@ class File {
                  const Page &new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file, reading it from disk the first time.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the header for this file in memory; it is written to disk by
+   * sync() or when the file is closed.
    *
-   * @param header  File header to write.
+   * @param header  New file header.
    */
   void writeHeader(const FileHeader &header);
 
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -333,34 +1008,286 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream>> StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * @brief An open file descriptor, closed with the last File using it.
+   */
+  struct Descriptor {
+    explicit Descriptor(int fd) : fd(fd), writes_in_flight(0) {}
+    ~Descriptor();
+    Descriptor(const Descriptor &) = delete;
+    Descriptor &operator=(const Descriptor &) = delete;
+
+    const int fd;
+
+    /**
+     * Protects writes_in_flight.
+     */
+    std::mutex writes_mutex;
+
+    /**
+     * Signalled when writes_in_flight drops to 0.
+     */
+    std::condition_variable writes_done;
+
+    /**
+     * Writes begun with prepareWrite() and not yet ended.
+     */
+    std::uint32_t writes_in_flight;
+  };
+
+  /**
+   * Writes a changed header to disk; the file's io_mutex_ must be held.
+   */
+  static void writeBackHeader(const std::string &filename,
+                              const Descriptor &descriptor,
+                              HeaderCache &cache);
 
   /**
-   * Streams for opened files.
+   * @brief The durability of a file and the state of its fdatasync() calls,
+   * shared by all File objects for the file.
    */
-  static StreamMap open_streams_;
+  struct SyncState {
+    SyncState()
+        : durability(Durability::NONE),
+          requested(0),
+          completed(0),
+          syncing(false),
+          data_syncs(0) {}
+
+    /**
+     * @brief Calls covered by an fdatasync() that failed, kept until each of
+     * them has seen the failure.
+     */
+    struct Failure {
+      std::uint64_t from;
+      std::uint64_t through;
+      int error;
+
+      /**
+       * Number of the calls that have yet to see it.
+       */
+      std::uint64_t unseen;
+    };
+
+    /**
+     * Protects the members below.
+     */
+    std::mutex mutex;
+
+    /**
+     * Signalled when an fdatasync() completes.
+     */
+    std::condition_variable synced;
+
+    Durability durability;
+
+    /**
+     * Number of sync() calls so far that asked for an fdatasync(), and the
+     * number of them covered by one that completed.
+     */
+    std::uint64_t requested;
+    std::uint64_t completed;
+
+    /**
+     * Whether an fdatasync() is in progress.
+     */
+    bool syncing;
+
+    /**
+     * Failed fdatasync() calls not yet seen by every call they covered, in
+     * the order they failed.
+     */
+    std::vector<Failure> failures;
+
+    /**
+     * Number of fdatasync() calls made.
+     */
+    std::uint64_t data_syncs;
+
+    /**
+     * Called in place of fdatasync() if set.
+     */
+    std::function<int(int)> data_sync;
+  };
+
+  /**
+   * Syncs a file as sync() does, given what its File objects share.
+   */
+  static void syncFile(const std::string &filename,
+                       const Descriptor &descriptor,
+                       std::recursive_mutex &io_mutex, HeaderCache &cache,
+                       SyncState &state);
+
+  /**
+   * @brief A read-only mapping of a whole file, unmapped with the last File
+   * using it.
+   */
+  struct Mapping {
+    Mapping(const char *base, std::size_t bytes, PageId num_pages)
+        : base(base), bytes(bytes), num_pages(num_pages) {}
+    ~Mapping();
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+
+    const char *const base;
+    const std::size_t bytes;
+
+    /**
+     * Number of pages in the file, counting the header, when it was mapped,
+     * limited to the pages the mapping covers entirely.
+     */
+    const PageId num_pages;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Descriptor>> DescriptorMap;
+  /**
+   * @brief References to an open file.
+   */
+  struct OpenCount {
+    /**
+     * File objects holding the file open
+     */
+    int refs;
+
+    /**
+     * Times the file was opened or a File for it copied, so that a closing
+     * object can tell whether another one came and went while it synced
+     */
+    std::uint64_t opens;
+  };
+
+  typedef std::map<std::string, OpenCount> CountMap;
+  typedef std::map<std::string, std::shared_ptr<std::recursive_mutex>>
+      MutexMap;
+  typedef std::map<std::pair<std::string, bool>, FileId> IdMap;
+  typedef std::map<std::string, std::shared_ptr<FreeSpaceMap>> FreeSpaceMapMap;
+  typedef std::map<std::string, std::shared_ptr<HeaderCache>> HeaderCacheMap;
+  typedef std::map<std::string, std::shared_ptr<PageDirectory>>
+      PageDirectoryMap;
+  typedef std::map<std::string, std::shared_ptr<SyncState>> SyncStateMap;
+
+  /**
+   * Descriptors of opened files.
+   */
+  static DescriptorMap open_descriptors_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * I/O latches for opened files.
+   */
+  static MutexMap open_mutexes_;
+
+  /**
+   * Free-space maps of opened files.
+   */
+  static FreeSpaceMapMap open_free_space_maps_;
+
+  /**
+   * Headers of opened files.
+   */
+  static HeaderCacheMap open_headers_;
+
+  /**
+   * Page directories of opened files.
+   */
+  static PageDirectoryMap open_page_directories_;
+
+  /**
+   * Durability and sync state of opened files.
+   */
+  static SyncStateMap open_sync_states_;
+
+  /**
+   * Ids handed out so far, by filename and whether the handles are mapped.
+   * Entries are never removed.
+   */
+  static IdMap file_ids_;
+
+  /**
+   * Protects open_descriptors_, open_counts_, open_mutexes_,
+   * open_free_space_maps_, open_headers_, open_page_directories_,
+   * open_sync_states_ and file_ids_.
+   */
+  static std::mutex open_mutex_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Id of the file this object represents.
+   */
+  FileId id_;
+
+  /**
+   * Descriptor of underlying filesystem object.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<Descriptor> descriptor_;
+
+  /**
+   * Latch serializing changes to the structure of the file.  Recursive
+   * because compound operations (allocatePage, deletePage) call writePage()
+   * while holding it.
+   */
+  std::shared_ptr<std::recursive_mutex> io_mutex_;
+
+  /**
+   * Mapping of the file if it was opened with openReadOnly(); null otherwise.
+   */
+  std::shared_ptr<const Mapping> mapping_;
+
+  /**
+   * Free-space map of the file, filled in only for the bitmap format.
+   */
+  std::shared_ptr<FreeSpaceMap> free_space_map_;
+
+  /**
+   * Header of the file.
+   */
+  std::shared_ptr<HeaderCache> header_cache_;
+
+  /**
+   * Page directory of the file, filled in only for the linked-list format.
+   */
+  std::shared_ptr<PageDirectory> page_directory_;
+
+  /**
+   * Durability and sync state of the file.
+   */
+  std::shared_ptr<SyncState> sync_state_;
+
+  /**
+   * On-disk format of the file.
+   */
+  FileFormat format_;
+
+  /**
+   * Placement of the pages of the file on disk.
+   */
+  FileLayout layout_;
 
   /**
    * Whether this file is valid.
    */
   bool valid_;
 
+  /**
+   * Shared copy returned by handle(); null until first asked for.  Accessed
+   * with the atomic shared_ptr functions.
+   */
+  mutable std::shared_ptr<File> handle_;
+
+  /**
+   * Set only on a shared copy made by handle(), to the copy itself.  Not
+   * copied or assigned, as it belongs to the object.
+   */
+  std::weak_ptr<File> self_;
+
   friend class FileIterator;
   friend class FileTest;
 };
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <cassert>
+#include <optional>
 
 #include "file.h"
 #include "page.h"
@@ -27,7 +28,8 @@ class FileIterator {
   /**
    * Constructs an empty iterator.
    */
-  FileIterator() : file_(NULL), current_page_number_(Page::INVALID_NUMBER) {}
+  FileIterator()
+      : file_(NULL), current_page_number_(Page::INVALID_NUMBER) {}
 
   /**
    * Constructors an iterator over the pages in a file, starting at the first
@@ -37,8 +39,8 @@ class FileIterator {
    */
   FileIterator(File *file) : file_(file) {
     assert(file_ != NULL);
-    const FileHeader &header = file_->readHeader();
-    current_page_number_ = header.first_used_page;
+    current_page_number_ = file_->firstUsedPage();
+    file_->adviseScan(current_page_number_);
   }
 
   /**
@@ -55,21 +57,14 @@ class FileIterator {
    * Advances the iterator to the next page in the file.
    */
   inline FileIterator &operator++() {
-    assert(file_ != NULL);
-    const PageHeader &header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
-
+    advance();
     return *this;
   }
 
   // postfix
   inline FileIterator operator++(int) {
     FileIterator tmp = *this;  // copy ourselves
-
-    assert(file_ != NULL);
-    const PageHeader &header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
-
+    advance();
     return tmp;
   }
 
@@ -91,15 +86,50 @@ class FileIterator {
 
   /**
    * Dereferences the iterator, returning a copy of the current page in the
-   * file.
+   * file.  The page is read from the file once and kept until the iterator
+   * moves on, so dereferencing and then advancing costs a single read.
    *
    * @return  Page in file.
    */
   inline Page operator*() const {
-    return file_->readPage(current_page_number_);
+    if (!current_page_) {
+      current_page_ = file_->readPage(current_page_number_);
+    }
+    return *current_page_;
+  }
+
+  /**
+   * Returns the current page of a file opened with File::openReadOnly() in
+   * place in the mapping, without copying it.
+   *
+   * @return  Page in file.
+   */
+  inline const Page &view() const {
+    return file_->viewPage(current_page_number_);
   }
 
  private:
+  /**
+   * Moves to the next page: the next used one in physical order in a file of
+   * the bitmap format, and otherwise the one linked from the current page,
+   * taking its number from the current page if it has already been read and
+   * from the page header on disk otherwise.
+   */
+  inline void advance() {
+    assert(file_ != NULL);
+    if (file_->format() == FileFormat::BITMAP) {
+      current_page_number_ = file_->nextUsedPage(current_page_number_);
+      current_page_.reset();
+    } else if (current_page_) {
+      current_page_number_ = current_page_->next_page_number();
+      current_page_.reset();
+    } else {
+      const PageHeader &header = file_->readPageHeader(current_page_number_);
+      current_page_number_ = header.next_page_number;
+    }
+    file_->adviseScan(current_page_number_);
+  }
+
   /**
    * File we're iterating over.
    */
@@ -109,6 +139,13 @@ class FileIterator {
    * Number of page in file iterator is currently pointing to.
    */
   PageId current_page_number_;
+
+  /**
+   * Copy of the current page, once it has been dereferenced.  Kept empty
+   * otherwise, so that iterators which are only compared (such as end())
+   * never initialize a page.
+   */
+  mutable std::optional<Page> current_page_;
 };
 
 }  // namespace badgerdb
@@ -0,0 +1,116 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "hot_page_list.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+const char MAGIC[8] = {'B', 'D', 'B', 'H', 'O', 'T', '0', '1'};
+
+/**
+ * Longest file name accepted when loading, to reject garbage early.
+ */
+const std::uint32_t MAX_NAME_LENGTH = 4096;
+
+void writeWord(std::ofstream &out, const std::uint32_t word) {
+  out.write(reinterpret_cast<const char *>(&word), sizeof(word));
+}
+
+bool readWord(std::ifstream &in, std::uint32_t &word) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&word), sizeof(word)));
+}
+
+}  // namespace
+
+void HotPageList::save(const std::string &path,
+                       const std::vector<HotPage> &pages) {
+  std::vector<const std::string *> names;
+  std::unordered_map<std::string, std::uint32_t> indexes;
+  for (const HotPage &page : pages) {
+    if (indexes.emplace(page.filename, names.size()).second) {
+      names.push_back(&page.filename);
+    }
+  }
+
+  const std::string tmp = path + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(MAGIC, sizeof(MAGIC));
+    writeWord(out, names.size());
+    for (const std::string *name : names) {
+      writeWord(out, name->size());
+      out.write(name->data(), name->size());
+    }
+    writeWord(out, pages.size());
+    for (const HotPage &page : pages) {
+      writeWord(out, indexes[page.filename]);
+      writeWord(out, page.page_number);
+    }
+    out.flush();
+    if (!out) {
+      std::remove(tmp.c_str());
+      throw BadgerDbException("Cannot write hot page list " + path);
+    }
+  }
+  if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+    std::remove(tmp.c_str());
+    throw BadgerDbException("Cannot write hot page list " + path);
+  }
+}
+
+std::vector<HotPage> HotPageList::load(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw FileNotFoundException(path);
+  }
+  const BadgerDbException invalid("Invalid hot page list " + path);
+
+  char magic[sizeof(MAGIC)];
+  std::uint32_t num_names;
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      !readWord(in, num_names)) {
+    throw invalid;
+  }
+  std::vector<std::string> names;
+  for (std::uint32_t i = 0; i < num_names; i++) {
+    std::uint32_t length;
+    if (!readWord(in, length) || length > MAX_NAME_LENGTH) throw invalid;
+    std::string name(length, '\0');
+    if (!in.read(&name[0], length)) throw invalid;
+    names.push_back(name);
+  }
+
+  std::uint32_t num_pages;
+  if (!readWord(in, num_pages)) throw invalid;
+  std::vector<HotPage> pages;
+  for (std::uint32_t i = 0; i < num_pages; i++) {
+    std::uint32_t index;
+    std::uint32_t page_number;
+    if (!readWord(in, index) || !readWord(in, page_number) ||
+        index >= names.size()) {
+      throw invalid;
+    }
+    pages.push_back(HotPage{names[index], page_number});
+  }
+  return pages;
+}
+
+}  // namespace badgerdb
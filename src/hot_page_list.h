@@ -0,0 +1,63 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief A page worth bringing back into the buffer pool after a restart.
+ */
+struct HotPage {
+  /**
+   * Name of the file the page belongs to.
+   */
+  std::string filename;
+
+  /**
+   * Number of the page within the file.
+   */
+  PageId page_number;
+};
+
+/**
+ * @brief Reads and writes lists of hot pages, used to warm up a buffer pool.
+ *
+ * The list is a small binary file: a magic string, the names of the files
+ * involved, then one (file index, page number) pair per page, in the order
+ * given, which is hottest first when written by BufMgr::dumpHotPages().
+ */
+class HotPageList {
+ public:
+  /**
+   * Writes a list of pages.  The list goes to a temporary file first and is
+   * renamed into place, so a crash never leaves a partial list behind.
+   *
+   * @param path    Path of the list.
+   * @param pages   Pages to write, in order.
+   * @throws BadgerDbException If the list cannot be written.
+   */
+  static void save(const std::string &path, const std::vector<HotPage> &pages);
+
+  /**
+   * Reads a list of pages written by save().
+   *
+   * @param path    Path of the list.
+   * @return  The pages, in the order they were written.
+   * @throws FileNotFoundException If there is no list at path.
+   * @throws BadgerDbException If the list is not valid.
+   */
+  static std::vector<HotPage> load(const std::string &path);
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,52 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include "exceptions/badgerdb_exception.h"
+#include "thread_pool_io_engine.h"
+#include "uring_io_engine.h"
+
+namespace badgerdb {
+
+std::unique_ptr<IoEngine> IoEngine::create(IoEngineType type,
+                                           std::uint32_t queue_depth) {
+  switch (type) {
+    case IoEngineType::URING:
+      return std::unique_ptr<IoEngine>(new UringIoEngine(queue_depth));
+    case IoEngineType::THREAD_POOL:
+      return std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(queue_depth));
+    case IoEngineType::AUTO:
+    default:
+      try {
+        return std::unique_ptr<IoEngine>(new UringIoEngine(queue_depth));
+      } catch (const BadgerDbException &) {
+        // an old kernel, or io_uring disabled or filtered out
+        return std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(queue_depth));
+      }
+  }
+}
+
+IoEngine::Callback IoBatch::add(std::exception_ptr *error) {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    pending_++;
+  }
+  return [this, error](std::exception_ptr e) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    *error = e;
+    if (--pending_ == 0) done_.notify_all();
+  };
+}
+
+void IoBatch::wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return pending_ == 0; });
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,176 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief I/O engines BufMgr can issue batched page I/O through.
+ */
+enum class IoEngineType {
+  /**
+   * io_uring if the kernel supports it, THREAD_POOL otherwise
+   */
+  AUTO,
+
+  /**
+   * io_uring, driven through raw system calls
+   */
+  URING,
+
+  /**
+   * Blocking positional I/O on a pool of worker threads
+   */
+  THREAD_POOL
+};
+
+/**
+ * @brief Asynchronous reads and writes of runs of consecutive pages.
+ *
+ * read() and write() queue a request and return at once; submit() hands the
+ * queued requests to the engine, so a batch goes to the kernel together.
+ * A request's callback is called exactly once, from an engine thread, with a
+ * null exception_ptr if the request succeeded or the exception File's
+ * synchronous readPages() or writePages() would have thrown.  A request that
+ * fails before it is queued may call back on the calling thread.  Callbacks
+ * must not throw, and must neither issue nor wait for requests of the same
+ * engine.
+ *
+ * At most queueDepth() requests are in flight at once; the others wait their
+ * turn, possibly in read() or write(), which then submit what is queued.  The
+ * pages of a request must stay valid, and must not be touched, until it calls
+ * back.  Destroying an engine submits queued requests and waits for all of
+ * them.
+ *
+ * All methods may be called concurrently.
+ */
+class IoEngine {
+ public:
+  /**
+   * Called when a request completes, with the exception it failed with, if
+   * any.
+   */
+  typedef std::function<void(std::exception_ptr)> Callback;
+
+  /**
+   * Requests in flight at once unless asked otherwise
+   */
+  static const std::uint32_t DEFAULT_QUEUE_DEPTH = 32;
+
+  /**
+   * Creates an engine of the given type.
+   *
+   * @param type         Engine to create
+   * @param queue_depth  Most requests in flight at once
+   * @return  The engine.
+   * @throws  BadgerDbException  If type is URING and io_uring is not
+   *                             available.
+   */
+  static std::unique_ptr<IoEngine> create(
+      IoEngineType type, std::uint32_t queue_depth = DEFAULT_QUEUE_DEPTH);
+
+  virtual ~IoEngine() {}
+
+  /**
+   * Returns the name of the engine, for statistics output.
+   */
+  virtual const char *name() const = 0;
+
+  /**
+   * Returns the most requests the engine keeps in flight at once.
+   */
+  virtual std::uint32_t queueDepth() const = 0;
+
+  /**
+   * Queues a read of a run of consecutive pages, as File::readPages().
+   *
+   * @param file    File to read from
+   * @param first   Number of the first page to read
+   * @param count   Number of pages to read
+   * @param pages   Where to put each page; pages[i] receives page first + i.
+   * The array itself may go away once read() returns.
+   * @param done    Called when the pages are in or the read failed
+   */
+  virtual void read(const File &file, PageId first, std::uint32_t count,
+                    Page *const *pages, Callback done) = 0;
+
+  /**
+   * Queues a write of a run of consecutive pages, as File::writePages().
+   *
+   * @param file    File to write to
+   * @param first   Number of the first page to write
+   * @param count   Number of pages to write
+   * @param pages   Pages to write; pages[i] is written as page first + i.
+   * The array itself may go away once write() returns.
+   * @param done    Called when the pages are written or the write failed
+   */
+  virtual void write(const File &file, PageId first, std::uint32_t count,
+                     const Page *const *pages, Callback done) = 0;
+
+  /**
+   * Hands every queued request to the engine.
+   */
+  virtual void submit() = 0;
+};
+
+/**
+ * @brief Waits for a group of requests issued to an IoEngine.
+ *
+ * Each request is given a callback from add(); wait() returns once all of
+ * them have been called.  The batch must not be destroyed before then.
+ */
+class IoBatch {
+ public:
+  IoBatch() : pending_(0) {}
+
+  IoBatch(const IoBatch &) = delete;
+  IoBatch &operator=(const IoBatch &) = delete;
+
+  /**
+   * Returns the callback for one more request.
+   *
+   * @param error   Set to the exception the request failed with, if any
+   */
+  IoEngine::Callback add(std::exception_ptr *error);
+
+  /**
+   * Waits until every request added so far has completed.
+   */
+  void wait();
+
+ private:
+  /**
+   * Protects pending_ and the error slots the callbacks fill in.
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when pending_ drops to 0.
+   */
+  std::condition_variable done_;
+
+  /**
+   * Requests added that have not completed.
+   */
+  std::size_t pending_;
+};
+
+}  // namespace badgerdb
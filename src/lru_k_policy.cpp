@@ -0,0 +1,143 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "lru_k_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+LruKPolicy::LruKPolicy(std::uint32_t numFrames, std::uint32_t maxFrames)
+    : numFrames(numFrames),
+      now(0),
+      history(new FrameHistory[maxFrames]),
+      ordered(maxFrames),
+      freeFrames(maxFrames),
+      retainedLimit(numFrames) {
+  for (FrameId i = 0; i < maxFrames; i++) store(i, History());
+  for (FrameId i = 0; i < numFrames; i++) freeFrames.pushBack(i);
+}
+
+void LruKPolicy::reference(FrameId frame) {
+  std::atomic<std::uint64_t>* times = history[frame].times;
+  const std::uint64_t t = now.fetch_add(1, std::memory_order_relaxed) + 1;
+  for (int i = K - 1; i > 0; i--) {
+    times[i].store(times[i - 1].load(std::memory_order_relaxed),
+                   std::memory_order_relaxed);
+  }
+  times[0].store(t, std::memory_order_relaxed);
+}
+
+LruKPolicy::History LruKPolicy::load(FrameId frame) const {
+  History h;
+  for (int i = 0; i < K; i++) {
+    h.times[i] = history[frame].times[i].load(std::memory_order_relaxed);
+  }
+  return h;
+}
+
+void LruKPolicy::store(FrameId frame, const History& h) {
+  for (int i = 0; i < K; i++) {
+    history[frame].times[i].store(h.times[i], std::memory_order_relaxed);
+  }
+}
+
+/**
+ * Concurrent hits on one frame may lose a reference or two; the order only
+ * has to be approximately right.
+ */
+void LruKPolicy::recordAccess(FrameId frame) { reference(frame); }
+
+void LruKPolicy::recordInsert(FrameId frame, std::uint64_t key) {
+  std::lock_guard<std::mutex> guard(latch);
+  freeFrames.remove(frame);
+  auto it = retained.find(key);
+  if (it != retained.end()) {
+    store(frame, it->second);
+    retained.erase(it);
+    retainedOrder.remove(key);
+  } else {
+    store(frame, History());
+  }
+  reference(frame);
+  ordered[frame] = orderKey(frame);
+  order.insert(ordered[frame]);
+}
+
+void LruKPolicy::recordRemove(FrameId frame, std::uint64_t key,
+                              bool evicted) {
+  std::lock_guard<std::mutex> guard(latch);
+  order.erase(ordered[frame]);
+  if (evicted) {
+    retained[key] = load(frame);
+    retainedOrder.pushFront(key);
+    if (retainedOrder.size() > retainedLimit) {
+      retained.erase(retainedOrder.popBack());
+    }
+  }
+  store(frame, History());
+  if (frame < numFrames) freeFrames.pushBack(frame);
+}
+
+/**
+ * Walks the order from the front, moving each frame that was hit since it
+ * was ordered to its current place, which is further back.  The walk is
+ * bounded so that a frame hit over and over cannot keep it going.
+ */
+bool LruKPolicy::pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                            FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (freeFrames.claimFromBack(tryClaim, frame)) return true;
+  std::size_t steps = 2 * order.size();
+  for (std::set<OrderKey>::iterator it = order.begin();
+       it != order.end() && steps > 0; steps--) {
+    const FrameId candidate = std::get<2>(*it);
+    const OrderKey current = orderKey(candidate);
+    if (current != *it) {
+      it = order.erase(it);
+      ordered[candidate] = current;
+      order.insert(current);
+      continue;
+    }
+    if (tryClaim(candidate)) {
+      frame = candidate;
+      return true;
+    }
+    ++it;
+  }
+  return false;
+}
+
+void LruKPolicy::resize(std::uint32_t newFrames) {
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId i = numFrames; i < newFrames; i++) freeFrames.pushBack(i);
+  for (FrameId i = newFrames; i < numFrames; i++) freeFrames.remove(i);
+  numFrames = newFrames;
+  retainedLimit = newFrames;
+  while (retainedOrder.size() > retainedLimit) {
+    retained.erase(retainedOrder.popBack());
+  }
+}
+
+void LruKPolicy::rankFrames(std::vector<FrameId>& frames) {
+  std::vector<OrderKey> current;
+  {
+    std::lock_guard<std::mutex> guard(latch);
+    current.reserve(order.size());
+    for (const OrderKey& entry : order) {
+      current.push_back(orderKey(std::get<2>(entry)));
+    }
+  }
+  std::sort(current.begin(), current.end());
+  for (std::vector<OrderKey>::const_reverse_iterator it = current.rbegin();
+       it != current.rend(); ++it) {
+    frames.push_back(std::get<2>(*it));
+  }
+}
+
+}  // namespace badgerdb
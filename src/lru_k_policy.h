@@ -0,0 +1,124 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "policy_lists.h"
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief LRU-K with K = 2.
+ *
+ * Evicts the page whose K-th most recent reference lies furthest in the past.
+ * Pages referenced fewer than K times have infinite backward K-distance and
+ * go first, least recently used among them first, which is what keeps a
+ * single scan from displacing pages that are referenced repeatedly.  The
+ * reference history of evicted pages is retained for as many pages as there
+ * are frames, so a page that comes back resumes its history.
+ *
+ * Hits only shift the frame's reference times, which are atomics, and take
+ * no latch.  The eviction order is therefore allowed to go stale; pickVictim()
+ * moves a frame whose times changed since it was last ordered to its new
+ * place before considering it.
+ */
+class LruKPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Number of references tracked per page.
+   */
+  static const int K = 2;
+
+  LruKPolicy(std::uint32_t numFrames, std::uint32_t maxFrames);
+
+  const char* name() const override { return "LRU-2"; }
+  void recordAccess(FrameId frame) override;
+  void recordInsert(FrameId frame, std::uint64_t key) override;
+  void recordRemove(FrameId frame, std::uint64_t key, bool evicted) override;
+  bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                  FrameId& frame) override;
+  void resize(std::uint32_t newFrames) override;
+  void rankFrames(std::vector<FrameId>& frames) override;
+
+ private:
+  /**
+   * Logical times of the K most recent references, most recent first; 0 if
+   * there were fewer references.
+   */
+  struct History {
+    std::uint64_t times[K];
+  };
+
+  /**
+   * History of the page in a frame, updated by hits without the latch.
+   */
+  struct FrameHistory {
+    std::atomic<std::uint64_t> times[K];
+  };
+
+  /**
+   * Eviction order: (K-th reference, last reference, frame), ascending
+   */
+  typedef std::tuple<std::uint64_t, std::uint64_t, FrameId> OrderKey;
+
+  /**
+   * Returns the frame's current place in the eviction order.
+   */
+  OrderKey orderKey(FrameId frame) const {
+    return OrderKey(history[frame].times[K - 1].load(std::memory_order_relaxed),
+                    history[frame].times[0].load(std::memory_order_relaxed),
+                    frame);
+  }
+
+  /**
+   * Records a reference at the next logical time.
+   */
+  void reference(FrameId frame);
+
+  /**
+   * Copies the frame's history out of or into the frame.
+   */
+  History load(FrameId frame) const;
+  void store(FrameId frame, const History& h);
+
+  std::mutex latch;
+
+  /**
+   * Number of frames in use; frames from here up are retired.
+   */
+  std::uint32_t numFrames;
+
+  std::atomic<std::uint64_t> now;
+  std::unique_ptr<FrameHistory[]> history;
+
+  /**
+   * Frames holding pages, each at the key it had when it was last ordered,
+   * and that key per frame.
+   */
+  std::set<OrderKey> order;
+  std::vector<OrderKey> ordered;
+  FrameList freeFrames;
+
+  /**
+   * Histories of evicted pages and their eviction order.
+   */
+  std::unordered_map<std::uint64_t, History> retained;
+  KeyList retainedOrder;
+  std::uint32_t retainedLimit;
+};
+
+}  // namespace badgerdb
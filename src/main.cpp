@@ -1,17 +1,29 @@
 #include <stdlib.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <iostream>
 //#include <stdio.h>
 #include <cstring>
+#include <fstream>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "buffer.h"
+#include "exceptions/badgerdb_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 #include "page_iterator.h"
@@ -40,6 +52,28 @@ void test3(File &file4);
 void test4(File &file4);
 void test5(File &file4);
 void test6(File &file1);
+void test7(File &file1);
+void test8(File &file1);
+void test9(File &file1);
+void test10(File &file1);
+void test11(File &file1);
+void test12(File &file1);
+void test13(File &file1);
+void test14(File &file1);
+void test15(File &file1);
+void test16(File &file1);
+void test17(File &file1);
+void test18(File &file1, File &file2);
+void test19(File &file1);
+void test20(File &file1);
+void test21(File &file1);
+void test22(File &file1);
+void test23(File &file1);
+void test24(File &file1);
+void test25(File &file1);
+void test26(File &file1);
+void test27(File &file1);
+void test28(File &file1);
 // Calls the above tests
 void testBufMgr();
 
@@ -140,6 +174,28 @@ void testBufMgr() {
     test4(file4);
     test5(file5);
     test6(file1);
+    test7(file1);
+    test8(file1);
+    test9(file1);
+    test10(file1);
+    test11(file1);
+    test12(file1);
+    test13(file1);
+    test14(file1);
+    test15(file1);
+    test16(file1);
+    test17(file1);
+    test18(file1, file2);
+    test19(file1);
+    test20(file1);
+    test21(file1);
+    test22(file1);
+    test23(file1);
+    test24(file1);
+    test25(file1);
+    test26(file1);
+    test27(file1);
+    test28(file1);
 
     // Close the files by going out of scope
   }
@@ -297,3 +353,1401 @@ void test6(File &file1) {
 
   bufMgr->flushFile(file1);
 }
+
+void test7(File &file1) {
+  // Several threads reading the same pages through a pool smaller than the
+  // file, so hits, misses and evictions all race with each other.
+  std::shared_ptr<BufMgr> smallMgr = std::make_shared<BufMgr>(num / 4);
+  std::vector<std::thread> threads;
+  std::atomic<bool> failed(false);
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&, t]() {
+      char expected[100];
+      Page *threadPage;
+      for (int j = 0; j < 1000; j++) {
+        const PageId pageNo = (j * 7 + t * 13) % num + 1;
+        smallMgr->readPage(file1, pageNo, threadPage);
+        sprintf(expected, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+        if (strncmp(threadPage->getRecord({pageNo, 1}).c_str(), expected,
+                    strlen(expected)) != 0) {
+          failed = true;
+        }
+        smallMgr->unPinPage(file1, pageNo, false);
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+  if (failed) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  std::cout << "Test 7 passed"
+            << "\n";
+}
+
+void test8(File &file1) {
+  // Every replacement policy must return the right pages through a pool much
+  // smaller than the file and report a full pool when every frame is pinned.
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+  const PageId frames = num / 10;
+  for (ReplacementPolicyType policy : policies) {
+    BufMgr policyMgr(frames, policy);
+    for (int round = 0; round < 3; round++) {
+      for (i = 1; i <= num; i++) {
+        // interleave a small hot set with a scan of the whole file
+        const PageId pageNo = (i % 2 == 0) ? i % 4 + 1 : i;
+        policyMgr.readPage(file1, pageNo, page);
+        sprintf(tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+        if (strncmp(page->getRecord({pageNo, 1}).c_str(), tmpbuf,
+                    strlen(tmpbuf)) != 0) {
+          PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+        }
+        policyMgr.unPinPage(file1, pageNo, false);
+      }
+    }
+    if (policyMgr.getBufStats().hits() == 0) {
+      PRINT_ERROR("ERROR :: " << policyMgr.getBufStats().policy
+                              << " never hit the hot set");
+    }
+
+    for (i = 1; i <= frames; i++) policyMgr.readPage(file1, i, page);
+    try {
+      policyMgr.readPage(file1, frames + 1, page);
+      PRINT_ERROR(
+          "ERROR :: No more frames left for allocation. Exception should "
+          "have been thrown before execution reaches this point.");
+    } catch (const BufferExceededException &e) {
+    }
+    for (i = 1; i <= frames; i++) policyMgr.unPinPage(file1, i, false);
+  }
+
+  std::cout << "Test 8 passed"
+            << "\n";
+}
+
+void test9(File &file1) {
+  // Evicting a dirty page must write back only that page: the rest of its
+  // file stays cached, even while another of its pages is pinned.
+  const PageId frames = num / 10;
+  BufMgr evictMgr(frames);
+  evictMgr.readPage(file1, 1, page);
+  for (i = 2; i <= frames; i++) {
+    evictMgr.readPage(file1, i, page);
+    evictMgr.unPinPage(file1, i, true);
+  }
+
+  evictMgr.clearBufStats();
+  evictMgr.readPage(file1, frames + 1, page);
+  sprintf(tmpbuf, "test.1 Page %u %7.1f", frames + 1, (float)(frames + 1));
+  if (strncmp(page->getRecord({frames + 1, 1}).c_str(), tmpbuf,
+              strlen(tmpbuf)) != 0) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  evictMgr.unPinPage(file1, frames + 1, false);
+  if (evictMgr.getBufStats().diskwrites() != 1) {
+    PRINT_ERROR("ERROR :: Evicting one dirty page wrote "
+                << evictMgr.getBufStats().diskwrites() << " pages");
+  }
+
+  evictMgr.unPinPage(file1, 1, false);
+  evictMgr.flushFile(file1);
+
+  std::cout << "Test 9 passed"
+            << "\n";
+}
+
+void test10(File &file1) {
+  // With the cleaner running, dirty victims are written back in the
+  // background and misses take their frames from the reserve.
+  const PageId frames = num / 10;
+  BufMgr cleanMgr(frames);
+  for (i = 1; i <= frames; i++) {
+    cleanMgr.readPage(file1, i, page);
+    cleanMgr.unPinPage(file1, i, true);
+  }
+  cleanMgr.startCleaner(2, 4);
+  for (int wait = 0; wait < 1000 && cleanMgr.getBufStats().cleanerFrees() < 4;
+       wait++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (cleanMgr.getBufStats().cleanerWrites() == 0) {
+    PRINT_ERROR("ERROR :: Cleaner wrote no dirty pages");
+  }
+
+  for (i = frames + 1; i <= num; i++) {
+    cleanMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    cleanMgr.unPinPage(file1, i, false);
+  }
+  if (cleanMgr.getBufStats().reserveHits() == 0) {
+    PRINT_ERROR("ERROR :: No miss was served from the reserve");
+  }
+  cleanMgr.stopCleaner();
+
+  std::cout << "Test 10 passed"
+            << "\n";
+}
+
+void test11(File &file1) {
+  // Pages read ahead are found in the pool, unpinned, when they are asked
+  // for, and a sequential reader gets read-ahead without asking.
+  const PageId frames = num / 10;
+  BufMgr aheadMgr(frames);
+  aheadMgr.readAhead(file1, 1, frames);
+  for (int wait = 0;
+       wait < 1000 && aheadMgr.getBufStats().prefetches() < (std::uint64_t)frames;
+       wait++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (i = 1; i <= frames; i++) {
+    aheadMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    aheadMgr.unPinPage(file1, i, false);
+  }
+  if (aheadMgr.getBufStats().prefetchHits() != (std::uint64_t)frames) {
+    PRINT_ERROR("ERROR :: Pages read ahead were not found in the pool");
+  }
+
+  aheadMgr.clearBufStats();
+  aheadMgr.setReadAhead(8);
+  for (i = frames + 1; i <= num; i++) {
+    aheadMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    aheadMgr.unPinPage(file1, i, false);
+  }
+  for (int wait = 0; wait < 1000 && aheadMgr.getBufStats().prefetches() == 0;
+       wait++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (aheadMgr.getBufStats().prefetches() == 0) {
+    PRINT_ERROR("ERROR :: Sequential reads were not read ahead");
+  }
+  aheadMgr.flushFile(file1);
+
+  std::cout << "Test 11 passed"
+            << "\n";
+}
+
+void test12(File &file1) {
+  // PinnedPage handles unpin when they go out of scope, including when an
+  // exception unwinds past them, and carry the dirty flag with them.
+  BufMgr guardMgr(num / 10);
+  RecordId newRid;
+  PageId newPageNo;
+  {
+    PinnedPage newPage = guardMgr.allocPage(file1);
+    newPageNo = newPage.page_number();
+    newRid = newPage->insertRecord("test.1 guarded page");
+    newPage.markDirty();
+  }
+  try {
+    PinnedPage pinned = guardMgr.readPage(file1, 1);
+    PinnedPage moved = std::move(pinned);
+    if (pinned || !moved || moved.page_number() != 1) {
+      PRINT_ERROR("ERROR :: Moving a PinnedPage did not move the pin");
+    }
+    guardMgr.readPage(file1, newPageNo, page);
+    guardMgr.unPinPage(file1, newPageNo, false);
+    throw InvalidPageException(1, file1.filename());
+  } catch (const InvalidPageException &e) {
+  }
+  guardMgr.flushFile(file1);
+
+  Page onDisk = file1.readPage(newPageNo);
+  if (onDisk.getRecord(newRid) != "test.1 guarded page") {
+    PRINT_ERROR("ERROR :: Dirty page was not written back");
+  }
+  file1.deletePage(newPageNo);
+
+  std::cout << "Test 12 passed"
+            << "\n";
+}
+
+void test13(File &file1) {
+  // A scan through a BufferRing recycles the ring's frames and leaves the
+  // pages other callers are using in the pool.
+  BufMgr ringMgr(num / 10);
+  BufferRing ring(4);
+  for (i = 1; i <= 4; i++) {
+    ringMgr.readPage(file1, i, page);
+    ringMgr.unPinPage(file1, i, false);
+  }
+  for (i = 5; i <= num; i++) {
+    ringMgr.readPage(file1, i, page, &ring);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    ringMgr.unPinPage(file1, i, false);
+  }
+  if (ringMgr.getBufStats().ringReuses() !=
+      (std::uint64_t)(num - 4 - ring.size())) {
+    PRINT_ERROR("ERROR :: Scan did not recycle its ring");
+  }
+
+  ringMgr.clearBufStats();
+  for (i = 1; i <= 4; i++) {
+    ringMgr.readPage(file1, i, page);
+    ringMgr.unPinPage(file1, i, false);
+  }
+  if (ringMgr.getBufStats().hits() != 4) {
+    PRINT_ERROR("ERROR :: Scan evicted pages outside its ring");
+  }
+  ringMgr.flushFile(file1);
+
+  std::cout << "Test 13 passed"
+            << "\n";
+}
+
+void test14(File &file1) {
+  // readPages pins every page of a batch, reading consecutive misses with
+  // one request, and leaves nothing pinned when the batch fails.
+  BufMgr batchMgr(num / 10);
+  batchMgr.readPage(file1, 3, page);
+  batchMgr.unPinPage(file1, 3, false);
+  batchMgr.clearBufStats();
+
+  const std::vector<PageId> batch = {7, 3, 5, 6, 5, 20};
+  std::vector<Page *> pages;
+  batchMgr.readPages(file1, batch, pages);
+  for (std::size_t j = 0; j < batch.size(); j++) {
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", batch[j], (float)batch[j]);
+    if (strncmp(pages[j]->getRecord({batch[j], 1}).c_str(), tmpbuf,
+                strlen(tmpbuf)) != 0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  if (batchMgr.getBufStats().hits() != 1 ||
+      batchMgr.getBufStats().readRuns() != 2) {
+    PRINT_ERROR("ERROR :: Batch was not read in runs");
+  }
+  for (PageId pageNo : batch) batchMgr.unPinPage(file1, pageNo, false);
+
+  try {
+    batchMgr.readPages(file1, {1, 2, num + 100}, pages);
+    PRINT_ERROR(
+        "ERROR :: Page does not exist. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  std::vector<PageId> tooMany;
+  for (i = 1; i <= num / 10 + 1; i++) tooMany.push_back(i);
+  try {
+    batchMgr.readPages(file1, tooMany, pages);
+    PRINT_ERROR(
+        "ERROR :: No more frames left for allocation. Exception should "
+        "have been thrown before execution reaches this point.");
+  } catch (const BufferExceededException &e) {
+  }
+  batchMgr.flushFile(file1);
+
+  std::cout << "Test 14 passed"
+            << "\n";
+}
+
+void test15(File &file1) {
+  // Per-thread metrics add up across threads, count evictions and per-file
+  // hits, and snapshots can be subtracted.
+  const PageId frames = num / 10;
+  BufMgr statsMgr(frames);
+  statsMgr.getBufStats().metrics.setEnabled(true);
+  for (i = 1; i <= 2 * frames; i++) {
+    statsMgr.readPage(file1, i, page);
+    statsMgr.unPinPage(file1, i, i % 2 == 0);
+  }
+  const BufMetrics::Snapshot before = statsMgr.getBufStats().snapshot();
+  std::thread reader([&]() {
+    Page *threadPage;
+    for (PageId pageNo = frames + 1; pageNo <= 2 * frames; pageNo++) {
+      statsMgr.readPage(file1, pageNo, threadPage);
+      statsMgr.unPinPage(file1, pageNo, false);
+    }
+  });
+  reader.join();
+  const BufMetrics::Snapshot after = statsMgr.getBufStats().snapshot();
+
+  const int readOp = static_cast<int>(BufOp::READ_PAGE);
+  if (before.latency[readOp].count() != 2 * frames ||
+      after.latency[readOp].count() != 3 * frames) {
+    PRINT_ERROR("ERROR :: readPage latencies were not all recorded");
+  }
+  if (before.cleanEvictions + before.dirtyEvictions != frames ||
+      before.dirtyEvictions != frames / 2 || before.sweep.count() != frames) {
+    PRINT_ERROR("ERROR :: Evictions were not counted");
+  }
+  const BufMetrics::Snapshot diff = after - before;
+  const BufMetrics::FileCounts &counts = diff.files.at(file1.id());
+  if (counts.hits != frames || counts.misses != 0 ||
+      diff.count(BufCounter::HITS) != frames ||
+      diff.latency[readOp].count() != frames) {
+    PRINT_ERROR("ERROR :: Snapshot difference is wrong");
+  }
+  std::ostringstream dump;
+  statsMgr.getBufStats().dump(dump);
+  if (dump.str().find(file1.filename()) == std::string::npos) {
+    PRINT_ERROR("ERROR :: Dump does not list the file");
+  }
+
+  statsMgr.clearBufStats();
+  if (statsMgr.getBufStats().snapshot().latency[readOp].count() != 0) {
+    PRINT_ERROR("ERROR :: Metrics were not cleared");
+  }
+  statsMgr.flushFile(file1);
+
+  std::cout << "Test 15 passed"
+            << "\n";
+}
+
+void test16(File &file1) {
+  // The pool can shrink and grow while in use: dirty pages in retired frames
+  // are written back, and a reader running throughout sees the right pages.
+  const ReplacementPolicyType policies[] = {
+      ReplacementPolicyType::CLOCK, ReplacementPolicyType::LRU_K,
+      ReplacementPolicyType::TWO_Q, ReplacementPolicyType::ARC,
+      ReplacementPolicyType::CLOCK_PRO};
+  const PageId frames = num / 10;
+  for (ReplacementPolicyType policy : policies) {
+    BufMgr resizeMgr(frames, policy, 4 * frames);
+    for (i = 1; i <= frames; i++) {
+      resizeMgr.readPage(file1, i, page);
+      resizeMgr.unPinPage(file1, i, true);
+    }
+    resizeMgr.clearBufStats();
+    resizeMgr.resize(frames / 2);
+    if (resizeMgr.getBufStats().diskwrites() != (std::uint64_t)(frames / 2)) {
+      PRINT_ERROR("ERROR :: Shrinking wrote back "
+                  << resizeMgr.getBufStats().diskwrites() << " pages");
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<bool> failed(false);
+    std::thread reader([&]() {
+      char expected[100];
+      Page *threadPage;
+      for (PageId pageNo = 1; !stop; pageNo = pageNo % num + 1) {
+        resizeMgr.readPage(file1, pageNo, threadPage);
+        sprintf(expected, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+        if (strncmp(threadPage->getRecord({pageNo, 1}).c_str(), expected,
+                    strlen(expected)) != 0) {
+          failed = true;
+        }
+        resizeMgr.unPinPage(file1, pageNo, false);
+      }
+    });
+    for (int round = 0; round < 20; round++) {
+      resizeMgr.resize(round % 2 == 0 ? 4 * frames : frames / 2);
+    }
+    stop = true;
+    reader.join();
+    if (failed) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+
+    // the pool now holds exactly frames / 2 pages at once
+    for (i = 1; i <= frames / 2; i++) resizeMgr.readPage(file1, i, page);
+    try {
+      resizeMgr.readPage(file1, frames, page);
+      PRINT_ERROR(
+          "ERROR :: No more frames left for allocation. Exception should "
+          "have been thrown before execution reaches this point.");
+    } catch (const BufferExceededException &e) {
+    }
+    resizeMgr.resize(4 * frames);
+    for (i = frames / 2 + 1; i <= 4 * frames; i++) {
+      resizeMgr.readPage(file1, i, page);
+    }
+    for (i = 1; i <= 4 * frames; i++) resizeMgr.unPinPage(file1, i, false);
+    try {
+      resizeMgr.resize(4 * frames + 1);
+      PRINT_ERROR(
+          "ERROR :: Pool cannot grow past its capacity. Exception should "
+          "have been thrown before execution reaches this point.");
+    } catch (const BufferExceededException &e) {
+    }
+    resizeMgr.flushFile(file1);
+  }
+
+  std::cout << "Test 16 passed"
+            << "\n";
+}
+
+void test17(File &file1) {
+  // A pool warmed up from the hot page list of another one holds its hottest
+  // pages, read in the background before they are asked for.
+  const std::string hotPages = "test.hot";
+  const PageId frames = num / 10;
+  {
+    BufMgr warmMgr(frames, ReplacementPolicyType::LRU_K);
+    warmMgr.setHotPagesFile(hotPages);
+    for (i = 1; i <= frames / 2; i++) {
+      warmMgr.readPage(file1, i, page);
+      warmMgr.unPinPage(file1, i, false);
+    }
+    // pages seen twice rank above the ones seen once
+    for (i = frames / 2 - frames / 4 + 1; i <= frames / 2; i++) {
+      warmMgr.readPage(file1, i, page);
+      warmMgr.unPinPage(file1, i, false);
+    }
+    if (warmMgr.dumpHotPages(hotPages) != frames / 2) {
+      PRINT_ERROR("ERROR :: Hot page list is missing pages");
+    }
+  }
+
+  BufMgr coldMgr(frames / 4);
+  if (coldMgr.loadHotPages(hotPages) != frames / 4) {
+    PRINT_ERROR("ERROR :: Warm-up did not fill the pool");
+  }
+  for (int wait = 0;
+       wait < 1000 &&
+       coldMgr.getBufStats().prefetches() < (std::uint64_t)(frames / 4);
+       wait++) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  for (i = frames / 2 - frames / 4 + 1; i <= frames / 2; i++) {
+    coldMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    coldMgr.unPinPage(file1, i, false);
+  }
+  if (coldMgr.getBufStats().prefetchHits() != (std::uint64_t)(frames / 4)) {
+    PRINT_ERROR("ERROR :: Hot pages were not loaded");
+  }
+
+  try {
+    coldMgr.loadHotPages("test.nohot");
+    PRINT_ERROR(
+        "ERROR :: Hot page list does not exist. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const FileNotFoundException &e) {
+  }
+  std::remove(hotPages.c_str());
+
+  std::cout << "Test 17 passed"
+            << "\n";
+}
+
+void test18(File &file1, File &file2) {
+  // Flushing a file writes back and drops its own pages only, whatever else
+  // is in the pool or pinned there.
+  const PageId frames = num / 10;
+  BufMgr flushMgr(frames);
+  for (i = 1; i <= frames / 2; i++) {
+    flushMgr.readPage(file1, i, page);
+    flushMgr.unPinPage(file1, i, true);
+    flushMgr.readPage(file2, i, page2);
+    if (i > 1) flushMgr.unPinPage(file2, i, false);
+  }
+  flushMgr.clearBufStats();
+  flushMgr.flushFile(file1);
+  if (flushMgr.getBufStats().diskwrites() != (std::uint64_t)(frames / 2)) {
+    PRINT_ERROR("ERROR :: Flushing wrote back "
+                << flushMgr.getBufStats().diskwrites() << " pages");
+  }
+
+  flushMgr.clearBufStats();
+  for (i = 1; i <= frames / 2; i++) {
+    flushMgr.readPage(file2, i, page2);
+    sprintf(tmpbuf, "test.2 Page %u %7.1f", i, (float)i);
+    if (strncmp(page2->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    flushMgr.unPinPage(file2, i, false);
+  }
+  flushMgr.readPage(file1, 1, page);
+  flushMgr.unPinPage(file1, 1, false);
+  if (flushMgr.getBufStats().hits() != (std::uint64_t)(frames / 2) ||
+      flushMgr.getBufStats().misses() != 1) {
+    PRINT_ERROR("ERROR :: Flushing dropped pages of another file");
+  }
+  flushMgr.unPinPage(file2, 1, false);
+  flushMgr.flushFile(file1);
+  flushMgr.flushFile(file2);
+
+  std::cout << "Test 18 passed"
+            << "\n";
+}
+
+void test19(File &file1) {
+  // Flushing writes consecutive dirty pages back with one write per run.
+  const PageId frames = num / 10;
+  BufMgr writeMgr(frames);
+  for (i = 1; i <= frames; i++) {
+    writeMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "flushed %u", i);
+    page->updateRecord({i, 1}, tmpbuf);
+    writeMgr.unPinPage(file1, i, true);
+  }
+  writeMgr.clearBufStats();
+  writeMgr.flushFile(file1);
+  if (writeMgr.getBufStats().diskwrites() != (std::uint64_t)frames ||
+      writeMgr.getBufStats().writeCalls() != 1) {
+    PRINT_ERROR("ERROR :: Dirty pages were written in "
+                << writeMgr.getBufStats().writeCalls() << " writes");
+  }
+
+  // put the records back, then dirty every other page only
+  for (i = 1; i <= frames; i++) {
+    writeMgr.readPage(file1, i, page);
+    sprintf(tmpbuf, "flushed %u", i);
+    if (strncmp(page->getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    page->updateRecord({i, 1}, tmpbuf);
+    writeMgr.unPinPage(file1, i, true);
+  }
+  writeMgr.flushFile(file1);
+  for (i = 1; i <= frames; i++) {
+    writeMgr.readPage(file1, i, page);
+    writeMgr.unPinPage(file1, i, i % 2 == 1);
+  }
+  writeMgr.clearBufStats();
+  writeMgr.flushFile(file1);
+  if (writeMgr.getBufStats().writeCalls() != (std::uint64_t)(frames / 2) ||
+      writeMgr.getBufStats().bytesPerWrite() != Page::SIZE) {
+    PRINT_ERROR("ERROR :: Pages apart were not written one by one");
+  }
+
+  std::cout << "Test 19 passed"
+            << "\n";
+}
+
+void test20(File &file1) {
+  // A checkpoint writes back every page dirty when it began, pinned or not,
+  // and leaves them all in the pool.
+  const PageId frames = num / 10;
+  BufMgr checkpointMgr(frames);
+  for (i = 1; i <= frames; i++) {
+    checkpointMgr.readPage(file1, i, page);
+    checkpointMgr.unPinPage(file1, i, true);
+  }
+  checkpointMgr.readPage(file1, 1, page);
+  if (checkpointMgr.dirtyPageTable().size() != frames) {
+    PRINT_ERROR("ERROR :: Dirty page table is missing pages");
+  }
+
+  checkpointMgr.clearBufStats();
+  const Checkpoint done = checkpointMgr.checkpoint();
+  if (done.number != 1 || done.pagesWritten != frames ||
+      done.pagesFailed != 0 ||
+      checkpointMgr.getBufStats().checkpointWrites() != (std::uint64_t)frames ||
+      checkpointMgr.getBufStats().writeCalls() != 1) {
+    PRINT_ERROR("ERROR :: Checkpoint wrote " << done.pagesWritten
+                                             << " pages");
+  }
+  if (!checkpointMgr.dirtyPageTable().empty()) {
+    PRINT_ERROR("ERROR :: Pages are still dirty after a checkpoint");
+  }
+
+  // pages dirtied since are left to the next checkpoint
+  checkpointMgr.unPinPage(file1, 1, true);
+  const std::vector<DirtyPage> dirty = checkpointMgr.dirtyPageTable();
+  if (dirty.size() != 1 || dirty[0].pageNo != 1 ||
+      dirty[0].firstDirty <= done.dirtyBound) {
+    PRINT_ERROR("ERROR :: Dirty page table is wrong");
+  }
+  for (i = 1; i <= frames; i++) {
+    checkpointMgr.readPage(file1, i, page);
+    checkpointMgr.unPinPage(file1, i, false);
+  }
+  if (checkpointMgr.getBufStats().hits() != (std::uint64_t)frames) {
+    PRINT_ERROR("ERROR :: Checkpoint evicted pages");
+  }
+  if (checkpointMgr.checkpoint().pagesWritten != 1) {
+    PRINT_ERROR("ERROR :: Second checkpoint did not write the page");
+  }
+  checkpointMgr.flushFile(file1);
+
+  std::cout << "Test 20 passed"
+            << "\n";
+}
+
+void test21(File &file1) {
+  // Looking a page up without reading it pins it only if it is resident.
+  BufMgr lookupMgr(num / 10);
+  if (lookupMgr.readPageIfResident(file1, 1, page)) {
+    PRINT_ERROR("ERROR :: Page was found before it was read");
+  }
+  lookupMgr.readPage(file1, 1, page);
+  lookupMgr.unPinPage(file1, 1, false);
+  if (!lookupMgr.readPageIfResident(file1, 1, page)) {
+    PRINT_ERROR("ERROR :: Resident page was not found");
+  }
+  sprintf(tmpbuf, "test.1 Page %u %7.1f", 1, 1.0f);
+  if (strncmp(page->getRecord({1, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  try {
+    lookupMgr.flushFile(file1);
+    PRINT_ERROR(
+        "ERROR :: Page was left pinned. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const PagePinnedException &e) {
+  }
+  lookupMgr.unPinPage(file1, 1, false);
+  // unpinning a page that is not in the pool is ignored
+  lookupMgr.unPinPage(file1, 2, false);
+  lookupMgr.flushFile(file1);
+
+  // A pinned page can't be disposed of; once unpinned it is deleted from the
+  // pool and the file, and so is a page that was never in the pool.
+  PageId disposedPageNo;
+  lookupMgr.allocPage(file1, disposedPageNo, page);
+  try {
+    lookupMgr.disposePage(file1, disposedPageNo);
+    PRINT_ERROR(
+        "ERROR :: Page was left pinned. Exception should have been thrown "
+        "before execution reaches this point.");
+  } catch (const PagePinnedException &e) {
+  }
+  lookupMgr.unPinPage(file1, disposedPageNo, false);
+  lookupMgr.disposePage(file1, disposedPageNo);
+  if (lookupMgr.readPageIfResident(file1, disposedPageNo, page)) {
+    PRINT_ERROR("ERROR :: Disposed page is still in the pool");
+  }
+  const PageId unreadPageNo = file1.allocatePage().page_number();
+  lookupMgr.disposePage(file1, unreadPageNo);
+  for (const PageId pageNo : {disposedPageNo, unreadPageNo}) {
+    try {
+      file1.readPage(pageNo);
+      PRINT_ERROR("ERROR :: Disposed page " << pageNo << " is still in file");
+    } catch (const InvalidPageException &e) {
+    }
+  }
+
+  std::cout << "Test 21 passed"
+            << "\n";
+}
+
+void test22(File &file1) {
+  // Both I/O engines read and write runs of pages with all requests in flight
+  // at once, report errors through the callback, and serve the buffer
+  // manager.
+  const PageId frames = num / 10;
+  for (IoEngineType type : {IoEngineType::URING, IoEngineType::THREAD_POOL}) {
+    std::unique_ptr<IoEngine> engine;
+    try {
+      engine = IoEngine::create(type, 4);
+    } catch (const BadgerDbException &) {
+      continue;  // no io_uring here
+    }
+    std::vector<Page> pages(frames);
+    std::vector<Page *> pointers;
+    for (Page &p : pages) pointers.push_back(&p);
+    std::vector<std::exception_ptr> errors(frames / 2 + 1);
+    {
+      IoBatch batch;
+      for (i = 0; i < frames / 2; i++) {
+        engine->read(file1, 2 * i + 1, 2, &pointers[2 * i],
+                     batch.add(&errors[i]));
+      }
+      engine->read(file1, num * 10, 1, &pointers[0],
+                   batch.add(&errors[frames / 2]));
+      engine->submit();
+      batch.wait();
+    }
+    for (i = 0; i < frames / 2; i++) {
+      if (errors[i]) PRINT_ERROR("ERROR :: Read through " << engine->name()
+                                                          << " failed");
+    }
+    for (i = 1; i <= frames; i++) {
+      sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+      if (strncmp(pages[i - 1].getRecord({i, 1}).c_str(), tmpbuf,
+                  strlen(tmpbuf)) != 0) {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+    }
+    try {
+      if (errors[frames / 2]) std::rethrow_exception(errors[frames / 2]);
+      PRINT_ERROR("ERROR :: Read past the end of the file succeeded");
+    } catch (const InvalidPageException &e) {
+    }
+
+    // writes go through the engine too, and report errors the same way
+    std::vector<std::exception_ptr> writeErrors(2);
+    {
+      IoBatch batch;
+      const Page *written[] = {&pages[0], &pages[1]};
+      engine->write(file1, 1, 2, written, batch.add(&writeErrors[0]));
+      engine->write(file1, num * 10, 1, written, batch.add(&writeErrors[1]));
+      engine->submit();
+      batch.wait();
+    }
+    if (writeErrors[0]) {
+      PRINT_ERROR("ERROR :: Write through " << engine->name() << " failed");
+    }
+    try {
+      if (writeErrors[1]) std::rethrow_exception(writeErrors[1]);
+      PRINT_ERROR("ERROR :: Write past the end of the file succeeded");
+    } catch (const InvalidPageException &e) {
+    }
+
+    BufMgr engineMgr(frames);
+    engineMgr.setIoEngine(type);
+    if (strcmp(engineMgr.getBufStats().ioEngine, engine->name()) != 0) {
+      PRINT_ERROR("ERROR :: Buffer manager is using the wrong engine");
+    }
+    std::vector<PageId> pageNos;
+    for (PageId k = 0; k < frames; k += 3) pageNos.push_back(frames - k);
+    std::vector<Page *> read;
+    engineMgr.readPages(file1, pageNos, read);
+    for (std::size_t k = 0; k < pageNos.size(); k++) {
+      sprintf(tmpbuf, "engine %u", pageNos[k]);
+      read[k]->updateRecord({pageNos[k], 1}, tmpbuf);
+      engineMgr.unPinPage(file1, pageNos[k], true);
+    }
+    engineMgr.flushFile(file1);
+    for (PageId pageNo : pageNos) {
+      Page page = file1.readPage(pageNo);
+      sprintf(tmpbuf, "engine %u", pageNo);
+      if (strncmp(page.getRecord({pageNo, 1}).c_str(), tmpbuf,
+                  strlen(tmpbuf)) != 0) {
+        PRINT_ERROR("ERROR :: Page was not written through the engine");
+      }
+      sprintf(tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+      page.updateRecord({pageNo, 1}, tmpbuf);
+      file1.writePage(page);
+    }
+  }
+
+  std::cout << "Test 22 passed"
+            << "\n";
+}
+
+void test23(File &file1) {
+  // A file opened read-only is mapped: pages are viewed in place, read and
+  // iterated as usual, and cannot be written.
+  const PageId frames = num / 10;
+  File mapped = File::openReadOnly(file1.filename());
+  for (i = 1; i <= frames; i++) {
+    const Page &view = mapped.viewPage(i);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    if (strncmp(view.getRecord({i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0 ||
+        mapped.readPage(i).getRecord({i, 1}) != view.getRecord({i, 1})) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  PageId scanned = 0;
+  for (FileIterator iter = mapped.begin(); iter != mapped.end(); ++iter) {
+    if (&iter.view() != &mapped.viewPage(iter.view().page_number())) {
+      PRINT_ERROR("ERROR :: Iterator did not view the mapping");
+    }
+    scanned++;
+  }
+  PageId expected = 0;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    expected++;
+  }
+  if (scanned != expected) {
+    PRINT_ERROR("ERROR :: Scanned " << scanned << " of " << expected
+                                    << " pages");
+  }
+
+  try {
+    mapped.writePage(mapped.readPage(1));
+    PRINT_ERROR("ERROR :: Read-only file was written");
+  } catch (const ReadOnlyFileException &e) {
+  }
+  try {
+    mapped.viewPage(num * 10);
+    PRINT_ERROR("ERROR :: Viewed a page past the end of the file");
+  } catch (const InvalidPageException &e) {
+  }
+  try {
+    file1.viewPage(1);
+    PRINT_ERROR("ERROR :: Viewed a page of a file that is not mapped");
+  } catch (const BadgerDbException &e) {
+  }
+
+  // the buffer manager copies pages straight out of the mapping
+  BufMgr mappedMgr(frames);
+  std::vector<PageId> pageNos;
+  for (i = 1; i <= frames; i += 2) pageNos.push_back(i);
+  std::vector<Page *> read;
+  mappedMgr.readPages(mapped, pageNos, read);
+  for (std::size_t k = 0; k < pageNos.size(); k++) {
+    if (read[k]->getRecord({pageNos[k], 1}) !=
+        mapped.viewPage(pageNos[k]).getRecord({pageNos[k], 1})) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    mappedMgr.unPinPage(mapped, pageNos[k], false);
+  }
+  mappedMgr.flushFile(mapped);
+
+  // a page read through both kinds of handle gets a frame for each, and
+  // only the writable one's can be dirtied and written back
+  if (mapped.id() == file1.id()) {
+    PRINT_ERROR("ERROR :: Mapped and writable handles share an id");
+  }
+  Page *viaMapped;
+  Page *viaFile;
+  mappedMgr.readPage(mapped, 1, viaMapped);
+  mappedMgr.readPage(file1, 1, viaFile);
+  if (viaMapped == viaFile) {
+    PRINT_ERROR("ERROR :: Mapped and writable handles share a frame");
+  }
+  try {
+    mappedMgr.unPinPage(mapped, 1, true);
+    PRINT_ERROR("ERROR :: Page of a read-only file was dirtied");
+  } catch (const ReadOnlyFileException &e) {
+  }
+  // the refused dirty unpin still dropped the pin, so the frame can go
+  try {
+    mappedMgr.unPinPage(mapped, 1, false);
+    PRINT_ERROR("ERROR :: Refused dirty unpin kept the page pinned");
+  } catch (const PageNotPinnedException &e) {
+  }
+  mappedMgr.flushFile(mapped);
+  {
+    PinnedPage pinned = mappedMgr.readPage(mapped, 1);
+    try {
+      pinned.markDirty();
+      PRINT_ERROR("ERROR :: Page of a read-only file was dirtied");
+    } catch (const ReadOnlyFileException &e) {
+    }
+  }
+  sprintf(tmpbuf, "test.1 Page %u %7.1f", 1, 1.0f);
+  viaFile->updateRecord({1, 1}, tmpbuf);
+  mappedMgr.unPinPage(file1, 1, true);
+  // evicting every frame writes the dirty page back through file1
+  for (i = 2; i <= frames + 1; i++) {
+    mappedMgr.readPage(mapped, i, viaMapped);
+    mappedMgr.unPinPage(mapped, i, false);
+  }
+  mappedMgr.flushFile(file1);
+  mappedMgr.flushFile(mapped);
+
+  std::cout << "Test 23 passed"
+            << "\n";
+}
+
+void test24(File &file1) {
+  // Files of the bitmap format allocate, free and reuse pages without walking
+  // them, iterate in physical order and read their bitmaps back when reopened.
+  if (file1.format() != FileFormat::LINKED_LIST) {
+    PRINT_ERROR("ERROR :: New files should default to the linked-list format");
+  }
+  const std::string bitmapName = "test.bitmap";
+  try {
+    File::remove(bitmapName);
+  } catch (const FileNotFoundException &) {
+  }
+  const PageId pages = num / 2;
+  std::vector<PageId> pageNos;
+  {
+    File bitmap = File::create(bitmapName, FileFormat::BITMAP);
+    for (i = 0; i < pages; i++) {
+      Page page = bitmap.allocatePage();
+      sprintf(tmpbuf, "test.24 Page %u", page.page_number());
+      page.insertRecord(tmpbuf);
+      bitmap.writePage(page);
+      pageNos.push_back(page.page_number());
+    }
+    // every third page goes, the lowest of them is the first reused
+    for (std::size_t k = 0; k < pageNos.size(); k += 3) {
+      bitmap.deletePage(pageNos[k]);
+    }
+    try {
+      bitmap.deletePage(pageNos[0]);
+      PRINT_ERROR("ERROR :: Deleted a free page");
+    } catch (const InvalidPageException &e) {
+    }
+    try {
+      bitmap.readPage(pageNos[3]);
+      PRINT_ERROR("ERROR :: Read a deleted page");
+    } catch (const InvalidPageException &e) {
+    }
+    if (bitmap.allocatePage().page_number() != pageNos[0]) {
+      PRINT_ERROR("ERROR :: Lowest free page was not reused");
+    }
+  }
+
+  // reopened, the bitmap is read back from disk
+  File bitmap = File::open(bitmapName);
+  if (bitmap.format() != FileFormat::BITMAP) {
+    PRINT_ERROR("ERROR :: Format was not read back");
+  }
+  std::vector<PageId> scanned;
+  for (FileIterator iter = bitmap.begin(); iter != bitmap.end(); ++iter) {
+    const Page page = *iter;
+    sprintf(tmpbuf, "test.24 Page %u", page.page_number());
+    if (page.page_number() != 0 && page.page_number() != pageNos[0] &&
+        page.getRecord({page.page_number(), 1}) != tmpbuf) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    scanned.push_back(page.page_number());
+  }
+  std::vector<PageId> expected;
+  for (std::size_t k = 0; k < pageNos.size(); k++) {
+    if (k == 0 || k % 3 != 0) expected.push_back(pageNos[k]);
+  }
+  if (scanned != expected) {
+    PRINT_ERROR("ERROR :: Iterated " << scanned.size() << " pages, expected "
+                                     << expected.size()
+                                     << " in physical order");
+  }
+  if (bitmap.allocatePage().page_number() != pageNos[3]) {
+    PRINT_ERROR("ERROR :: Free page was not found after reopening");
+  }
+
+  // the buffer manager allocates through the bitmap too
+  {
+    BufMgr bitmapMgr(num / 10);
+    PageId pageNo;
+    bitmapMgr.allocPage(bitmap, pageNo, page);
+    if (pageNo != pageNos[6]) {
+      PRINT_ERROR("ERROR :: Buffer manager did not reuse a free page");
+    }
+    bitmapMgr.unPinPage(bitmap, pageNo, true);
+    bitmapMgr.flushFile(bitmap);
+  }
+  bitmap = File();
+  File::remove(bitmapName);
+
+  std::cout << "Test 24 passed"
+            << "\n";
+}
+
+void test25(File &file1) {
+  // The file header is kept in memory, shared by every File for the file, and
+  // only written back by sync(), a checkpoint or the last close.
+  auto onDisk = [](const std::string &name) {
+    FileHeader header = {};
+    std::ifstream stream(name, std::ios::binary);
+    stream.read(reinterpret_cast<char *>(&header), sizeof(header));
+    return header.num_pages;
+  };
+  File::syncAll();
+  if (onDisk(file1.filename()) <= num) {
+    PRINT_ERROR("ERROR :: syncAll() did not write the header back");
+  }
+
+  const std::string headerName = "test.header";
+  try {
+    File::remove(headerName);
+  } catch (const FileNotFoundException &) {
+  }
+  {
+    File file = File::create(headerName);
+    if (onDisk(headerName) != 1) {
+      PRINT_ERROR("ERROR :: New file has no header on disk");
+    }
+    File other = File::open(headerName);
+    const PageId pageNo = file.allocatePage().page_number();
+    if (other.readPage(pageNo).page_number() != pageNo) {
+      PRINT_ERROR("ERROR :: Header is not shared between File objects");
+    }
+    if (onDisk(headerName) != 1) {
+      PRINT_ERROR("ERROR :: Header was written back before sync()");
+    }
+    other.sync();
+    if (onDisk(headerName) != 2) {
+      PRINT_ERROR("ERROR :: sync() did not write the header back");
+    }
+
+    file.allocatePage();
+    {
+      BufMgr headerMgr(4);
+      headerMgr.checkpoint();
+    }
+    if (onDisk(headerName) != 3) {
+      PRINT_ERROR("ERROR :: Checkpoint did not write the header back");
+    }
+    file.allocatePage();
+    other = File();
+    if (onDisk(headerName) != 3) {
+      PRINT_ERROR("ERROR :: Header was written back before the last close");
+    }
+  }
+  if (onDisk(headerName) != 4) {
+    PRINT_ERROR("ERROR :: Header was not written back on close");
+  }
+  File::remove(headerName);
+
+  std::cout << "Test 25 passed"
+            << "\n";
+}
+
+void test26(File &file1) {
+  // Pages are written back without reading their headers: a copy read before
+  // the used list was relinked around it keeps the links made since, and a
+  // deleted page cannot be written, in either format.
+  const std::string listName = "test.list";
+  for (FileFormat format : {FileFormat::LINKED_LIST, FileFormat::BITMAP}) {
+    try {
+      File::remove(listName);
+    } catch (const FileNotFoundException &) {
+    }
+    File file = File::create(listName, format);
+    std::vector<PageId> pageNos;
+    for (i = 0; i < 5; i++) pageNos.push_back(file.allocatePage().page_number());
+    std::vector<Page> copies;
+    for (PageId pageNo : pageNos) copies.push_back(file.readPage(pageNo));
+
+    file.deletePage(pageNos[2]);
+    copies[1].insertRecord("test.26");
+    file.writePage(copies[1]);
+    try {
+      file.writePage(copies[2]);
+      PRINT_ERROR("ERROR :: Wrote a deleted page");
+    } catch (const InvalidPageException &e) {
+    }
+
+    std::vector<PageId> scanned;
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      scanned.push_back((*iter).page_number());
+    }
+    if (scanned != std::vector<PageId>({pageNos[0], pageNos[1], pageNos[3],
+                                        pageNos[4]})) {
+      PRINT_ERROR("ERROR :: Write-back broke the list of used pages");
+    }
+    if (file.readPage(pageNos[1]).getRecord({pageNos[1], 1}) != "test.26") {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  File::remove(listName);
+
+  // a run written back by the buffer manager keeps its links too
+  {
+    BufMgr listMgr(num / 10);
+    for (i = 1; i <= num / 10; i++) {
+      listMgr.readPage(file1, i, page);
+      listMgr.unPinPage(file1, i, true);
+    }
+    listMgr.flushFile(file1);
+  }
+  PageId scanned = 0;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    scanned++;
+  }
+  if (scanned < num) {
+    PRINT_ERROR("ERROR :: Write-back broke the list of used pages");
+  }
+
+  std::cout << "Test 26 passed"
+            << "\n";
+}
+
+void test27(File &file1) {
+  // sync() goes as far as the file's durability asks, which all File objects
+  // for the file share: no fdatasync() at all, one per call, or one for all
+  // the calls made together.
+  if (file1.durability() != Durability::NONE) {
+    PRINT_ERROR("ERROR :: Files should default to no durability");
+  }
+  const std::uint64_t before = file1.dataSyncs();
+  file1.sync();
+  if (file1.dataSyncs() != before) {
+    PRINT_ERROR("ERROR :: sync() called fdatasync() without durability");
+  }
+
+  const std::string syncName = "test.sync";
+  try {
+    File::remove(syncName);
+  } catch (const FileNotFoundException &) {
+  }
+  {
+    File file = File::create(syncName);
+    File other = File::open(syncName);
+    other.setDurability(Durability::FDATASYNC);
+    if (file.durability() != Durability::FDATASYNC) {
+      PRINT_ERROR("ERROR :: Durability is not shared between File objects");
+    }
+    file.allocatePage();
+    file.sync();
+    other.sync();
+    File::syncAll();
+    if (file.dataSyncs() != 3) {
+      PRINT_ERROR("ERROR :: Expected an fdatasync() per sync(), made "
+                  << file.dataSyncs());
+    }
+
+    const int threads = 4;
+    const int syncs = 10;
+    std::vector<PageId> pageNos;
+    for (int t = 0; t < threads; t++) {
+      pageNos.push_back(file.allocatePage().page_number());
+    }
+    file.setDurability(Durability::GROUP_SYNC);
+    const std::uint64_t grouped = file.dataSyncs();
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; t++) {
+      writers.emplace_back([&, t]() {
+        File own = file;
+        for (int k = 0; k < syncs; k++) {
+          Page copy = own.readPage(pageNos[t]);
+          copy.insertRecord("test.27");
+          own.writePage(copy);
+          own.sync();
+        }
+      });
+    }
+    for (std::thread &writer : writers) writer.join();
+    const std::uint64_t made = file.dataSyncs() - grouped;
+    if (made == 0 || made > (std::uint64_t)threads * syncs) {
+      PRINT_ERROR("ERROR :: Group sync made " << made << " fdatasync() calls");
+    }
+    for (PageId pageNo : pageNos) {
+      if (file.readPage(pageNo).getRecord({pageNo, syncs}) != "test.27") {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+    }
+
+    // a failed fdatasync() fails every call it covered, however many others
+    // fail before those calls wake up
+    std::atomic<int> calls(0);
+    std::atomic<bool> release(false);
+    file.setDataSync([&](int) {
+      if (calls++ == 0) {
+        while (!release) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+      }
+      errno = EIO;
+      return -1;
+    });
+    std::thread leader([&]() {
+      try {
+        file.sync();
+        PRINT_ERROR("ERROR :: A failed fdatasync() was not reported");
+      } catch (const FileIOException &e) {
+      }
+    });
+    while (calls == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    // these wait for the leader's group and sync together as the next one;
+    // whoever makes that fdatasync() goes straight on to fail more of them
+    // while the others may still be waking up
+    writers.clear();
+    for (int t = 0; t < threads; t++) {
+      writers.emplace_back([&]() {
+        File own = file;
+        for (int k = 0; k < syncs; k++) {
+          try {
+            own.sync();
+            PRINT_ERROR("ERROR :: A sync() call hid a failed fdatasync()");
+          } catch (const FileIOException &e) {
+          }
+        }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    release = true;
+    leader.join();
+    for (std::thread &writer : writers) writer.join();
+
+    // and no call that arrived while it was under way
+    calls = 0;
+    release = false;
+    file.setDataSync([&](int fd) {
+      if (calls++ > 0) return ::fdatasync(fd);
+      while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      errno = EIO;
+      return -1;
+    });
+    std::thread first([&]() {
+      try {
+        file.sync();
+        PRINT_ERROR("ERROR :: A failed fdatasync() was not reported");
+      } catch (const FileIOException &e) {
+      }
+    });
+    while (calls == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::thread second([&]() {
+      try {
+        File own = file;
+        own.sync();
+      } catch (const FileIOException &e) {
+        PRINT_ERROR("ERROR :: A waiting group was failed by the one before");
+      }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    release = true;
+    first.join();
+    second.join();
+    file.setDataSync(nullptr);
+  }
+  {
+    File file = File::open(syncName);
+    if (file.durability() != Durability::NONE) {
+      PRINT_ERROR("ERROR :: Durability outlived the last close");
+    }
+  }
+
+  // the last close syncs without the open lock, so files can be opened
+  // while its fdatasync() is under way
+  {
+    File last = File::open(syncName);
+    last.setDurability(Durability::FDATASYNC);
+    std::atomic<bool> syncing(false);
+    std::atomic<bool> release(false);
+    last.setDataSync([&](int fd) {
+      syncing = true;
+      while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return ::fdatasync(fd);
+    });
+    std::thread closer([&]() { last = File(); });
+    while (!syncing) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    std::atomic<bool> opened(false);
+    std::thread opener([&]() {
+      File reopened = File::open(file1.filename());
+      opened = true;
+    });
+    for (int wait = 0; wait < 1000 && !opened; wait++) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (!opened) {
+      PRINT_ERROR("ERROR :: A closing sync held up opening another file");
+    }
+    release = true;
+    closer.join();
+    opener.join();
+  }
+  if (File::isOpen(syncName)) {
+    PRINT_ERROR("ERROR :: File still open after its last close");
+  }
+  File::remove(syncName);
+
+  std::cout << "Test 27 passed"
+            << "\n";
+}
+
+void test28(File &file1) {
+  // New files are page-aligned; files of the packed layout are detected when
+  // opened and upgraded in place with their pages intact.
+  if (file1.layout() != FileLayout::PAGE_ALIGNED) {
+    PRINT_ERROR("ERROR :: New files should be page-aligned");
+  }
+  auto fileSize = [](const std::string &name) {
+    std::ifstream stream(name, std::ios::binary | std::ios::ate);
+    return static_cast<std::size_t>(stream.tellg());
+  };
+  if (fileSize(file1.filename()) % Page::SIZE != 0) {
+    PRINT_ERROR("ERROR :: Page-aligned file is not a whole number of pages");
+  }
+
+  const std::string packedName = "test.packed";
+  try {
+    File::remove(packedName);
+  } catch (const FileNotFoundException &) {
+  }
+  std::vector<PageId> pageNos;
+  {
+    File packed =
+        File::create(packedName, FileFormat::LINKED_LIST, FileLayout::PACKED);
+    for (i = 0; i < 20; i++) {
+      Page page = packed.allocatePage();
+      sprintf(tmpbuf, "test.28 Page %u", page.page_number());
+      page.insertRecord(tmpbuf);
+      packed.writePage(page);
+      pageNos.push_back(page.page_number());
+    }
+    packed.deletePage(pageNos[5]);
+    try {
+      File::upgradeLayout(packedName);
+      PRINT_ERROR("ERROR :: Upgraded an open file");
+    } catch (const FileOpenException &e) {
+    }
+  }
+  if (File::open(packedName).layout() != FileLayout::PACKED) {
+    PRINT_ERROR("ERROR :: Packed layout was not detected");
+  }
+
+  // a copy left by an upgrade that crashed is written over
+  const std::string upgradeName = packedName + ".upgrade";
+  std::ofstream(upgradeName, std::ios::binary) << "partial copy";
+  File::upgradeLayout(packedName);
+  File::upgradeLayout(packedName);  // nothing left to do
+  if (File::exists(upgradeName)) {
+    PRINT_ERROR("ERROR :: Upgrade left its copy behind");
+  }
+  if (fileSize(packedName) % Page::SIZE != 0) {
+    PRINT_ERROR("ERROR :: Upgraded file is not a whole number of pages");
+  }
+  {
+    File upgraded = File::open(packedName);
+    if (upgraded.layout() != FileLayout::PAGE_ALIGNED) {
+      PRINT_ERROR("ERROR :: Page-aligned layout was not detected");
+    }
+    std::size_t scanned = 0;
+    for (FileIterator iter = upgraded.begin(); iter != upgraded.end(); ++iter) {
+      const Page page = *iter;
+      sprintf(tmpbuf, "test.28 Page %u", page.page_number());
+      if (page.getRecord({page.page_number(), 1}) != tmpbuf) {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+      scanned++;
+    }
+    if (scanned != pageNos.size() - 1) {
+      PRINT_ERROR("ERROR :: Upgraded file has " << scanned << " pages");
+    }
+    // the freed page is reused from the free list, as before the upgrade
+    if (upgraded.allocatePage().page_number() != pageNos[5]) {
+      PRINT_ERROR("ERROR :: Free list was lost in the upgrade");
+    }
+  }
+  {
+    File mapped = File::openReadOnly(packedName);
+    const char *view =
+        reinterpret_cast<const char *>(&mapped.viewPage(pageNos[0]));
+    if (reinterpret_cast<std::uintptr_t>(view) % 4096 != 0) {
+      PRINT_ERROR("ERROR :: Mapped page is not aligned");
+    }
+  }
+
+  // a page-aligned file cut short is refused rather than read as packed
+  const std::size_t alignedSize = fileSize(packedName);
+  if (::truncate(packedName.c_str(), alignedSize - 100) != 0) {
+    PRINT_ERROR("ERROR :: Could not truncate " << packedName);
+  }
+  try {
+    File::open(packedName);
+    PRINT_ERROR("ERROR :: Opened a page-aligned file of a partial page");
+  } catch (const FileNotFoundException &e) {
+    PRINT_ERROR("ERROR :: Opened a page-aligned file of a partial page");
+  } catch (const BadgerDbException &e) {
+  }
+  if (::truncate(packedName.c_str(), alignedSize) != 0) {
+    PRINT_ERROR("ERROR :: Could not extend " << packedName);
+  }
+
+  // a layout version from the future is refused
+  {
+    std::fstream stream(packedName,
+                        std::ios::in | std::ios::out | std::ios::binary);
+    const std::uint32_t version = 99;
+    stream.seekp(sizeof(FileHeader) + 8);
+    stream.write(reinterpret_cast<const char *>(&version), sizeof(version));
+  }
+  try {
+    File::open(packedName);
+    PRINT_ERROR("ERROR :: Opened a file of an unknown layout");
+  } catch (const FileNotFoundException &e) {
+    PRINT_ERROR("ERROR :: Opened a file of an unknown layout");
+  } catch (const BadgerDbException &e) {
+  }
+  File::remove(packedName);
+
+  std::cout << "Test 28 passed"
+            << "\n";
+}
@@ -103,6 +103,10 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * A Page is exactly SIZE bytes, header followed by data, with no pointers, so
+ * it has the same layout in memory as on disk and buffer pool frames can be
+ * laid out back to back in one block of memory.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
@@ -331,8 +335,7 @@ class Page {
    * Data stored on the page.  Includes bookkeeping information about slots as
    * well as actual content.
    */
-
-  std::string data_;
+  char data_[DATA_SIZE];
 
   friend class File;
   friend class PageIterator;
@@ -343,5 +346,7 @@ class Page {
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0, "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must hold exactly its header and data.");
 
 }  // namespace badgerdb
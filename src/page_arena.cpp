@@ -0,0 +1,100 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "page_arena.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <new>
+
+namespace badgerdb {
+
+PageArena::PageArena(std::uint32_t num_pages, bool huge_pages,
+                     std::uint32_t capacity)
+    : base_(MAP_FAILED),
+      bytes_(static_cast<std::size_t>(std::max(num_pages, capacity)) *
+             Page::SIZE),
+      pages_(NULL),
+      num_pages_(num_pages),
+      capacity_(std::max(num_pages, capacity)),
+      backing_(Backing::NORMAL) {
+  if (bytes_ == 0) {
+    return;
+  }
+  // Huge pages only pay off once the pool spans at least one of them.
+  huge_pages = huge_pages && bytes_ >= HUGE_PAGE_SIZE;
+  // MAP_HUGETLB takes the whole mapping from the huge page pool up front,
+  // which must not happen to room the arena may never grow into
+  if (huge_pages && capacity_ == num_pages_) {
+    const std::size_t rounded =
+        (bytes_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    base_ = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (base_ != MAP_FAILED) {
+      bytes_ = rounded;
+      backing_ = Backing::HUGETLB;
+    }
+  }
+  if (base_ == MAP_FAILED) {
+    // room to grow is address space only until it is used
+    const int reserve = capacity_ > num_pages_ ? MAP_NORESERVE : 0;
+    base_ = mmap(NULL, bytes_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | reserve, -1, 0);
+    if (base_ == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    if (huge_pages && madvise(base_, bytes_, MADV_HUGEPAGE) == 0) {
+      backing_ = Backing::TRANSPARENT_HUGE;
+    }
+  }
+
+  pages_ = static_cast<Page *>(base_);
+  for (std::uint32_t i = 0; i < num_pages_; i++) {
+    new (&pages_[i]) Page();
+  }
+}
+
+PageArena::~PageArena() {
+  // Pages own no other memory, so there is nothing to destroy first.
+  if (base_ != MAP_FAILED) {
+    munmap(base_, bytes_);
+  }
+}
+
+void PageArena::resize(std::uint32_t num_pages) {
+  if (num_pages > capacity_) {
+    num_pages = capacity_;
+  }
+  for (std::uint32_t i = num_pages_; i < num_pages; i++) {
+    new (&pages_[i]) Page();
+  }
+  // Pages are 4 KB aligned, so the memory past the new end can be given
+  // back as it is.  Huge pages reserved with MAP_HUGETLB stay with the
+  // mapping either way.
+  if (num_pages < num_pages_ && backing_ != Backing::HUGETLB) {
+    madvise(&pages_[num_pages],
+            static_cast<std::size_t>(num_pages_ - num_pages) * Page::SIZE,
+            MADV_DONTNEED);
+  }
+  num_pages_ = num_pages;
+}
+
+const char *PageArena::backingName(Backing backing) {
+  switch (backing) {
+    case Backing::HUGETLB:
+      return "hugetlb";
+    case Backing::TRANSPARENT_HUGE:
+      return "thp";
+    case Backing::NORMAL:
+      break;
+  }
+  return "4k";
+}
+
+}  // namespace badgerdb
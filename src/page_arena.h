@@ -0,0 +1,133 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+ * @brief One contiguous, page-aligned block of memory holding an array of
+ * Pages.
+ *
+ * Used for the frames of the buffer pool.  The block is mapped with huge
+ * pages if it is large enough and the system has some reserved (MAP_HUGETLB);
+ * otherwise transparent huge pages are requested for it with madvise, and if
+ * the kernel grants neither it is made of ordinary pages.  Either way frames
+ * are Page::SIZE apart and 4 KB aligned.
+ *
+ * An arena can be created with room to grow: address space is reserved for
+ * its capacity up front, so pages never move, but memory is only committed
+ * as pages come into use.  MAP_HUGETLB commits the whole mapping from the
+ * huge page pool at once, so such an arena only asks for transparent huge
+ * pages.
+ */
+class PageArena {
+ public:
+  /**
+   * Where the memory of an arena comes from.
+   */
+  enum class Backing { HUGETLB, TRANSPARENT_HUGE, NORMAL };
+
+  /**
+   * Maps an arena and constructs its pages.
+   *
+   * @param num_pages   Number of pages in the arena.
+   * @param huge_pages  False to use ordinary pages only.
+   * @param capacity    Number of pages the arena can grow to; less than
+   *                    num_pages means num_pages.
+   * @throws std::bad_alloc If the memory cannot be mapped.
+   */
+  PageArena(std::uint32_t num_pages, bool huge_pages = true,
+            std::uint32_t capacity = 0);
+
+  PageArena(const PageArena &) = delete;
+  PageArena &operator=(const PageArena &) = delete;
+
+  /**
+   * Unmaps the arena.
+   */
+  ~PageArena();
+
+  /**
+   * Returns the first of the arena's pages.
+   */
+  Page *pages() const { return pages_; }
+
+  /**
+   * Returns the number of pages in the arena.
+   */
+  std::uint32_t size() const { return num_pages_; }
+
+  /**
+   * Returns the number of pages the arena can grow to.
+   */
+  std::uint32_t capacity() const { return capacity_; }
+
+  /**
+   * Changes the number of pages in the arena, up to its capacity.  New pages
+   * are constructed; the memory of pages dropped off the end is given back
+   * to the system.  Pages that stay keep their address and contents.
+   *
+   * @param num_pages   New number of pages, at most capacity().
+   */
+  void resize(std::uint32_t num_pages);
+
+  /**
+   * Returns where the arena's memory comes from.
+   */
+  Backing backing() const { return backing_; }
+
+  /**
+   * Returns a short name for a backing, for statistics output.
+   */
+  static const char *backingName(Backing backing);
+
+  /**
+   * Size of a huge page, the granularity the arena is rounded up to when
+   * huge pages are used.
+   */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+ private:
+  /**
+   * Start of the mapping.
+   */
+  void *base_;
+
+  /**
+   * Length of the mapping in bytes.
+   */
+  std::size_t bytes_;
+
+  /**
+   * The pages, at the start of the mapping.
+   */
+  Page *pages_;
+
+  /**
+   * Number of pages in the arena.
+   */
+  std::uint32_t num_pages_;
+
+  /**
+   * Number of pages the mapping has room for.
+   */
+  std::uint32_t capacity_;
+
+  /**
+   * Where the mapping came from.
+   */
+  Backing backing_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,60 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "pinned_page.h"
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+PinnedPage::PinnedPage(BufMgr *buf_mgr, FrameId frame, PageId page_number)
+    : buf_mgr_(buf_mgr),
+      page_(&buf_mgr->bufPool[frame]),
+      frame_(frame),
+      page_number_(page_number),
+      dirty_(false) {}
+
+PinnedPage::PinnedPage(PinnedPage &&other) noexcept
+    : buf_mgr_(other.buf_mgr_),
+      page_(other.page_),
+      frame_(other.frame_),
+      page_number_(other.page_number_),
+      dirty_(other.dirty_) {
+  other.buf_mgr_ = NULL;
+  other.page_ = NULL;
+}
+
+PinnedPage &PinnedPage::operator=(PinnedPage &&other) noexcept {
+  if (this != &other) {
+    release();
+    buf_mgr_ = other.buf_mgr_;
+    page_ = other.page_;
+    frame_ = other.frame_;
+    page_number_ = other.page_number_;
+    dirty_ = other.dirty_;
+    other.buf_mgr_ = NULL;
+    other.page_ = NULL;
+  }
+  return *this;
+}
+
+void PinnedPage::markDirty() {
+  if (buf_mgr_ != NULL) buf_mgr_->checkDirtiable(frame_);
+  dirty_ = true;
+}
+
+void PinnedPage::release() noexcept {
+  if (buf_mgr_ != NULL) {
+    buf_mgr_->unpinFrame(frame_, dirty_);
+    buf_mgr_ = NULL;
+    page_ = NULL;
+    dirty_ = false;
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,139 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief Pin on a page in the buffer pool, dropped when the handle goes away.
+ *
+ * Returned by BufMgr::readPage(file, pageNo) and BufMgr::allocPage(file) in
+ * place of a Page pointer that must be matched by a BufMgr::unPinPage() call.
+ * The handle remembers the frame holding the page, so unpinning needs no hash
+ * table lookup, and a pin is not leaked when an exception unwinds past it.
+ * Handles can be moved but not copied; an empty handle holds no pin.
+ */
+class PinnedPage {
+ public:
+  /**
+   * Constructs an empty handle.
+   */
+  PinnedPage()
+      : buf_mgr_(NULL),
+        page_(NULL),
+        frame_(0),
+        page_number_(Page::INVALID_NUMBER),
+        dirty_(false) {}
+
+  /**
+   * Takes over the pin held by another handle, which is left empty.
+   *
+   * @param other   Handle to move from.
+   */
+  PinnedPage(PinnedPage &&other) noexcept;
+
+  /**
+   * Drops the pin held by this handle, then takes over the one held by
+   * another handle, which is left empty.
+   *
+   * @param other   Handle to move from.
+   */
+  PinnedPage &operator=(PinnedPage &&other) noexcept;
+
+  PinnedPage(const PinnedPage &) = delete;
+  PinnedPage &operator=(const PinnedPage &) = delete;
+
+  /**
+   * Unpins the page, marking it dirty if markDirty() was called.
+   */
+  ~PinnedPage() { release(); }
+
+  /**
+   * Unpins the page now, leaving the handle empty.  Does nothing if the
+   * handle is already empty.
+   */
+  void release() noexcept;
+
+  /**
+   * Records that the page was modified, so that it is marked dirty when it
+   * is unpinned.
+   *
+   * @throws  ReadOnlyFileException  If the page was read through a file
+   * opened with File::openReadOnly().
+   */
+  void markDirty();
+
+  /**
+   * Returns true if markDirty() has been called.
+   */
+  bool isDirty() const { return dirty_; }
+
+  /**
+   * Returns the number of the pinned page.
+   */
+  PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns the pinned page, or null if the handle is empty.
+   */
+  Page *get() const { return page_; }
+
+  Page *operator->() const { return page_; }
+
+  Page &operator*() const { return *page_; }
+
+  /**
+   * Returns true if the handle holds a pin.
+   */
+  explicit operator bool() const { return buf_mgr_ != NULL; }
+
+ private:
+  friend class BufMgr;
+
+  /**
+   * Wraps a pin the buffer manager has already taken.
+   *
+   * @param buf_mgr       Buffer manager holding the page.
+   * @param frame         Frame holding the page.
+   * @param page_number   Number of the page.
+   */
+  PinnedPage(BufMgr *buf_mgr, FrameId frame, PageId page_number);
+
+  /**
+   * Buffer manager holding the page, or null if the handle is empty.
+   */
+  BufMgr *buf_mgr_;
+
+  /**
+   * The pinned page.
+   */
+  Page *page_;
+
+  /**
+   * Frame holding the pinned page.
+   */
+  FrameId frame_;
+
+  /**
+   * Number of the pinned page.
+   */
+  PageId page_number_;
+
+  /**
+   * True if the page is to be marked dirty when it is unpinned.
+   */
+  bool dirty_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,176 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "replacement_policy.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Intrusive doubly linked list of frame numbers.
+ *
+ * Each frame is in the list at most once.  The front is the most recently
+ * inserted end; policies take victims from the back.  Links are stored in
+ * arrays indexed by frame, so no operation allocates.
+ */
+class FrameList {
+ public:
+  /**
+   * Marks the end of the list.
+   */
+  static constexpr FrameId NONE = UINT32_MAX;
+
+  /**
+   * Constructs an empty list for frames [0, numFrames).
+   */
+  explicit FrameList(std::uint32_t numFrames)
+      : prev(numFrames, NONE),
+        next(numFrames, NONE),
+        member(numFrames, false),
+        head(NONE),
+        tail(NONE),
+        count(0) {}
+
+  bool contains(FrameId frame) const { return member[frame]; }
+  std::uint32_t size() const { return count; }
+
+  /**
+   * First (most recently inserted) frame, or NONE.
+   */
+  FrameId front() const { return head; }
+
+  /**
+   * Last (least recently inserted) frame, or NONE.
+   */
+  FrameId back() const { return tail; }
+
+  /**
+   * Appends the frames of the list to frames, front to back.
+   */
+  void appendTo(std::vector<FrameId>& frames) const {
+    for (FrameId f = head; f != NONE; f = next[f]) frames.push_back(f);
+  }
+
+  void pushFront(FrameId frame) {
+    prev[frame] = NONE;
+    next[frame] = head;
+    if (head != NONE) prev[head] = frame;
+    head = frame;
+    if (tail == NONE) tail = frame;
+    member[frame] = true;
+    ++count;
+  }
+
+  void pushBack(FrameId frame) {
+    next[frame] = NONE;
+    prev[frame] = tail;
+    if (tail != NONE) next[tail] = frame;
+    tail = frame;
+    if (head == NONE) head = frame;
+    member[frame] = true;
+    ++count;
+  }
+
+  void remove(FrameId frame) {
+    if (!member[frame]) return;
+    if (prev[frame] != NONE)
+      next[prev[frame]] = next[frame];
+    else
+      head = next[frame];
+    if (next[frame] != NONE)
+      prev[next[frame]] = prev[frame];
+    else
+      tail = prev[frame];
+    member[frame] = false;
+    --count;
+  }
+
+  void moveToFront(FrameId frame) {
+    remove(frame);
+    pushFront(frame);
+  }
+
+  /**
+   * Offers the frames to tryClaim from the back to the front and returns the
+   * first one it accepts.
+   *
+   * @param tryClaim  Claim callback
+   * @param frame     Claimed frame
+   * @return  False if no frame was accepted.
+   */
+  bool claimFromBack(const ReplacementPolicy::ClaimFn& tryClaim,
+                     FrameId& frame) const {
+    for (FrameId f = tail; f != NONE; f = prev[f]) {
+      if (tryClaim(f)) {
+        frame = f;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::vector<FrameId> prev;
+  std::vector<FrameId> next;
+  std::vector<bool> member;
+  FrameId head;
+  FrameId tail;
+  std::uint32_t count;
+};
+
+/**
+ * @brief LRU-ordered set of page keys, used for ghost (non-resident) history.
+ */
+class KeyList {
+ public:
+  bool contains(std::uint64_t key) const {
+    return index.find(key) != index.end();
+  }
+  std::size_t size() const { return keys.size(); }
+
+  /**
+   * Inserts key at the most recent end, moving it there if present.
+   */
+  void pushFront(std::uint64_t key) {
+    remove(key);
+    keys.push_front(key);
+    index[key] = keys.begin();
+  }
+
+  void remove(std::uint64_t key) {
+    auto it = index.find(key);
+    if (it == index.end()) return;
+    keys.erase(it->second);
+    index.erase(it);
+  }
+
+  /**
+   * Drops the least recent key.  The list must not be empty.
+   *
+   * @return  The dropped key.
+   */
+  std::uint64_t popBack() {
+    const std::uint64_t key = keys.back();
+    index.erase(key);
+    keys.pop_back();
+    return key;
+  }
+
+ private:
+  std::list<std::uint64_t> keys;
+  std::unordered_map<std::uint64_t, std::list<std::uint64_t>::iterator> index;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,45 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include <algorithm>
+
+#include "arc_policy.h"
+#include "clock_policy.h"
+#include "clock_pro_policy.h"
+#include "lru_k_policy.h"
+#include "two_q_policy.h"
+
+namespace badgerdb {
+
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::create(
+    ReplacementPolicyType type, std::uint32_t numFrames,
+    std::uint32_t capacity) {
+  capacity = std::max(capacity, numFrames);
+  switch (type) {
+    case ReplacementPolicyType::LRU_K:
+      return std::unique_ptr<ReplacementPolicy>(
+          new LruKPolicy(numFrames, capacity));
+    case ReplacementPolicyType::TWO_Q:
+      return std::unique_ptr<ReplacementPolicy>(
+          new TwoQPolicy(numFrames, capacity));
+    case ReplacementPolicyType::ARC:
+      return std::unique_ptr<ReplacementPolicy>(
+          new ArcPolicy(numFrames, capacity));
+    case ReplacementPolicyType::CLOCK_PRO:
+      return std::unique_ptr<ReplacementPolicy>(
+          new ClockProPolicy(numFrames, capacity));
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return std::unique_ptr<ReplacementPolicy>(
+          new ClockPolicy(numFrames, capacity));
+  }
+}
+
+}  // namespace badgerdb
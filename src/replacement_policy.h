@@ -0,0 +1,158 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Page replacement policies BufMgr can be constructed with.
+ */
+enum class ReplacementPolicyType {
+  /**
+   * Single reference bit clock (second chance)
+   */
+  CLOCK,
+
+  /**
+   * LRU-2: evicts the page whose second most recent reference is oldest
+   */
+  LRU_K,
+
+  /**
+   * Full 2Q with a FIFO probation queue, a ghost queue and a main LRU
+   */
+  TWO_Q,
+
+  /**
+   * Adaptive Replacement Cache
+   */
+  ARC,
+
+  /**
+   * CLOCK-Pro: clock with hot/cold pages and non-resident test periods
+   */
+  CLOCK_PRO
+};
+
+/**
+ * @brief Interface BufMgr delegates victim selection to.
+ *
+ * Pages are identified by the packed key of BufHashTbl::key().  BufMgr
+ * reports every hit, every page installed in a frame and every page leaving a
+ * frame; a policy starts out with all frames free.
+ *
+ * pickVictim() proposes frames in the order the policy would like to evict
+ * them and hands each to a claim callback supplied by BufMgr, which try-locks
+ * the frame and succeeds only if it is unpinned.  The callback never blocks
+ * and never calls back into the policy, so a policy may hold its own latch
+ * while calling it.  A claimed frame stays where it is in the policy's
+ * bookkeeping until BufMgr reports the removal of its page.
+ *
+ * The pool can be resized between 1 frame and the capacity the policy was
+ * created with.  Frames numbered from the current size up are retired: they
+ * are never free for the policy, but may still hold pages it is tracking
+ * until BufMgr reports their removal, and the claim callback refuses them.
+ *
+ * All methods may be called concurrently.  recordAccess() is on the buffer
+ * hit path; CLOCK and CLOCK_PRO only set an atomic reference bit there and
+ * LRU_K shifts the frame's atomic reference times, while the list-based
+ * policies take their latch.
+ */
+class ReplacementPolicy {
+ public:
+  /**
+   * Callback that tries to claim a frame for eviction.
+   */
+  typedef std::function<bool(FrameId)> ClaimFn;
+
+  /**
+   * Creates a policy of the given type managing numFrames frames.
+   *
+   * @param type       Policy to create
+   * @param numFrames  Number of frames in the buffer pool
+   * @param capacity   Number of frames the pool can grow to; less than
+   * numFrames means numFrames
+   * @return  The policy.
+   */
+  static std::unique_ptr<ReplacementPolicy> create(ReplacementPolicyType type,
+                                                   std::uint32_t numFrames,
+                                                   std::uint32_t capacity = 0);
+
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Returns the name of the policy, for statistics output.
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Called on every hit on the page in frame.
+   *
+   * @param frame   Frame that was hit
+   */
+  virtual void recordAccess(FrameId frame) = 0;
+
+  /**
+   * Called after the page identified by key was installed in a free frame.
+   *
+   * @param frame   Frame now holding the page
+   * @param key     Key of the page
+   */
+  virtual void recordInsert(FrameId frame, std::uint64_t key) = 0;
+
+  /**
+   * Called when the page identified by key leaves frame, which becomes free.
+   *
+   * @param frame   Frame that held the page
+   * @param key     Key of the page
+   * @param evicted True if the page was chosen by pickVictim(); false if it
+   * was flushed or disposed of explicitly
+   */
+  virtual void recordRemove(FrameId frame, std::uint64_t key,
+                            bool evicted) = 0;
+
+  /**
+   * Chooses a frame to reuse, preferring free frames.
+   *
+   * @param key       Key of the page the frame is needed for, or 0 if the
+   * page is new to the file
+   * @param tryClaim  Claim callback; the first frame it accepts is returned
+   * @param frame     Claimed frame
+   * @return  False if no frame could be claimed.
+   */
+  virtual bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                          FrameId& frame) = 0;
+
+  /**
+   * Changes the number of frames in the pool.  Frames added must be empty;
+   * they become free.  Frames retired stop being free straight away, and
+   * those holding pages are dropped as BufMgr reports their removal.
+   *
+   * @param numFrames   New number of frames, between 1 and the capacity
+   */
+  virtual void resize(std::uint32_t numFrames) = 0;
+
+  /**
+   * Appends frames to the given vector hottest first, by the policy's own
+   * idea of which pages are most worth keeping.  Frames without a page may
+   * be listed too; callers skip them.
+   *
+   * @param frames  Vector to append to
+   */
+  virtual void rankFrames(std::vector<FrameId>& frames) = 0;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,94 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "thread_pool_io_engine.h"
+
+#include <utility>
+
+namespace badgerdb {
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(const std::uint32_t queue_depth)
+    : queue_depth_(queue_depth == 0 ? 1 : queue_depth), stop_(false) {}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+  submit();
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    stop_ = true;
+  }
+  wakeup_.notify_all();
+  for (std::thread &worker : workers_) worker.join();
+}
+
+void ThreadPoolIoEngine::read(const File &file, const PageId first,
+                              const std::uint32_t count, Page *const *pages,
+                              Callback done) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  queued_.push_back(Request{false, file.handle(), first,
+                            std::vector<Page *>(pages, pages + count),
+                            std::move(done)});
+}
+
+void ThreadPoolIoEngine::write(const File &file, const PageId first,
+                               const std::uint32_t count,
+                               const Page *const *pages, Callback done) {
+  // the worker only reads through the pointers
+  std::vector<Page *> mutable_pages;
+  for (std::uint32_t i = 0; i < count; i++) {
+    mutable_pages.push_back(const_cast<Page *>(pages[i]));
+  }
+  std::lock_guard<std::mutex> guard(mutex_);
+  queued_.push_back(Request{true, file.handle(), first,
+                            std::move(mutable_pages), std::move(done)});
+}
+
+void ThreadPoolIoEngine::submit() {
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (queued_.empty()) return;
+    for (Request &request : queued_) ready_.push_back(std::move(request));
+    queued_.clear();
+    if (workers_.empty()) {
+      for (std::uint32_t i = 0; i < queue_depth_; i++) {
+        workers_.emplace_back(&ThreadPoolIoEngine::workerLoop, this);
+      }
+    }
+  }
+  wakeup_.notify_all();
+}
+
+void ThreadPoolIoEngine::workerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wakeup_.wait(lock, [this] { return stop_ || !ready_.empty(); });
+    if (ready_.empty()) return;
+    {
+      Request request = std::move(ready_.front());
+      ready_.pop_front();
+      lock.unlock();
+
+      std::exception_ptr error;
+      try {
+        if (request.write) {
+          request.file->writePages(request.first, request.pages.size(),
+                                  request.pages.data());
+        } else {
+          request.file->readPages(request.first, request.pages.size(),
+                                 request.pages.data());
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+      request.done(error);
+      // the request, and its File, go away before the latch is retaken
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace badgerdb
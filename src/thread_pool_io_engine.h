@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_engine.h"
+
+namespace badgerdb {
+
+/**
+ * @brief IoEngine that runs each request as a blocking File::readPages() or
+ * File::writePages() call on one of queue_depth worker threads.
+ *
+ * The workers are started by the first submit(), so an engine that is never
+ * used costs no threads.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * @param queue_depth  Number of worker threads, hence of requests in
+   * flight at once
+   */
+  explicit ThreadPoolIoEngine(std::uint32_t queue_depth);
+
+  /**
+   * Runs every queued request and stops the workers.
+   */
+  ~ThreadPoolIoEngine() override;
+
+  const char *name() const override { return "threads"; }
+  std::uint32_t queueDepth() const override { return queue_depth_; }
+  void read(const File &file, PageId first, std::uint32_t count,
+            Page *const *pages, Callback done) override;
+  void write(const File &file, PageId first, std::uint32_t count,
+             const Page *const *pages, Callback done) override;
+  void submit() override;
+
+ private:
+  /**
+   * @brief A queued read or write.
+   */
+  struct Request {
+    bool write;
+    std::shared_ptr<File> file;
+    PageId first;
+    std::vector<Page *> pages;
+    Callback done;
+  };
+
+  /**
+   * Body of a worker thread
+   */
+  void workerLoop();
+
+  /**
+   * Number of worker threads
+   */
+  const std::uint32_t queue_depth_;
+
+  /**
+   * Protects queued_, ready_, workers_ and stop_
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when requests are submitted or the engine stops
+   */
+  std::condition_variable wakeup_;
+
+  /**
+   * Requests not yet submitted
+   */
+  std::vector<Request> queued_;
+
+  /**
+   * Submitted requests no worker has taken yet
+   */
+  std::deque<Request> ready_;
+
+  /**
+   * The workers, once started
+   */
+  std::vector<std::thread> workers_;
+
+  /**
+   * Tells the workers to exit once ready_ is empty
+   */
+  bool stop_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,46 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Upgrades files of the packed layout to the page-aligned layout with
+ * File::upgradeLayout().  Files that are page-aligned already are left
+ * alone.  The files must not be in use.  Each file is rewritten next to the
+ * old one and renamed over it, so a crash during an upgrade leaves the old
+ * file as it was.
+ *
+ * Usage: upgrade_layout file...
+ */
+
+#include <iostream>
+
+#include "exceptions/badgerdb_exception.h"
+#include "file.h"
+
+using namespace badgerdb;
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " file...\n";
+    return 2;
+  }
+  int failed = 0;
+  for (int i = 1; i < argc; i++) {
+    const std::string filename = argv[i];
+    try {
+      const bool packed =
+          File::open(filename).layout() == FileLayout::PACKED;
+      File::upgradeLayout(filename);
+      std::cout << filename
+                << (packed ? ": upgraded\n" : ": already page-aligned\n");
+    } catch (const BadgerDbException &e) {
+      std::cerr << filename << ": " << e.message() << "\n";
+      failed++;
+    }
+  }
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,86 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "two_q_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+TwoQPolicy::TwoQPolicy(std::uint32_t numFrames, std::uint32_t maxFrames)
+    : numFrames(numFrames),
+      kin(std::max<std::uint32_t>(1, numFrames / 4)),
+      kout(std::max<std::uint32_t>(1, numFrames / 2)),
+      a1in(maxFrames),
+      am(maxFrames),
+      freeFrames(maxFrames) {
+  for (FrameId i = 0; i < numFrames; i++) freeFrames.pushBack(i);
+}
+
+void TwoQPolicy::recordAccess(FrameId frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  // hits in A1in are deliberately ignored: they are usually correlated
+  // references shortly after the first one
+  if (am.contains(frame)) am.moveToFront(frame);
+}
+
+void TwoQPolicy::recordInsert(FrameId frame, std::uint64_t key) {
+  std::lock_guard<std::mutex> guard(latch);
+  freeFrames.remove(frame);
+  if (a1out.contains(key)) {
+    a1out.remove(key);
+    am.pushFront(frame);
+  } else {
+    a1in.pushFront(frame);
+  }
+}
+
+void TwoQPolicy::recordRemove(FrameId frame, std::uint64_t key,
+                              bool evicted) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (a1in.contains(frame)) {
+    a1in.remove(frame);
+    if (evicted) {
+      a1out.pushFront(key);
+      if (a1out.size() > kout) a1out.popBack();
+    }
+  } else {
+    am.remove(frame);
+  }
+  if (frame < numFrames) freeFrames.pushBack(frame);
+}
+
+bool TwoQPolicy::pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                            FrameId& frame) {
+  std::lock_guard<std::mutex> guard(latch);
+  if (freeFrames.claimFromBack(tryClaim, frame)) return true;
+  if (a1in.size() > kin) {
+    return a1in.claimFromBack(tryClaim, frame) ||
+           am.claimFromBack(tryClaim, frame);
+  }
+  return am.claimFromBack(tryClaim, frame) ||
+         a1in.claimFromBack(tryClaim, frame);
+}
+
+void TwoQPolicy::resize(std::uint32_t newFrames) {
+  std::lock_guard<std::mutex> guard(latch);
+  for (FrameId i = numFrames; i < newFrames; i++) freeFrames.pushBack(i);
+  for (FrameId i = newFrames; i < numFrames; i++) freeFrames.remove(i);
+  numFrames = newFrames;
+  kin = std::max<std::uint32_t>(1, numFrames / 4);
+  kout = std::max<std::uint32_t>(1, numFrames / 2);
+  while (a1out.size() > kout) a1out.popBack();
+}
+
+void TwoQPolicy::rankFrames(std::vector<FrameId>& frames) {
+  std::lock_guard<std::mutex> guard(latch);
+  am.appendTo(frames);
+  a1in.appendTo(frames);
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,64 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+
+#include "policy_lists.h"
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Full 2Q (Johnson and Shasha).
+ *
+ * A page seen for the first time enters the A1in FIFO.  Pages evicted from
+ * A1in are remembered in the A1out ghost queue; a miss on a remembered page
+ * puts it into the Am LRU list, where repeatedly used pages live.  Victims
+ * come from A1in while it is over its share of the pool, otherwise from Am,
+ * so a scan only ever cycles through A1in.
+ */
+class TwoQPolicy : public ReplacementPolicy {
+ public:
+  TwoQPolicy(std::uint32_t numFrames, std::uint32_t maxFrames);
+
+  const char* name() const override { return "2Q"; }
+  void recordAccess(FrameId frame) override;
+  void recordInsert(FrameId frame, std::uint64_t key) override;
+  void recordRemove(FrameId frame, std::uint64_t key, bool evicted) override;
+  bool pickVictim(std::uint64_t key, const ClaimFn& tryClaim,
+                  FrameId& frame) override;
+  void resize(std::uint32_t newFrames) override;
+  void rankFrames(std::vector<FrameId>& frames) override;
+
+ private:
+  std::mutex latch;
+
+  /**
+   * Number of frames in use; frames from here up are retired.
+   */
+  std::uint32_t numFrames;
+
+  /**
+   * Target size of A1in (a quarter of the pool)
+   */
+  std::uint32_t kin;
+
+  /**
+   * Maximum size of A1out (half the pool)
+   */
+  std::uint32_t kout;
+
+  FrameList a1in;
+  FrameList am;
+  FrameList freeFrames;
+  KeyList a1out;
+};
+
+}  // namespace badgerdb
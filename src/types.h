@@ -12,6 +12,12 @@
 
 namespace badgerdb {
 
+/**
+ * @brief Identifier for an open file.  Stable for the lifetime of the process;
+ * 0 is never assigned to a file.
+ */
+typedef std::uint32_t FileId;
+
 /**
  * @brief Identifier for a page in a file.
  */
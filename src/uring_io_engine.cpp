@@ -0,0 +1,304 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "uring_io_engine.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+namespace {
+
+int ioUringSetup(const std::uint32_t entries, io_uring_params *params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(const int fd, const unsigned to_submit,
+                 const unsigned min_complete, const unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+BadgerDbException uringError(const std::string &what) {
+  return BadgerDbException("io_uring " + what + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+UringIoEngine::UringIoEngine(const std::uint32_t queue_depth)
+    : ring_fd_(-1),
+      depth_(0),
+      sq_ring_(MAP_FAILED),
+      sq_ring_bytes_(0),
+      cq_ring_(MAP_FAILED),
+      cq_ring_bytes_(0),
+      sqes_(static_cast<io_uring_sqe *>(MAP_FAILED)),
+      in_flight_(0),
+      unsubmitted_(0) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = ioUringSetup(queue_depth == 0 ? 1 : queue_depth, &params);
+  if (ring_fd_ < 0) throw uringError("setup");
+  depth_ = params.sq_entries;
+
+  sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_bytes_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+  }
+  sq_ring_ = ::mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ != MAP_FAILED) {
+    cq_ring_ = single_mmap ? sq_ring_
+                           : ::mmap(nullptr, cq_ring_bytes_,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                    IORING_OFF_CQ_RING);
+  }
+  if (cq_ring_ != MAP_FAILED) {
+    sqes_ = static_cast<io_uring_sqe *>(
+        ::mmap(nullptr, depth_ * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+  }
+  if (sqes_ == MAP_FAILED) {
+    const BadgerDbException error = uringError("mmap");
+    release();
+    throw error;
+  }
+
+  char *sq = static_cast<char *>(sq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+  reaper_ = std::thread(&UringIoEngine::reapLoop, this);
+}
+
+UringIoEngine::~UringIoEngine() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    submitLocked();
+    slot_free_.wait(lock, [this] { return in_flight_ == 0; });
+  }
+  // a no-op tells the completion thread to exit
+  queueEntry(IORING_OP_NOP, -1, nullptr, 0, 0, 0 /* user_data */);
+  submit();
+  reaper_.join();
+  release();
+}
+
+void UringIoEngine::release() {
+  if (sqes_ != MAP_FAILED) ::munmap(sqes_, depth_ * sizeof(io_uring_sqe));
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_bytes_);
+  }
+  if (sq_ring_ != MAP_FAILED) ::munmap(sq_ring_, sq_ring_bytes_);
+  if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+void UringIoEngine::read(const File &file, const PageId first,
+                         const std::uint32_t count, Page *const *pages,
+                         Callback done) {
+  try {
+    file.checkRun(first, count);
+  } catch (...) {
+    done(std::current_exception());
+    return;
+  }
+  if (count == 0) {
+    done(nullptr);
+    return;
+  }
+
+  Request *request = new Request{
+      false, file.handle(), first, std::vector<Page *>(pages, pages + count),
+      std::vector<char>(), std::vector<iovec>(count), std::vector<Chunk>(), 0,
+      nullptr, std::move(done)};
+  for (std::uint32_t i = 0; i < count; i++) {
+    request->iov[i].iov_base = pages[i];
+    request->iov[i].iov_len = Page::SIZE;
+  }
+  for (std::uint32_t i = 0; i < count; i += IOV_MAX) {
+    request->chunks.push_back(
+        Chunk{request, i, std::min<std::uint32_t>(count - i, IOV_MAX)});
+  }
+  request->chunks_left = request->chunks.size();
+
+  // the request belongs to the completion thread as soon as its last chunk
+  // is queued, so nothing of it is touched after that
+  const int fd = file.descriptor_->fd;
+  Chunk *chunks = request->chunks.data();
+  const std::size_t num_chunks = request->chunks.size();
+  for (std::size_t c = 0; c < num_chunks; c++) {
+    queueEntry(IORING_OP_READV, fd, &request->iov[chunks[c].index],
+               chunks[c].count, file.pagePosition(first + chunks[c].index),
+               reinterpret_cast<std::uint64_t>(&chunks[c]));
+  }
+}
+
+void UringIoEngine::write(const File &file, const PageId first,
+                          const std::uint32_t count, const Page *const *pages,
+                          Callback done) {
+  if (count == 0) {
+    done(nullptr);
+    return;
+  }
+  Request *request = new Request{
+      true, file.handle(), first, std::vector<Page *>(), std::vector<char>(),
+      std::vector<iovec>(1), std::vector<Chunk>(), 1, nullptr,
+      std::move(done)};
+  try {
+    request->file->prepareWrite(first, count, pages, request->run);
+  } catch (...) {
+    request->done(std::current_exception());
+    delete request;
+    return;
+  }
+  request->iov[0].iov_base = request->run.data();
+  request->iov[0].iov_len = request->run.size();
+  request->chunks.push_back(Chunk{request, 0, count});
+
+  // submitted at once: allocating or deleting a page of the file waits for
+  // the write while holding the latch the next prepareWrite() needs
+  const int fd = file.descriptor_->fd;
+  const off_t position = file.pagePosition(first);
+  queueEntry(IORING_OP_WRITEV, fd, request->iov.data(), 1, position,
+             reinterpret_cast<std::uint64_t>(request->chunks.data()));
+  submit();
+}
+
+void UringIoEngine::submit() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  submitLocked();
+}
+
+void UringIoEngine::queueEntry(const std::uint8_t opcode, const int fd,
+                               const iovec *iov, const std::uint32_t iov_count,
+                               const off_t position,
+                               const std::uint64_t user_data) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (in_flight_ == depth_) {
+    submitLocked();
+    slot_free_.wait(lock);
+  }
+  // only this latch's holder moves the tail; the kernel moves the head
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe &sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  sqe.off = position;
+  sqe.addr = reinterpret_cast<std::uint64_t>(iov);
+  sqe.len = iov_count;
+  sqe.user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  in_flight_++;
+  unsubmitted_++;
+}
+
+void UringIoEngine::submitLocked() {
+  while (unsubmitted_ > 0) {
+    const int n = ioUringEnter(ring_fd_, unsubmitted_, 0, 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EBUSY) {
+        // out of kernel resources for now; completions will free some
+        std::this_thread::yield();
+        continue;
+      }
+      throw uringError("enter");
+    }
+    unsubmitted_ -= n;
+  }
+}
+
+void UringIoEngine::reapLoop() {
+  std::vector<std::pair<std::uint64_t, int>> completions;
+  bool stop = false;
+  while (!stop) {
+    // only this thread moves the head; the kernel moves the tail
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+    completions.clear();
+    for (; head != tail; head++) {
+      const io_uring_cqe &cqe = cqes_[head & *cq_mask_];
+      completions.emplace_back(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cq_head_, tail, __ATOMIC_RELEASE);
+    {
+      // also orders the requests' set-up, done under the latch, before
+      // their completion here
+      std::lock_guard<std::mutex> guard(mutex_);
+      in_flight_ -= completions.size();
+    }
+    slot_free_.notify_all();
+
+    for (const std::pair<std::uint64_t, int> &completion : completions) {
+      if (completion.first == 0) {
+        stop = true;
+      } else {
+        complete(reinterpret_cast<Chunk *>(completion.first),
+                 completion.second);
+      }
+    }
+  }
+}
+
+void UringIoEngine::complete(Chunk *chunk, const int result) {
+  Request &request = *chunk->request;
+  try {
+    if (result < 0 && result != -EINTR && result != -EAGAIN) {
+      throw FileIOException(request.file->filename(), -result);
+    }
+    // a short read or write, or one the kernel asks to retry, is finished
+    // here
+    const std::size_t bytes = result < 0 ? 0 : result;
+    if (request.write) {
+      request.file->finishWrite(request.first, request.run.data(),
+                                request.run.size(), bytes);
+    } else {
+      request.file->finishRead(request.first + chunk->index, chunk->count,
+                               &request.pages[chunk->index], bytes);
+    }
+  } catch (...) {
+    if (!request.error) request.error = std::current_exception();
+  }
+  if (--request.chunks_left == 0) {
+    if (request.write) request.file->endWrite();
+    request.done(request.error);
+    delete &request;
+  }
+}
+
+}  // namespace badgerdb
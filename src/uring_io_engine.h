@@ -0,0 +1,186 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_engine.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace badgerdb {
+
+/**
+ * @brief IoEngine reading and writing through an io_uring submission queue,
+ * set up and driven with raw system calls.
+ *
+ * Each read becomes one vectored read per IOV_MAX pages of its run.  A write
+ * has the images of its run, with the next page pointers the pages have on
+ * disk, built under the file's latch by File::prepareWrite(), and becomes one
+ * vectored write of them.  A write is submitted as soon as it is queued, as
+ * the file's structural changes wait for it under the latch.  A completion
+ * thread reaps the completion queue, finishes short reads and writes
+ * synchronously, checks the pages read and calls back.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring with room for queue_depth requests, rounded up to a power
+   * of two, and starts the completion thread.
+   *
+   * @param queue_depth  Most reads in flight at once
+   * @throws  BadgerDbException  If the kernel does not support io_uring.
+   */
+  explicit UringIoEngine(std::uint32_t queue_depth);
+
+  /**
+   * Waits for every request and tears the ring down.
+   */
+  ~UringIoEngine() override;
+
+  UringIoEngine(const UringIoEngine &) = delete;
+  UringIoEngine &operator=(const UringIoEngine &) = delete;
+
+  const char *name() const override { return "io_uring"; }
+  std::uint32_t queueDepth() const override { return depth_; }
+  void read(const File &file, PageId first, std::uint32_t count,
+            Page *const *pages, Callback done) override;
+  void write(const File &file, PageId first, std::uint32_t count,
+             const Page *const *pages, Callback done) override;
+  void submit() override;
+
+ private:
+  struct Request;
+
+  /**
+   * @brief Part of a request issued as one submission queue entry.
+   */
+  struct Chunk {
+    Request *request;
+    std::uint32_t index;
+    std::uint32_t count;
+  };
+
+  /**
+   * @brief A read or write in flight; owned by the completion thread once
+   * queued.
+   */
+  struct Request {
+    bool write;
+    std::shared_ptr<File> file;
+    PageId first;
+    std::vector<Page *> pages;  // reads
+    std::vector<char> run;      // writes: the page images
+    std::vector<iovec> iov;
+    std::vector<Chunk> chunks;
+    std::uint32_t chunks_left;
+    std::exception_ptr error;
+    Callback done;
+  };
+
+  /**
+   * Queues one entry, waiting for a free slot first.  user_data 0 marks the
+   * entry that stops the completion thread.
+   */
+  void queueEntry(std::uint8_t opcode, int fd, const iovec *iov,
+                  std::uint32_t iov_count, off_t position,
+                  std::uint64_t user_data);
+
+  /**
+   * Passes the queued entries to the kernel; mutex_ must be held.
+   *
+   * @throws  BadgerDbException  If the kernel refuses the entries.
+   */
+  void submitLocked();
+
+  /**
+   * Unmaps the rings and closes the ring's descriptor, as far as they were
+   * set up.
+   */
+  void release();
+
+  /**
+   * Body of the completion thread
+   */
+  void reapLoop();
+
+  /**
+   * Handles the completion of one chunk.
+   */
+  void complete(Chunk *chunk, int result);
+
+  /**
+   * The ring's file descriptor
+   */
+  int ring_fd_;
+
+  /**
+   * Number of submission queue entries
+   */
+  std::uint32_t depth_;
+
+  /**
+   * The mapped rings; the completion ring shares the submission ring's
+   * mapping when the kernel supports it
+   */
+  void *sq_ring_;
+  std::size_t sq_ring_bytes_;
+  void *cq_ring_;
+  std::size_t cq_ring_bytes_;
+  io_uring_sqe *sqes_;
+
+  /**
+   * Fields of the submission ring
+   */
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+
+  /**
+   * Fields of the completion ring
+   */
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  io_uring_cqe *cqes_;
+
+  /**
+   * Protects the submission ring, in_flight_ and unsubmitted_
+   */
+  std::mutex mutex_;
+
+  /**
+   * Signalled when entries complete
+   */
+  std::condition_variable slot_free_;
+
+  /**
+   * Entries queued and not yet completed, submitted or not
+   */
+  std::uint32_t in_flight_;
+
+  /**
+   * Entries queued and not yet passed to the kernel
+   */
+  std::uint32_t unsubmitted_;
+
+  /**
+   * Reaps completions and calls back
+   */
+  std::thread reaper_;
+};
+
+}  // namespace badgerdb